@@ -76,14 +76,13 @@ static std::unique_ptr<Image> swapHalves(Image *localImage,
   // Wait for my image to come in.
   MPI_Waitall(recvRequests.size(), recvRequests.data(), MPI_STATUSES_IGNORE);
 
-  // Blend the incoming image.
-  std::unique_ptr<Image> blendedImage;
+  // Blend the incoming image into the receive buffer.
   switch (role) {
     case PairRole::FIRST:
-      blendedImage = toKeep->blend(*recvImage);
+      toKeep->blendInto(*recvImage, *recvImage);
       break;
     case PairRole::SECOND:
-      blendedImage = recvImage->blend(*toKeep);
+      recvImage->blendInPlace(*toKeep);
       break;
   }
 
@@ -91,7 +90,7 @@ static std::unique_ptr<Image> swapHalves(Image *localImage,
   MPI_Waitall(sendRequests.size(), sendRequests.data(), MPI_STATUSES_IGNORE);
 
   // Return result
-  return blendedImage;
+  return recvImage;
 }
 
 // Takes a group of 3 processes, divides their images in half, and composites
@@ -119,7 +118,8 @@ static std::unique_ptr<Image> Eliminate32(Image *localImage,
     MPI_Waitall(recvRequests.size(), recvRequests.data(), MPI_STATUSES_IGNORE);
 
     // Finally, blend the third process' image.
-    return blendedImage->blend(*recvImage);
+    blendedImage->blendInPlace(*recvImage);
+    return blendedImage;
   } else if (rank == subgroupStart + 2) {
     // This rank gives away its two halves.
 
@@ -175,7 +175,8 @@ static std::unique_ptr<Image> Eliminate42(Image *localImage,
     MPI_Waitall(recvRequests.size(), recvRequests.data(), MPI_STATUSES_IGNORE);
 
     // Finally, blend the other group's image.
-    return blendedImage->blend(*recvImage);
+    blendedImage->blendInPlace(*recvImage);
+    return blendedImage;
   } else if ((rank == subgroupStart + 2) || (rank == subgroupStart + 3)) {
     // This rank is part of the second group.
     // First, do a normal binary swap.
@@ -8,6 +8,8 @@
 
 #include "BinarySwapBase.hpp"
 
+#include <Common/MainLoop.hpp>
+
 enum PairRole { PAIR_ROLE_EVEN, PAIR_ROLE_ODD };
 
 static bool isPowerOfTwo(int x) {
@@ -50,6 +52,14 @@ std::unique_ptr<Image> BinarySwapBase::compose(Image *localImage,
 
   std::unique_ptr<Image> workingImage = localImage->shallowCopy();
 
+  // The result of each round is blended into the buffer that received the
+  // partner's image. The buffer from the previous round is no longer needed
+  // after that, so it is kept to receive into on the following round. Thus
+  // we only ever allocate two receive buffers. (The first working image is
+  // the local image, which is not ours to reuse.)
+  std::unique_ptr<Image> spareImage;
+  bool workingIsLocal = true;
+
   // This version of binary swap only works if the communicator size is a power
   // of two.
   if (!isPowerOfTwo(numProc)) {
@@ -95,7 +105,14 @@ std::unique_ptr<Image> BinarySwapBase::compose(Image *localImage,
     }
 
     // Receive our half of the image and send out our partner's half.
-    std::unique_ptr<Image> recvImage = toKeep->createNew();
+    std::unique_ptr<Image> recvImage;
+    if (spareImage) {
+      recvImage.swap(spareImage);
+      recvImage->resizeBuffers(toKeep->getRegionBegin(),
+                               toKeep->getRegionEnd());
+    } else {
+      recvImage = toKeep->createNew();
+    }
     std::vector<MPI_Request> recvRequests = recvImage->IReceive(
         getRealRank(workingGroup, partnerRank, communicator), communicator);
     std::vector<MPI_Request> sendRequests = toSend->ISend(
@@ -104,15 +121,21 @@ std::unique_ptr<Image> BinarySwapBase::compose(Image *localImage,
     // Wait for my image to come in.
     MPI_Waitall(recvRequests.size(), recvRequests.data(), MPI_STATUSES_IGNORE);
 
-    // Blend the incoming image and set the workingImage to the result.
+    // Blend the incoming image into the receive buffer and make that the
+    // workingImage.
     switch (role) {
       case PAIR_ROLE_EVEN:
-        workingImage = toKeep->blend(*recvImage);
+        toKeep->blendInto(*recvImage, *recvImage);
         break;
       case PAIR_ROLE_ODD:
-        workingImage = recvImage->blend(*toKeep);
+        recvImage->blendInPlace(*toKeep);
         break;
     }
+    if (!workingIsLocal) {
+      spareImage.swap(workingImage);
+    }
+    workingImage.swap(recvImage);
+    workingIsLocal = false;
 
     // Wait for my images to finish sending.
     MPI_Waitall(sendRequests.size(), sendRequests.data(), MPI_STATUSES_IGNORE);
@@ -139,3 +162,34 @@ std::unique_ptr<Image> BinarySwapBase::compose(Image *localImage,
 
   return workingImage;
 }
+
+enum optionIndex { INTERLEAVE_IMAGES };
+
+std::vector<option::Descriptor> BinarySwapBase::getOptionVector() {
+  std::vector<option::Descriptor> usage;
+  // clang-format off
+  usage.push_back(
+    {INTERLEAVE_IMAGES, 0, "", "interleave-images", option::Arg::None,
+     "  --interleave-images    Order the rows of the image so that each piece it\n"
+     "                         is split into holds rows spread over the whole\n"
+     "                         image. This balances the active pixels among the\n"
+     "                         pieces when the geometry covers only part of the\n"
+     "                         image.\n"});
+  // clang-format on
+
+  return usage;
+}
+
+bool BinarySwapBase::setOptions(const std::vector<option::Option> &options,
+                                MPI_Comm communicator,
+                                YamlWriter &yaml) {
+  if (options[INTERLEAVE_IMAGES]) {
+    // Each process ends up with one piece of the image.
+    int numProc;
+    MPI_Comm_size(communicator, &numProc);
+    Image::setInterleave(numProc);
+  }
+  yaml.AddDictionaryEntry("interleave", Image::getInterleave());
+
+  return true;
+}
@@ -17,6 +17,11 @@ class BinarySwapBase : public Compositor {
                                  MPI_Group group,
                                  MPI_Comm communicator,
                                  YamlWriter &yaml) final;
+
+  bool setOptions(const std::vector<option::Option> &options,
+                  MPI_Comm communicator,
+                  YamlWriter &yaml) override;
+  static std::vector<option::Descriptor> getOptionVector();
 };
 
 #endif  // BINARYSWABASEP_HPP
@@ -74,7 +74,8 @@ std::unique_ptr<Image> BinarySwapFold::compose(Image *localImage,
       std::unique_ptr<Image> incomingImage = workingImage->createNew();
       incomingImage->Receive(getRealRank(group, rankToSend, communicator),
                              communicator);
-      workingImage = workingImage->blend(*incomingImage);
+      workingImage->blendInto(*incomingImage, *incomingImage);
+      workingImage.swap(incomingImage);
     } else if (myGroupRank == rankToSend) {
       // This process sends its image out and drops out of the composition by
       // returning an empty image.
@@ -42,6 +42,12 @@ std::unique_ptr<Image> BinarySwapRemainder::compose(Image *localImage,
 
   std::unique_ptr<Image> workingImage = localImage->shallowCopy();
 
+  // As in the base algorithm, the result of each round is blended into the
+  // buffer that received the partner's image, and the buffer from the
+  // previous round is kept to receive into on the following round.
+  std::unique_ptr<Image> spareImage;
+  bool workingIsLocal = true;
+
   while (numProc > 1) {
     // At each iteration of the binary-swap algorithm, divide the image in half.
     std::unique_ptr<const Image> firstHalf =
@@ -99,7 +105,14 @@ std::unique_ptr<Image> BinarySwapRemainder::compose(Image *localImage,
     }
 
     // Receive our half of the image and send out our partner's half.
-    std::unique_ptr<Image> recvImage = toKeep->createNew();
+    std::unique_ptr<Image> recvImage;
+    if (spareImage) {
+      recvImage.swap(spareImage);
+      recvImage->resizeBuffers(toKeep->getRegionBegin(),
+                               toKeep->getRegionEnd());
+    } else {
+      recvImage = toKeep->createNew();
+    }
     std::vector<MPI_Request> recvRequests = recvImage->IReceive(
         getRealRank(workingGroup, partnerRank, communicator), communicator);
     std::vector<MPI_Request> sendRequests = toSend->ISend(
@@ -108,21 +121,28 @@ std::unique_ptr<Image> BinarySwapRemainder::compose(Image *localImage,
     // Wait for my image to come in.
     MPI_Waitall(recvRequests.size(), recvRequests.data(), MPI_STATUSES_IGNORE);
 
-    // Blend the incoming image and set the workingImage to the result.
+    // Blend the incoming image into the receive buffer and make that the
+    // workingImage.
     switch (role) {
       case PAIR_ROLE_EVEN:
-        workingImage = toKeep->blend(*recvImage);
+        toKeep->blendInto(*recvImage, *recvImage);
         break;
       case PAIR_ROLE_ODD:
-        workingImage = recvImage->blend(*toKeep);
+        recvImage->blendInPlace(*toKeep);
         break;
     }
+    if (!workingIsLocal) {
+      spareImage.swap(workingImage);
+    }
+    workingImage.swap(recvImage);
+    workingIsLocal = false;
 
     // Receive any images from the remainder if necessary
     if (haveRemainder && (rank >= numProc - 3)) {
-      recvImage->Receive(getRealRank(workingGroup, numProc - 1, communicator),
-                         communicator);
-      workingImage = workingImage->blend(*recvImage);
+      std::unique_ptr<Image> remainderImage = toKeep->createNew();
+      remainderImage->Receive(
+          getRealRank(workingGroup, numProc - 1, communicator), communicator);
+      workingImage->blendInPlace(*remainderImage);
     }
 
     // Wait for my images to finish sending.
@@ -116,7 +116,8 @@ std::unique_ptr<Image> BinarySwapTelescoping::composeBigGroup(
   std::unique_ptr<Image> incomingImage = composedImage->createNew();
   incomingImage->Receive(
       getRealRank(littleGroup, correspondingRank, communicator), communicator);
-  composedImage = composedImage->blend(*incomingImage);
+  composedImage->blendInto(*incomingImage, *incomingImage);
+  composedImage.swap(incomingImage);
 
   return composedImage;
 }
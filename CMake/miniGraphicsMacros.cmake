@@ -29,6 +29,12 @@ get_filename_component(miniGraphics_SOURCE_DIR
   )
 
 find_package(MPI REQUIRED)
+find_package(Threads REQUIRED)
+
+option(MINIGRAPHICS_ENABLE_SIMD
+  "Turn on/off vectorized compute kernels (selected at run time)."
+  ON
+  )
 
 # Create the config header file
 function(miniGraphics_create_config_header miniapp_name)
@@ -53,6 +59,7 @@ function(miniGraphics_target_features target_name)
   set(libs
     ${MPI_CXX_LINK_FLAGS}
     ${MPI_CXX_LIBRARIES}
+    ${CMAKE_THREAD_LIBS_INIT}
     )
 
   set(cxx_flags
@@ -92,12 +99,15 @@ endfunction(miniGraphics_find_power_of_two)
 
 # Call this function to build one of the miniGraphics miniapps.
 # The first argument is the name of the miniapp. A target with that name will
-# be created. The remaining arguments are source files.
+# be created. The remaining arguments are source files. Tests that would use
+# any of the command line options listed after UNSUPPORTED_OPTIONS are not
+# created. Each option listed after EXTRA_TEST_OPTIONS also gets tests of its
+# own, which use the default buffer formats.
 function(miniGraphics_executable miniapp_name)
   message(STATUS "Adding miniapp ${miniapp_name}")
   set(options DISABLE_TESTS POWER_OF_TWO_ONLY)
   set(oneValueArgs)
-  set(multiValueArgs HEADERS SOURCES)
+  set(multiValueArgs HEADERS SOURCES UNSUPPORTED_OPTIONS EXTRA_TEST_OPTIONS)
   cmake_parse_arguments(miniGraphics_executable
     "${options}" "${oneValueArgs}" "${multiValueArgs}"
     ${ARGN}
@@ -135,28 +145,70 @@ function(miniGraphics_executable miniapp_name)
     else()
       set(np ${MPIEXEC_MAX_NUMPROCS})
     endif()
-    foreach(color_buffer_option --color-ubyte --color-float)
-      foreach(depth_buffer_option --depth-float --depth-none)
-        foreach(image_compress_option --disable-image-compress --enable-image-compress)
-          set(test_name ${miniapp_name}${color_buffer_option}${depth_buffer_option}${image_compress_option})
-          set(test_options
-            ${base_options}
-            ${color_buffer_option}
-            ${depth_buffer_option}
-            ${image_compress_option}
-            )
-          add_test(
-            NAME ${test_name}
-            COMMAND ${MPIEXEC}
-              ${MPIEXEC_NUMPROC_FLAG} ${np}
-              ${MPIEXEC_PREFLAGS}
-              $<TARGET_FILE:${miniapp_name}>
-              ${MPIEXEC_POSTFLAGS}
-              ${test_options}
-            )
-        endforeach(image_compress_option)
-      endforeach(depth_buffer_option)
-    endforeach(color_buffer_option)
+    # Each entry is a color buffer option and a depth buffer option, possibly
+    # followed by a pixel layout option.
+    set(buffer_formats
+      --color-ubyte:--depth-float
+      --color-ubyte:--depth-none
+      --color-float:--depth-float
+      --color-float:--depth-none
+      --color-half:--depth-half
+      --color-half:--depth-none
+      --color-float-planar:--depth-float
+      --color-float-planar:--depth-none
+      --color-ubyte:--depth-float:--tile-size=8
+      --color-float:--depth-none:--tile-size=8
+      )
+    foreach(buffer_format ${buffer_formats})
+      string(REPLACE ":" ";" buffer_format_options ${buffer_format})
+      string(REPLACE ":" "" buffer_format_name ${buffer_format})
+      set(buffer_format_supported TRUE)
+      foreach(option ${buffer_format_options})
+        list(FIND miniGraphics_executable_UNSUPPORTED_OPTIONS ${option} index)
+        if(NOT index EQUAL -1)
+          set(buffer_format_supported FALSE)
+        endif()
+      endforeach(option)
+      if(NOT buffer_format_supported)
+        continue()
+      endif()
+      foreach(image_compress_option --disable-image-compress --enable-image-compress)
+        set(test_name ${miniapp_name}${buffer_format_name}${image_compress_option})
+        set(test_options
+          ${base_options}
+          ${buffer_format_options}
+          ${image_compress_option}
+          )
+        add_test(
+          NAME ${test_name}
+          COMMAND ${MPIEXEC}
+            ${MPIEXEC_NUMPROC_FLAG} ${np}
+            ${MPIEXEC_PREFLAGS}
+            $<TARGET_FILE:${miniapp_name}>
+            ${MPIEXEC_POSTFLAGS}
+            ${test_options}
+          )
+      endforeach(image_compress_option)
+    endforeach(buffer_format)
+    foreach(extra_option ${miniGraphics_executable_EXTRA_TEST_OPTIONS})
+      foreach(image_compress_option --disable-image-compress --enable-image-compress)
+        set(test_name ${miniapp_name}${extra_option}${image_compress_option})
+        set(test_options
+          ${base_options}
+          ${extra_option}
+          ${image_compress_option}
+          )
+        add_test(
+          NAME ${test_name}
+          COMMAND ${MPIEXEC}
+            ${MPIEXEC_NUMPROC_FLAG} ${np}
+            ${MPIEXEC_PREFLAGS}
+            $<TARGET_FILE:${miniapp_name}>
+            ${MPIEXEC_POSTFLAGS}
+            ${test_options}
+          )
+      endforeach(image_compress_option)
+    endforeach(extra_option)
   endif()
 endfunction(miniGraphics_executable)
 
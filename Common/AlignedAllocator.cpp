@@ -0,0 +1,71 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include "AlignedAllocator.hpp"
+
+#include <miniGraphicsConfig.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef MINIGRAPHICS_WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+static std::atomic<bool> gHugePagesEnabled(false);
+
+void setHugePagesEnabled(bool enabled) { gHugePagesEnabled = enabled; }
+
+bool getHugePagesEnabled() { return gHugePagesEnabled; }
+
+void* allocateAligned(std::size_t numBytes) {
+  std::size_t alignment = ALIGNED_ALLOCATOR_ALIGNMENT;
+  bool useHugePages = gHugePagesEnabled && (numBytes >= HUGE_PAGE_SIZE);
+  if (useHugePages) {
+    // Pad to whole pages so the last page is not shared with other data.
+    alignment = HUGE_PAGE_SIZE;
+    numBytes = ((numBytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) *
+               HUGE_PAGE_SIZE;
+  }
+  if (numBytes == 0) {
+    numBytes = alignment;
+  }
+
+  void* memory;
+#ifdef MINIGRAPHICS_WIN32
+  memory = _aligned_malloc(numBytes, alignment);
+#else
+  if (posix_memalign(&memory, alignment, numBytes) != 0) {
+    memory = nullptr;
+  }
+#endif
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+
+#if !defined(MINIGRAPHICS_WIN32) && defined(MADV_HUGEPAGE)
+  if (useHugePages) {
+    // Only a hint. If the kernel does not support transparent huge pages,
+    // the memory is still usable with regular pages.
+    madvise(memory, numBytes, MADV_HUGEPAGE);
+  }
+#endif
+
+  return memory;
+}
+
+void deallocateAligned(void* memory) {
+#ifdef MINIGRAPHICS_WIN32
+  _aligned_free(memory);
+#else
+  free(memory);
+#endif
+}
@@ -0,0 +1,65 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef ALIGNEDALLOCATOR_HPP
+#define ALIGNEDALLOCATOR_HPP
+
+// An STL allocator for image buffers. All allocations start on a cache line
+// boundary so vector loads never straddle lines at the start of a buffer.
+// Optionally, large allocations are placed on huge page boundaries and the
+// OS is asked to back them with huge pages, which cuts down on TLB misses
+// when streaming through big frames.
+
+#include <cstddef>
+
+/// Alignment, in bytes, of every allocation.
+constexpr std::size_t ALIGNED_ALLOCATOR_ALIGNMENT = 64;
+
+/// Size, in bytes, of the huge pages requested for large allocations.
+constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/// \brief Turns on or off huge pages for large image buffers. Off by default.
+///
+/// When on, allocations of at least HUGE_PAGE_SIZE bytes are aligned to (and
+/// padded out to) HUGE_PAGE_SIZE and are marked with madvise(MADV_HUGEPAGE).
+/// Has no effect on allocations already made or on systems without
+/// transparent huge pages.
+void setHugePagesEnabled(bool enabled);
+
+bool getHugePagesEnabled();
+
+/// \brief Allocates aligned memory. Throws std::bad_alloc on failure.
+void* allocateAligned(std::size_t numBytes);
+
+/// \brief Frees memory from allocateAligned.
+void deallocateAligned(void* memory);
+
+template <typename T>
+struct AlignedAllocator {
+  using value_type = T;
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(allocateAligned(n * sizeof(T)));
+  }
+  void deallocate(T* memory, std::size_t) { deallocateAligned(memory); }
+};
+
+template <typename T, typename U>
+bool operator==(const AlignedAllocator<T>&, const AlignedAllocator<U>&) {
+  return true;
+}
+template <typename T, typename U>
+bool operator!=(const AlignedAllocator<T>&, const AlignedAllocator<U>&) {
+  return false;
+}
+
+#endif  // ALIGNEDALLOCATOR_HPP
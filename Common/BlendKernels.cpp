@@ -0,0 +1,939 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include "BlendKernels.hpp"
+
+#include "SimdDispatch.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef MINIGRAPHICS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Scalar implementations. These also finish off the tail of the vectorized
+// loops.
+
+static void depthBlendRGBAUByteScalar(const unsigned int* topColor,
+                                      const float* topDepth,
+                                      const unsigned int* bottomColor,
+                                      const float* bottomDepth,
+                                      unsigned int* outColor,
+                                      float* outDepth,
+                                      int numPixels) {
+  for (int pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
+    bool useBottom = bottomDepth[pixelIndex] < topDepth[pixelIndex];
+    outColor[pixelIndex] =
+        useBottom ? bottomColor[pixelIndex] : topColor[pixelIndex];
+    outDepth[pixelIndex] =
+        useBottom ? bottomDepth[pixelIndex] : topDepth[pixelIndex];
+  }
+}
+
+static void depthBlendRGBFloatScalar(const float* topColor,
+                                     const float* topDepth,
+                                     const float* bottomColor,
+                                     const float* bottomDepth,
+                                     float* outColor,
+                                     float* outDepth,
+                                     int numPixels) {
+  for (int pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
+    bool useBottom = bottomDepth[pixelIndex] < topDepth[pixelIndex];
+    const float* srcColor = useBottom ? bottomColor : topColor;
+    outColor[3 * pixelIndex + 0] = srcColor[3 * pixelIndex + 0];
+    outColor[3 * pixelIndex + 1] = srcColor[3 * pixelIndex + 1];
+    outColor[3 * pixelIndex + 2] = srcColor[3 * pixelIndex + 2];
+    outDepth[pixelIndex] =
+        useBottom ? bottomDepth[pixelIndex] : topDepth[pixelIndex];
+  }
+}
+
+static void overBlendRGBAUByteScalar(const unsigned int* topColor,
+                                     const unsigned int* bottomColor,
+                                     unsigned int* outColor,
+                                     int numPixels) {
+  for (int pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
+    const unsigned char* top =
+        reinterpret_cast<const unsigned char*>(topColor + pixelIndex);
+    const unsigned char* bottom =
+        reinterpret_cast<const unsigned char*>(bottomColor + pixelIndex);
+    unsigned int bottomScale = 255 - top[3];
+    unsigned char result[4];
+    for (int component = 0; component < 4; ++component) {
+      unsigned int scaled = bottom[component] * bottomScale + 128;
+      scaled = (scaled + (scaled >> 8)) >> 8;
+      unsigned int value = top[component] + scaled;
+      result[component] =
+          static_cast<unsigned char>((value < 255) ? value : 255);
+    }
+    std::memcpy(outColor + pixelIndex, result, sizeof(unsigned int));
+  }
+}
+
+static void overBlendRGBAFloatScalar(const float* topColor,
+                                     const float* bottomColor,
+                                     float* outColor,
+                                     int numPixels) {
+  for (int pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
+    const float* top = topColor + 4 * pixelIndex;
+    const float* bottom = bottomColor + 4 * pixelIndex;
+    float bottomScale = 1.0f - top[3];
+    float result[4];
+    for (int component = 0; component < 4; ++component) {
+      result[component] = top[component] + bottom[component] * bottomScale;
+    }
+    std::copy(result, result + 4, outColor + 4 * pixelIndex);
+  }
+}
+
+// The planar kernels take the index of the first pixel to blend so that the
+// vectorized versions can hand off the tail without building new channel
+// pointer arrays.
+
+static void depthBlendFloatPlanarScalar(const float* const* topColor,
+                                        const float* topDepth,
+                                        const float* const* bottomColor,
+                                        const float* bottomDepth,
+                                        float* const* outColor,
+                                        float* outDepth,
+                                        int numChannels,
+                                        int pixelIndex,
+                                        int numPixels) {
+  for (; pixelIndex < numPixels; ++pixelIndex) {
+    bool useBottom = bottomDepth[pixelIndex] < topDepth[pixelIndex];
+    const float* const* srcColor = useBottom ? bottomColor : topColor;
+    for (int channel = 0; channel < numChannels; ++channel) {
+      outColor[channel][pixelIndex] = srcColor[channel][pixelIndex];
+    }
+    outDepth[pixelIndex] =
+        useBottom ? bottomDepth[pixelIndex] : topDepth[pixelIndex];
+  }
+}
+
+static void overBlendRGBAFloatPlanarScalar(const float* const* topColor,
+                                           const float* const* bottomColor,
+                                           float* const* outColor,
+                                           int pixelIndex,
+                                           int numPixels) {
+  for (; pixelIndex < numPixels; ++pixelIndex) {
+    float bottomScale = 1.0f - topColor[3][pixelIndex];
+    for (int channel = 0; channel < 4; ++channel) {
+      outColor[channel][pixelIndex] =
+          topColor[channel][pixelIndex] +
+          bottomColor[channel][pixelIndex] * bottomScale;
+    }
+  }
+}
+
+#ifdef MINIGRAPHICS_SIMD_X86
+
+// -----------------------------------------------------------------------------
+// SSE2 implementations. 4 pixels per iteration.
+
+MINIGRAPHICS_SIMD_TARGET("sse2")
+static inline __m128 selectSSE2(__m128 mask, __m128 ifFalse, __m128 ifTrue) {
+  return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+}
+
+MINIGRAPHICS_SIMD_TARGET("sse2")
+static void depthBlendRGBAUByteSSE2(const unsigned int* topColor,
+                                    const float* topDepth,
+                                    const unsigned int* bottomColor,
+                                    const float* bottomDepth,
+                                    unsigned int* outColor,
+                                    float* outDepth,
+                                    int numPixels) {
+  int pixelIndex = 0;
+  for (; pixelIndex + 4 <= numPixels; pixelIndex += 4) {
+    __m128 top = _mm_loadu_ps(topDepth + pixelIndex);
+    __m128 bottom = _mm_loadu_ps(bottomDepth + pixelIndex);
+    __m128 useBottom = _mm_cmplt_ps(bottom, top);
+    __m128 topC = _mm_castsi128_ps(_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(topColor + pixelIndex)));
+    __m128 bottomC = _mm_castsi128_ps(_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(bottomColor + pixelIndex)));
+    _mm_storeu_ps(outDepth + pixelIndex, selectSSE2(useBottom, top, bottom));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(outColor + pixelIndex),
+                     _mm_castps_si128(selectSSE2(useBottom, topC, bottomC)));
+  }
+  depthBlendRGBAUByteScalar(topColor + pixelIndex,
+                            topDepth + pixelIndex,
+                            bottomColor + pixelIndex,
+                            bottomDepth + pixelIndex,
+                            outColor + pixelIndex,
+                            outDepth + pixelIndex,
+                            numPixels - pixelIndex);
+}
+
+MINIGRAPHICS_SIMD_TARGET("sse2")
+static void depthBlendRGBFloatSSE2(const float* topColor,
+                                   const float* topDepth,
+                                   const float* bottomColor,
+                                   const float* bottomDepth,
+                                   float* outColor,
+                                   float* outDepth,
+                                   int numPixels) {
+  int pixelIndex = 0;
+  for (; pixelIndex + 4 <= numPixels; pixelIndex += 4) {
+    __m128 top = _mm_loadu_ps(topDepth + pixelIndex);
+    __m128 bottom = _mm_loadu_ps(bottomDepth + pixelIndex);
+    __m128 useBottom = _mm_cmplt_ps(bottom, top);
+    _mm_storeu_ps(outDepth + pixelIndex, selectSSE2(useBottom, top, bottom));
+
+    // The 4 pixels have 12 color components spread over 3 registers. Expand
+    // the per-pixel mask to match the components in each register.
+    __m128 mask[3] = {
+        _mm_shuffle_ps(useBottom, useBottom, _MM_SHUFFLE(1, 0, 0, 0)),
+        _mm_shuffle_ps(useBottom, useBottom, _MM_SHUFFLE(2, 2, 1, 1)),
+        _mm_shuffle_ps(useBottom, useBottom, _MM_SHUFFLE(3, 3, 3, 2))};
+    for (int part = 0; part < 3; ++part) {
+      int offset = 3 * pixelIndex + 4 * part;
+      __m128 topC = _mm_loadu_ps(topColor + offset);
+      __m128 bottomC = _mm_loadu_ps(bottomColor + offset);
+      _mm_storeu_ps(outColor + offset, selectSSE2(mask[part], topC, bottomC));
+    }
+  }
+  depthBlendRGBFloatScalar(topColor + 3 * pixelIndex,
+                           topDepth + pixelIndex,
+                           bottomColor + 3 * pixelIndex,
+                           bottomDepth + pixelIndex,
+                           outColor + 3 * pixelIndex,
+                           outDepth + pixelIndex,
+                           numPixels - pixelIndex);
+}
+
+// Computes round(bottom * (255 - topAlpha) / 255) for 8-bit components that
+// have been unpacked to 16-bit lanes (4 lanes per pixel, alpha last).
+MINIGRAPHICS_SIMD_TARGET("sse2")
+static inline __m128i scaleByInverseAlphaSSE2(__m128i top16,
+                                              __m128i bottom16) {
+  __m128i alpha = _mm_shufflehi_epi16(
+      _mm_shufflelo_epi16(top16, _MM_SHUFFLE(3, 3, 3, 3)),
+      _MM_SHUFFLE(3, 3, 3, 3));
+  __m128i scale = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+  __m128i scaled = _mm_add_epi16(_mm_mullo_epi16(bottom16, scale),
+                                 _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(scaled, _mm_srli_epi16(scaled, 8)), 8);
+}
+
+MINIGRAPHICS_SIMD_TARGET("sse2")
+static void overBlendRGBAUByteSSE2(const unsigned int* topColor,
+                                   const unsigned int* bottomColor,
+                                   unsigned int* outColor,
+                                   int numPixels) {
+  const __m128i zero = _mm_setzero_si128();
+  int pixelIndex = 0;
+  for (; pixelIndex + 4 <= numPixels; pixelIndex += 4) {
+    __m128i top = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(topColor + pixelIndex));
+    __m128i bottom = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(bottomColor + pixelIndex));
+    __m128i scaledLow = scaleByInverseAlphaSSE2(
+        _mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+    __m128i scaledHigh = scaleByInverseAlphaSSE2(
+        _mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+    __m128i scaled = _mm_packus_epi16(scaledLow, scaledHigh);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(outColor + pixelIndex),
+                     _mm_adds_epu8(top, scaled));
+  }
+  overBlendRGBAUByteScalar(topColor + pixelIndex,
+                           bottomColor + pixelIndex,
+                           outColor + pixelIndex,
+                           numPixels - pixelIndex);
+}
+
+MINIGRAPHICS_SIMD_TARGET("sse2")
+static void overBlendRGBAFloatSSE2(const float* topColor,
+                                   const float* bottomColor,
+                                   float* outColor,
+                                   int numPixels) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (int pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
+    __m128 top = _mm_loadu_ps(topColor + 4 * pixelIndex);
+    __m128 bottom = _mm_loadu_ps(bottomColor + 4 * pixelIndex);
+    __m128 alpha = _mm_shuffle_ps(top, top, _MM_SHUFFLE(3, 3, 3, 3));
+    _mm_storeu_ps(outColor + 4 * pixelIndex,
+                  _mm_add_ps(top, _mm_mul_ps(bottom, _mm_sub_ps(one, alpha))));
+  }
+}
+
+MINIGRAPHICS_SIMD_TARGET("sse2")
+static void depthBlendFloatPlanarSSE2(const float* const* topColor,
+                                      const float* topDepth,
+                                      const float* const* bottomColor,
+                                      const float* bottomDepth,
+                                      float* const* outColor,
+                                      float* outDepth,
+                                      int numChannels,
+                                      int numPixels) {
+  int pixelIndex = 0;
+  for (; pixelIndex + 4 <= numPixels; pixelIndex += 4) {
+    __m128 top = _mm_loadu_ps(topDepth + pixelIndex);
+    __m128 bottom = _mm_loadu_ps(bottomDepth + pixelIndex);
+    __m128 useBottom = _mm_cmplt_ps(bottom, top);
+    for (int channel = 0; channel < numChannels; ++channel) {
+      __m128 topC = _mm_loadu_ps(topColor[channel] + pixelIndex);
+      __m128 bottomC = _mm_loadu_ps(bottomColor[channel] + pixelIndex);
+      _mm_storeu_ps(outColor[channel] + pixelIndex,
+                    selectSSE2(useBottom, topC, bottomC));
+    }
+    _mm_storeu_ps(outDepth + pixelIndex, selectSSE2(useBottom, top, bottom));
+  }
+  depthBlendFloatPlanarScalar(topColor,
+                              topDepth,
+                              bottomColor,
+                              bottomDepth,
+                              outColor,
+                              outDepth,
+                              numChannels,
+                              pixelIndex,
+                              numPixels);
+}
+
+MINIGRAPHICS_SIMD_TARGET("sse2")
+static void overBlendRGBAFloatPlanarSSE2(const float* const* topColor,
+                                         const float* const* bottomColor,
+                                         float* const* outColor,
+                                         int numPixels) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  int pixelIndex = 0;
+  for (; pixelIndex + 4 <= numPixels; pixelIndex += 4) {
+    __m128 scale = _mm_sub_ps(one, _mm_loadu_ps(topColor[3] + pixelIndex));
+    for (int channel = 0; channel < 4; ++channel) {
+      __m128 top = _mm_loadu_ps(topColor[channel] + pixelIndex);
+      __m128 bottom = _mm_loadu_ps(bottomColor[channel] + pixelIndex);
+      _mm_storeu_ps(outColor[channel] + pixelIndex,
+                    _mm_add_ps(top, _mm_mul_ps(bottom, scale)));
+    }
+  }
+  overBlendRGBAFloatPlanarScalar(
+      topColor, bottomColor, outColor, pixelIndex, numPixels);
+}
+
+// -----------------------------------------------------------------------------
+// AVX2 implementations. 8 pixels per iteration.
+
+MINIGRAPHICS_SIMD_TARGET("avx2")
+static void depthBlendRGBAUByteAVX2(const unsigned int* topColor,
+                                    const float* topDepth,
+                                    const unsigned int* bottomColor,
+                                    const float* bottomDepth,
+                                    unsigned int* outColor,
+                                    float* outDepth,
+                                    int numPixels) {
+  int pixelIndex = 0;
+  for (; pixelIndex + 8 <= numPixels; pixelIndex += 8) {
+    __m256 top = _mm256_loadu_ps(topDepth + pixelIndex);
+    __m256 bottom = _mm256_loadu_ps(bottomDepth + pixelIndex);
+    __m256 useBottom = _mm256_cmp_ps(bottom, top, _CMP_LT_OQ);
+    __m256 topC = _mm256_castsi256_ps(_mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(topColor + pixelIndex)));
+    __m256 bottomC = _mm256_castsi256_ps(_mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(bottomColor + pixelIndex)));
+    _mm256_storeu_ps(outDepth + pixelIndex,
+                     _mm256_blendv_ps(top, bottom, useBottom));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(outColor + pixelIndex),
+        _mm256_castps_si256(_mm256_blendv_ps(topC, bottomC, useBottom)));
+  }
+  depthBlendRGBAUByteScalar(topColor + pixelIndex,
+                            topDepth + pixelIndex,
+                            bottomColor + pixelIndex,
+                            bottomDepth + pixelIndex,
+                            outColor + pixelIndex,
+                            outDepth + pixelIndex,
+                            numPixels - pixelIndex);
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx2")
+static void depthBlendRGBFloatAVX2(const float* topColor,
+                                   const float* topDepth,
+                                   const float* bottomColor,
+                                   const float* bottomDepth,
+                                   float* outColor,
+                                   float* outDepth,
+                                   int numPixels) {
+  // Maps each of the 24 color components of 8 pixels to its pixel.
+  const __m256i expand[3] = {_mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2),
+                             _mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5),
+                             _mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7)};
+  int pixelIndex = 0;
+  for (; pixelIndex + 8 <= numPixels; pixelIndex += 8) {
+    __m256 top = _mm256_loadu_ps(topDepth + pixelIndex);
+    __m256 bottom = _mm256_loadu_ps(bottomDepth + pixelIndex);
+    __m256 useBottom = _mm256_cmp_ps(bottom, top, _CMP_LT_OQ);
+    _mm256_storeu_ps(outDepth + pixelIndex,
+                     _mm256_blendv_ps(top, bottom, useBottom));
+    for (int part = 0; part < 3; ++part) {
+      int offset = 3 * pixelIndex + 8 * part;
+      __m256 mask = _mm256_permutevar8x32_ps(useBottom, expand[part]);
+      __m256 topC = _mm256_loadu_ps(topColor + offset);
+      __m256 bottomC = _mm256_loadu_ps(bottomColor + offset);
+      _mm256_storeu_ps(outColor + offset,
+                       _mm256_blendv_ps(topC, bottomC, mask));
+    }
+  }
+  depthBlendRGBFloatScalar(topColor + 3 * pixelIndex,
+                           topDepth + pixelIndex,
+                           bottomColor + 3 * pixelIndex,
+                           bottomDepth + pixelIndex,
+                           outColor + 3 * pixelIndex,
+                           outDepth + pixelIndex,
+                           numPixels - pixelIndex);
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx2")
+static inline __m256i scaleByInverseAlphaAVX2(__m256i top16,
+                                              __m256i bottom16) {
+  __m256i alpha = _mm256_shufflehi_epi16(
+      _mm256_shufflelo_epi16(top16, _MM_SHUFFLE(3, 3, 3, 3)),
+      _MM_SHUFFLE(3, 3, 3, 3));
+  __m256i scale = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+  __m256i scaled = _mm256_add_epi16(_mm256_mullo_epi16(bottom16, scale),
+                                    _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(
+      _mm256_add_epi16(scaled, _mm256_srli_epi16(scaled, 8)), 8);
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx2")
+static void overBlendRGBAUByteAVX2(const unsigned int* topColor,
+                                   const unsigned int* bottomColor,
+                                   unsigned int* outColor,
+                                   int numPixels) {
+  const __m256i zero = _mm256_setzero_si256();
+  int pixelIndex = 0;
+  for (; pixelIndex + 8 <= numPixels; pixelIndex += 8) {
+    __m256i top = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(topColor + pixelIndex));
+    __m256i bottom = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(bottomColor + pixelIndex));
+    // Unpack and pack both work within 128-bit lanes, so the pixels end up
+    // back where they started.
+    __m256i scaledLow = scaleByInverseAlphaAVX2(
+        _mm256_unpacklo_epi8(top, zero), _mm256_unpacklo_epi8(bottom, zero));
+    __m256i scaledHigh = scaleByInverseAlphaAVX2(
+        _mm256_unpackhi_epi8(top, zero), _mm256_unpackhi_epi8(bottom, zero));
+    __m256i scaled = _mm256_packus_epi16(scaledLow, scaledHigh);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(outColor + pixelIndex),
+                        _mm256_adds_epu8(top, scaled));
+  }
+  overBlendRGBAUByteSSE2(topColor + pixelIndex,
+                         bottomColor + pixelIndex,
+                         outColor + pixelIndex,
+                         numPixels - pixelIndex);
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx2")
+static void overBlendRGBAFloatAVX2(const float* topColor,
+                                   const float* bottomColor,
+                                   float* outColor,
+                                   int numPixels) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  int pixelIndex = 0;
+  for (; pixelIndex + 2 <= numPixels; pixelIndex += 2) {
+    __m256 top = _mm256_loadu_ps(topColor + 4 * pixelIndex);
+    __m256 bottom = _mm256_loadu_ps(bottomColor + 4 * pixelIndex);
+    __m256 alpha = _mm256_permute_ps(top, _MM_SHUFFLE(3, 3, 3, 3));
+    _mm256_storeu_ps(
+        outColor + 4 * pixelIndex,
+        _mm256_add_ps(top, _mm256_mul_ps(bottom, _mm256_sub_ps(one, alpha))));
+  }
+  overBlendRGBAFloatSSE2(topColor + 4 * pixelIndex,
+                         bottomColor + 4 * pixelIndex,
+                         outColor + 4 * pixelIndex,
+                         numPixels - pixelIndex);
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx2")
+static void depthBlendFloatPlanarAVX2(const float* const* topColor,
+                                      const float* topDepth,
+                                      const float* const* bottomColor,
+                                      const float* bottomDepth,
+                                      float* const* outColor,
+                                      float* outDepth,
+                                      int numChannels,
+                                      int numPixels) {
+  int pixelIndex = 0;
+  for (; pixelIndex + 8 <= numPixels; pixelIndex += 8) {
+    __m256 top = _mm256_loadu_ps(topDepth + pixelIndex);
+    __m256 bottom = _mm256_loadu_ps(bottomDepth + pixelIndex);
+    __m256 useBottom = _mm256_cmp_ps(bottom, top, _CMP_LT_OQ);
+    for (int channel = 0; channel < numChannels; ++channel) {
+      __m256 topC = _mm256_loadu_ps(topColor[channel] + pixelIndex);
+      __m256 bottomC = _mm256_loadu_ps(bottomColor[channel] + pixelIndex);
+      _mm256_storeu_ps(outColor[channel] + pixelIndex,
+                       _mm256_blendv_ps(topC, bottomC, useBottom));
+    }
+    _mm256_storeu_ps(outDepth + pixelIndex,
+                     _mm256_blendv_ps(top, bottom, useBottom));
+  }
+  depthBlendFloatPlanarScalar(topColor,
+                              topDepth,
+                              bottomColor,
+                              bottomDepth,
+                              outColor,
+                              outDepth,
+                              numChannels,
+                              pixelIndex,
+                              numPixels);
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx2")
+static void overBlendRGBAFloatPlanarAVX2(const float* const* topColor,
+                                         const float* const* bottomColor,
+                                         float* const* outColor,
+                                         int numPixels) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  int pixelIndex = 0;
+  for (; pixelIndex + 8 <= numPixels; pixelIndex += 8) {
+    __m256 scale =
+        _mm256_sub_ps(one, _mm256_loadu_ps(topColor[3] + pixelIndex));
+    for (int channel = 0; channel < 4; ++channel) {
+      __m256 top = _mm256_loadu_ps(topColor[channel] + pixelIndex);
+      __m256 bottom = _mm256_loadu_ps(bottomColor[channel] + pixelIndex);
+      _mm256_storeu_ps(outColor[channel] + pixelIndex,
+                       _mm256_add_ps(top, _mm256_mul_ps(bottom, scale)));
+    }
+  }
+  overBlendRGBAFloatPlanarScalar(
+      topColor, bottomColor, outColor, pixelIndex, numPixels);
+}
+
+// -----------------------------------------------------------------------------
+// AVX-512 implementations. 16 pixels per iteration. The remainder is handled
+// with masked loads and stores rather than the scalar code.
+
+MINIGRAPHICS_SIMD_TARGET("avx512f")
+static void depthBlendRGBAUByteAVX512(const unsigned int* topColor,
+                                      const float* topDepth,
+                                      const unsigned int* bottomColor,
+                                      const float* bottomDepth,
+                                      unsigned int* outColor,
+                                      float* outDepth,
+                                      int numPixels) {
+  for (int pixelIndex = 0; pixelIndex < numPixels; pixelIndex += 16) {
+    int remaining = numPixels - pixelIndex;
+    __mmask16 valid = (remaining >= 16)
+                          ? static_cast<__mmask16>(0xFFFF)
+                          : static_cast<__mmask16>((1u << remaining) - 1);
+    __m512 top = _mm512_maskz_loadu_ps(valid, topDepth + pixelIndex);
+    __m512 bottom = _mm512_maskz_loadu_ps(valid, bottomDepth + pixelIndex);
+    __mmask16 useBottom = _mm512_cmp_ps_mask(bottom, top, _CMP_LT_OQ);
+    __m512i topC = _mm512_maskz_loadu_epi32(valid, topColor + pixelIndex);
+    __m512i bottomC =
+        _mm512_maskz_loadu_epi32(valid, bottomColor + pixelIndex);
+    _mm512_mask_storeu_ps(outDepth + pixelIndex,
+                          valid,
+                          _mm512_mask_blend_ps(useBottom, top, bottom));
+    _mm512_mask_storeu_epi32(outColor + pixelIndex,
+                             valid,
+                             _mm512_mask_blend_epi32(useBottom, topC, bottomC));
+  }
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx512f")
+static void depthBlendRGBFloatAVX512(const float* topColor,
+                                     const float* topDepth,
+                                     const float* bottomColor,
+                                     const float* bottomDepth,
+                                     float* outColor,
+                                     float* outDepth,
+                                     int numPixels) {
+  // Maps each of the 48 color components of 16 pixels to its pixel.
+  const __m512i expand[3] = {
+      _mm512_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5),
+      _mm512_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10),
+      _mm512_setr_epi32(
+          10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15)};
+  const __m512i allOnes = _mm512_set1_epi32(-1);
+  int pixelIndex = 0;
+  for (; pixelIndex + 16 <= numPixels; pixelIndex += 16) {
+    __m512 top = _mm512_loadu_ps(topDepth + pixelIndex);
+    __m512 bottom = _mm512_loadu_ps(bottomDepth + pixelIndex);
+    __mmask16 useBottom = _mm512_cmp_ps_mask(bottom, top, _CMP_LT_OQ);
+    _mm512_storeu_ps(outDepth + pixelIndex,
+                     _mm512_mask_blend_ps(useBottom, top, bottom));
+    __m512i pixelMask = _mm512_maskz_mov_epi32(useBottom, allOnes);
+    for (int part = 0; part < 3; ++part) {
+      int offset = 3 * pixelIndex + 16 * part;
+      __m512i expanded = _mm512_permutexvar_epi32(expand[part], pixelMask);
+      __mmask16 mask = _mm512_test_epi32_mask(expanded, expanded);
+      __m512 topC = _mm512_loadu_ps(topColor + offset);
+      __m512 bottomC = _mm512_loadu_ps(bottomColor + offset);
+      _mm512_storeu_ps(outColor + offset,
+                       _mm512_mask_blend_ps(mask, topC, bottomC));
+    }
+  }
+  depthBlendRGBFloatAVX2(topColor + 3 * pixelIndex,
+                         topDepth + pixelIndex,
+                         bottomColor + 3 * pixelIndex,
+                         bottomDepth + pixelIndex,
+                         outColor + 3 * pixelIndex,
+                         outDepth + pixelIndex,
+                         numPixels - pixelIndex);
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx512f,avx512bw")
+static inline __m512i scaleByInverseAlphaAVX512(__m512i top16,
+                                                __m512i bottom16) {
+  __m512i alpha = _mm512_shufflehi_epi16(
+      _mm512_shufflelo_epi16(top16, _MM_SHUFFLE(3, 3, 3, 3)),
+      _MM_SHUFFLE(3, 3, 3, 3));
+  __m512i scale = _mm512_sub_epi16(_mm512_set1_epi16(255), alpha);
+  __m512i scaled = _mm512_add_epi16(_mm512_mullo_epi16(bottom16, scale),
+                                    _mm512_set1_epi16(128));
+  return _mm512_srli_epi16(
+      _mm512_add_epi16(scaled, _mm512_srli_epi16(scaled, 8)), 8);
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx512f,avx512bw")
+static void overBlendRGBAUByteAVX512(const unsigned int* topColor,
+                                     const unsigned int* bottomColor,
+                                     unsigned int* outColor,
+                                     int numPixels) {
+  const __m512i zero = _mm512_setzero_si512();
+  for (int pixelIndex = 0; pixelIndex < numPixels; pixelIndex += 16) {
+    int remaining = numPixels - pixelIndex;
+    __mmask16 valid = (remaining >= 16)
+                          ? static_cast<__mmask16>(0xFFFF)
+                          : static_cast<__mmask16>((1u << remaining) - 1);
+    __m512i top = _mm512_maskz_loadu_epi32(valid, topColor + pixelIndex);
+    __m512i bottom = _mm512_maskz_loadu_epi32(valid, bottomColor + pixelIndex);
+    __m512i scaledLow = scaleByInverseAlphaAVX512(
+        _mm512_unpacklo_epi8(top, zero), _mm512_unpacklo_epi8(bottom, zero));
+    __m512i scaledHigh = scaleByInverseAlphaAVX512(
+        _mm512_unpackhi_epi8(top, zero), _mm512_unpackhi_epi8(bottom, zero));
+    __m512i scaled = _mm512_packus_epi16(scaledLow, scaledHigh);
+    _mm512_mask_storeu_epi32(
+        outColor + pixelIndex, valid, _mm512_adds_epu8(top, scaled));
+  }
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx512f")
+static void overBlendRGBAFloatAVX512(const float* topColor,
+                                     const float* bottomColor,
+                                     float* outColor,
+                                     int numPixels) {
+  const __m512 one = _mm512_set1_ps(1.0f);
+  for (int pixelIndex = 0; pixelIndex < numPixels; pixelIndex += 4) {
+    int remaining = numPixels - pixelIndex;
+    __mmask16 valid = (remaining >= 4)
+                          ? static_cast<__mmask16>(0xFFFF)
+                          : static_cast<__mmask16>((1u << (4 * remaining)) - 1);
+    __m512 top = _mm512_maskz_loadu_ps(valid, topColor + 4 * pixelIndex);
+    __m512 bottom = _mm512_maskz_loadu_ps(valid, bottomColor + 4 * pixelIndex);
+    __m512 alpha = _mm512_permute_ps(top, _MM_SHUFFLE(3, 3, 3, 3));
+    _mm512_mask_storeu_ps(
+        outColor + 4 * pixelIndex,
+        valid,
+        _mm512_add_ps(top, _mm512_mul_ps(bottom, _mm512_sub_ps(one, alpha))));
+  }
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx512f")
+static void depthBlendFloatPlanarAVX512(const float* const* topColor,
+                                        const float* topDepth,
+                                        const float* const* bottomColor,
+                                        const float* bottomDepth,
+                                        float* const* outColor,
+                                        float* outDepth,
+                                        int numChannels,
+                                        int numPixels) {
+  for (int pixelIndex = 0; pixelIndex < numPixels; pixelIndex += 16) {
+    int remaining = numPixels - pixelIndex;
+    __mmask16 valid = (remaining >= 16)
+                          ? static_cast<__mmask16>(0xFFFF)
+                          : static_cast<__mmask16>((1u << remaining) - 1);
+    __m512 top = _mm512_maskz_loadu_ps(valid, topDepth + pixelIndex);
+    __m512 bottom = _mm512_maskz_loadu_ps(valid, bottomDepth + pixelIndex);
+    __mmask16 useBottom = _mm512_cmp_ps_mask(bottom, top, _CMP_LT_OQ);
+    for (int channel = 0; channel < numChannels; ++channel) {
+      __m512 topC =
+          _mm512_maskz_loadu_ps(valid, topColor[channel] + pixelIndex);
+      __m512 bottomC =
+          _mm512_maskz_loadu_ps(valid, bottomColor[channel] + pixelIndex);
+      _mm512_mask_storeu_ps(outColor[channel] + pixelIndex,
+                            valid,
+                            _mm512_mask_blend_ps(useBottom, topC, bottomC));
+    }
+    _mm512_mask_storeu_ps(outDepth + pixelIndex,
+                          valid,
+                          _mm512_mask_blend_ps(useBottom, top, bottom));
+  }
+}
+
+MINIGRAPHICS_SIMD_TARGET("avx512f")
+static void overBlendRGBAFloatPlanarAVX512(const float* const* topColor,
+                                           const float* const* bottomColor,
+                                           float* const* outColor,
+                                           int numPixels) {
+  const __m512 one = _mm512_set1_ps(1.0f);
+  for (int pixelIndex = 0; pixelIndex < numPixels; pixelIndex += 16) {
+    int remaining = numPixels - pixelIndex;
+    __mmask16 valid = (remaining >= 16)
+                          ? static_cast<__mmask16>(0xFFFF)
+                          : static_cast<__mmask16>((1u << remaining) - 1);
+    __m512 scale = _mm512_sub_ps(
+        one, _mm512_maskz_loadu_ps(valid, topColor[3] + pixelIndex));
+    for (int channel = 0; channel < 4; ++channel) {
+      __m512 top =
+          _mm512_maskz_loadu_ps(valid, topColor[channel] + pixelIndex);
+      __m512 bottom =
+          _mm512_maskz_loadu_ps(valid, bottomColor[channel] + pixelIndex);
+      _mm512_mask_storeu_ps(outColor[channel] + pixelIndex,
+                            valid,
+                            _mm512_add_ps(top, _mm512_mul_ps(bottom, scale)));
+    }
+  }
+}
+
+#endif  // MINIGRAPHICS_SIMD_X86
+
+// -----------------------------------------------------------------------------
+// Dispatch
+
+void depthBlendRGBAUByte(const unsigned int* topColor,
+                         const float* topDepth,
+                         const unsigned int* bottomColor,
+                         const float* bottomDepth,
+                         unsigned int* outColor,
+                         float* outDepth,
+                         int numPixels) {
+  switch (getSimdLevel()) {
+#ifdef MINIGRAPHICS_SIMD_X86
+    case SIMD_AVX512:
+      depthBlendRGBAUByteAVX512(topColor,
+                                topDepth,
+                                bottomColor,
+                                bottomDepth,
+                                outColor,
+                                outDepth,
+                                numPixels);
+      return;
+    case SIMD_AVX2:
+      depthBlendRGBAUByteAVX2(topColor,
+                              topDepth,
+                              bottomColor,
+                              bottomDepth,
+                              outColor,
+                              outDepth,
+                              numPixels);
+      return;
+    case SIMD_SSE2:
+      depthBlendRGBAUByteSSE2(topColor,
+                              topDepth,
+                              bottomColor,
+                              bottomDepth,
+                              outColor,
+                              outDepth,
+                              numPixels);
+      return;
+#endif
+    default:
+      depthBlendRGBAUByteScalar(topColor,
+                                topDepth,
+                                bottomColor,
+                                bottomDepth,
+                                outColor,
+                                outDepth,
+                                numPixels);
+      return;
+  }
+}
+
+void depthBlendRGBFloat(const float* topColor,
+                        const float* topDepth,
+                        const float* bottomColor,
+                        const float* bottomDepth,
+                        float* outColor,
+                        float* outDepth,
+                        int numPixels) {
+  switch (getSimdLevel()) {
+#ifdef MINIGRAPHICS_SIMD_X86
+    case SIMD_AVX512:
+      depthBlendRGBFloatAVX512(topColor,
+                               topDepth,
+                               bottomColor,
+                               bottomDepth,
+                               outColor,
+                               outDepth,
+                               numPixels);
+      return;
+    case SIMD_AVX2:
+      depthBlendRGBFloatAVX2(topColor,
+                             topDepth,
+                             bottomColor,
+                             bottomDepth,
+                             outColor,
+                             outDepth,
+                             numPixels);
+      return;
+    case SIMD_SSE2:
+      depthBlendRGBFloatSSE2(topColor,
+                             topDepth,
+                             bottomColor,
+                             bottomDepth,
+                             outColor,
+                             outDepth,
+                             numPixels);
+      return;
+#endif
+    default:
+      depthBlendRGBFloatScalar(topColor,
+                               topDepth,
+                               bottomColor,
+                               bottomDepth,
+                               outColor,
+                               outDepth,
+                               numPixels);
+      return;
+  }
+}
+
+void overBlendRGBAUByte(const unsigned int* topColor,
+                        const unsigned int* bottomColor,
+                        unsigned int* outColor,
+                        int numPixels) {
+  switch (getSimdLevel()) {
+#ifdef MINIGRAPHICS_SIMD_X86
+    case SIMD_AVX512:
+      overBlendRGBAUByteAVX512(topColor, bottomColor, outColor, numPixels);
+      return;
+    case SIMD_AVX2:
+      overBlendRGBAUByteAVX2(topColor, bottomColor, outColor, numPixels);
+      return;
+    case SIMD_SSE2:
+      overBlendRGBAUByteSSE2(topColor, bottomColor, outColor, numPixels);
+      return;
+#endif
+    default:
+      overBlendRGBAUByteScalar(topColor, bottomColor, outColor, numPixels);
+      return;
+  }
+}
+
+void overBlendRGBAFloat(const float* topColor,
+                        const float* bottomColor,
+                        float* outColor,
+                        int numPixels) {
+  switch (getSimdLevel()) {
+#ifdef MINIGRAPHICS_SIMD_X86
+    case SIMD_AVX512:
+      overBlendRGBAFloatAVX512(topColor, bottomColor, outColor, numPixels);
+      return;
+    case SIMD_AVX2:
+      overBlendRGBAFloatAVX2(topColor, bottomColor, outColor, numPixels);
+      return;
+    case SIMD_SSE2:
+      overBlendRGBAFloatSSE2(topColor, bottomColor, outColor, numPixels);
+      return;
+#endif
+    default:
+      overBlendRGBAFloatScalar(topColor, bottomColor, outColor, numPixels);
+      return;
+  }
+}
+
+void overBlendRGBAHalf(const Half* topColor,
+                       const Half* bottomColor,
+                       Half* outColor,
+                       int numPixels) {
+  // Small enough to stay in L1 cache.
+  constexpr int BATCH_PIXELS = 256;
+  float topBatch[4 * BATCH_PIXELS];
+  float bottomBatch[4 * BATCH_PIXELS];
+  for (int pixelIndex = 0; pixelIndex < numPixels;
+       pixelIndex += BATCH_PIXELS) {
+    int batchSize = std::min(BATCH_PIXELS, numPixels - pixelIndex);
+    halfToFloat(topColor + 4 * pixelIndex, topBatch, 4 * batchSize);
+    halfToFloat(bottomColor + 4 * pixelIndex, bottomBatch, 4 * batchSize);
+    overBlendRGBAFloat(topBatch, bottomBatch, bottomBatch, batchSize);
+    floatToHalf(bottomBatch, outColor + 4 * pixelIndex, 4 * batchSize);
+  }
+}
+
+void depthBlendFloatPlanar(const float* const* topColor,
+                           const float* topDepth,
+                           const float* const* bottomColor,
+                           const float* bottomDepth,
+                           float* const* outColor,
+                           float* outDepth,
+                           int numChannels,
+                           int numPixels) {
+  switch (getSimdLevel()) {
+#ifdef MINIGRAPHICS_SIMD_X86
+    case SIMD_AVX512:
+      depthBlendFloatPlanarAVX512(topColor,
+                                  topDepth,
+                                  bottomColor,
+                                  bottomDepth,
+                                  outColor,
+                                  outDepth,
+                                  numChannels,
+                                  numPixels);
+      return;
+    case SIMD_AVX2:
+      depthBlendFloatPlanarAVX2(topColor,
+                                topDepth,
+                                bottomColor,
+                                bottomDepth,
+                                outColor,
+                                outDepth,
+                                numChannels,
+                                numPixels);
+      return;
+    case SIMD_SSE2:
+      depthBlendFloatPlanarSSE2(topColor,
+                                topDepth,
+                                bottomColor,
+                                bottomDepth,
+                                outColor,
+                                outDepth,
+                                numChannels,
+                                numPixels);
+      return;
+#endif
+    default:
+      depthBlendFloatPlanarScalar(topColor,
+                                  topDepth,
+                                  bottomColor,
+                                  bottomDepth,
+                                  outColor,
+                                  outDepth,
+                                  numChannels,
+                                  0,
+                                  numPixels);
+      return;
+  }
+}
+
+void overBlendRGBAFloatPlanar(const float* const* topColor,
+                              const float* const* bottomColor,
+                              float* const* outColor,
+                              int numPixels) {
+  switch (getSimdLevel()) {
+#ifdef MINIGRAPHICS_SIMD_X86
+    case SIMD_AVX512:
+      overBlendRGBAFloatPlanarAVX512(
+          topColor, bottomColor, outColor, numPixels);
+      return;
+    case SIMD_AVX2:
+      overBlendRGBAFloatPlanarAVX2(topColor, bottomColor, outColor, numPixels);
+      return;
+    case SIMD_SSE2:
+      overBlendRGBAFloatPlanarSSE2(topColor, bottomColor, outColor, numPixels);
+      return;
+#endif
+    default:
+      overBlendRGBAFloatPlanarScalar(
+          topColor, bottomColor, outColor, 0, numPixels);
+      return;
+  }
+}
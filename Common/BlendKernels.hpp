@@ -0,0 +1,156 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef BLENDKERNELS_HPP
+#define BLENDKERNELS_HPP
+
+// Batched pixel blending kernels used by the image classes. Each kernel
+// blends a contiguous span of pixels and picks the fastest implementation for
+// the running CPU (see SimdDispatch.hpp).
+//
+// For all kernels, the output arrays may be the same as (but must not
+// otherwise overlap) either of the input arrays.
+
+#include "Half.hpp"
+
+#include <algorithm>
+
+/// \brief Z-buffer blend for packed 8-bit RGBA colors with float depth.
+///
+/// For each pixel, the bottom pixel is chosen if its depth is strictly less
+/// than the top pixel. Otherwise the top pixel is chosen.
+///
+void depthBlendRGBAUByte(const unsigned int* topColor,
+                         const float* topDepth,
+                         const unsigned int* bottomColor,
+                         const float* bottomDepth,
+                         unsigned int* outColor,
+                         float* outDepth,
+                         int numPixels);
+
+/// \brief Z-buffer blend for 3-component float colors with float depth.
+///
+/// For each pixel, the bottom pixel is chosen if its depth is strictly less
+/// than the top pixel. Otherwise the top pixel is chosen.
+///
+void depthBlendRGBFloat(const float* topColor,
+                        const float* topDepth,
+                        const float* bottomColor,
+                        const float* bottomDepth,
+                        float* outColor,
+                        float* outDepth,
+                        int numPixels);
+
+/// \brief Porter-Duff over for premultiplied 8-bit RGBA colors.
+///
+/// Each output component is top + bottom * (1 - topAlpha), computed in 8-bit
+/// fixed point and clamped to 255.
+///
+void overBlendRGBAUByte(const unsigned int* topColor,
+                        const unsigned int* bottomColor,
+                        unsigned int* outColor,
+                        int numPixels);
+
+/// \brief Porter-Duff over for premultiplied 4-component float colors.
+///
+/// Each output component is top + bottom * (1 - topAlpha).
+///
+void overBlendRGBAFloat(const float* topColor,
+                        const float* bottomColor,
+                        float* outColor,
+                        int numPixels);
+
+/// \brief Porter-Duff over for premultiplied 4-component half colors.
+///
+/// The colors are converted to float in small batches, blended with
+/// overBlendRGBAFloat, and converted back.
+///
+void overBlendRGBAHalf(const Half* topColor,
+                       const Half* bottomColor,
+                       Half* outColor,
+                       int numPixels);
+
+/// \brief Z-buffer blend for float colors stored in planar layout with float
+/// depth.
+///
+/// Each of topColor, bottomColor, and outColor points to numChannels arrays,
+/// one for each color channel. For each pixel, the bottom pixel is chosen if
+/// its depth is strictly less than the top pixel. Otherwise the top pixel is
+/// chosen.
+///
+void depthBlendFloatPlanar(const float* const* topColor,
+                           const float* topDepth,
+                           const float* const* bottomColor,
+                           const float* bottomDepth,
+                           float* const* outColor,
+                           float* outDepth,
+                           int numChannels,
+                           int numPixels);
+
+/// \brief Porter-Duff over for premultiplied float RGBA colors stored in
+/// planar layout.
+///
+/// Each of topColor, bottomColor, and outColor points to 4 arrays holding the
+/// R, G, B, and A channels. Each output component is top + bottom * (1 -
+/// topAlpha).
+///
+void overBlendRGBAFloatPlanar(const float* const* topColor,
+                              const float* const* bottomColor,
+                              float* const* outColor,
+                              int numPixels);
+
+/// \brief Generic z-buffer blend using the closer function of a features
+/// structure (see ImageColorDepth.hpp).
+///
+/// This is the reference implementation for the vectorized kernels and can be
+/// used by image types that do not have a specialized kernel.
+///
+template <typename Features>
+void depthBlendGeneric(const typename Features::ColorType* topColor,
+                       const typename Features::DepthType* topDepth,
+                       const typename Features::ColorType* bottomColor,
+                       const typename Features::DepthType* bottomDepth,
+                       typename Features::ColorType* outColor,
+                       typename Features::DepthType* outDepth,
+                       int numPixels) {
+  constexpr int ColorVecSize = Features::ColorVecSize;
+  for (int pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
+    if (Features::closer(bottomDepth[pixelIndex], topDepth[pixelIndex])) {
+      std::copy(bottomColor + pixelIndex * ColorVecSize,
+                bottomColor + (pixelIndex + 1) * ColorVecSize,
+                outColor + pixelIndex * ColorVecSize);
+      outDepth[pixelIndex] = bottomDepth[pixelIndex];
+    } else {
+      std::copy(topColor + pixelIndex * ColorVecSize,
+                topColor + (pixelIndex + 1) * ColorVecSize,
+                outColor + pixelIndex * ColorVecSize);
+      outDepth[pixelIndex] = topDepth[pixelIndex];
+    }
+  }
+}
+
+/// \brief Generic over blend using the blend function of a features structure
+/// (see ImageColorOnly.hpp).
+///
+/// This is the reference implementation for the vectorized kernels and can be
+/// used by image types that do not have a specialized kernel.
+///
+template <typename Features>
+void overBlendGeneric(const typename Features::ColorType* topColor,
+                      const typename Features::ColorType* bottomColor,
+                      typename Features::ColorType* outColor,
+                      int numPixels) {
+  constexpr int ColorVecSize = Features::ColorVecSize;
+  for (int pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
+    Features::blend(topColor + pixelIndex * ColorVecSize,
+                    bottomColor + pixelIndex * ColorVecSize,
+                    outColor + pixelIndex * ColorVecSize);
+  }
+}
+
+#endif  // BLENDKERNELS_HPP
@@ -0,0 +1,103 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include "BufferPool.hpp"
+
+#include <map>
+#include <new>
+
+namespace {
+
+struct PoolState {
+  std::mutex mutex;
+  bool enabled;
+  BufferPoolStatistics statistics;
+  // Free blocks for shared_ptr control blocks, keyed by size in bytes.
+  std::map<std::size_t, std::vector<void*>> freeBlocks;
+
+  PoolState() : enabled(true), statistics{0, 0} {}
+};
+
+PoolState& getState() {
+  // Intentionally never deleted (see getFreeBuffers).
+  static PoolState* state = new PoolState;
+  return *state;
+}
+
+}  // anonymous namespace
+
+void setBufferPoolEnabled(bool enabled) {
+  std::lock_guard<std::mutex> lock(getState().mutex);
+  getState().enabled = enabled;
+}
+
+bool getBufferPoolEnabled() {
+  std::lock_guard<std::mutex> lock(getState().mutex);
+  return getState().enabled;
+}
+
+BufferPoolStatistics getBufferPoolStatistics() {
+  std::lock_guard<std::mutex> lock(getState().mutex);
+  return getState().statistics;
+}
+
+void resetBufferPoolStatistics() {
+  std::lock_guard<std::mutex> lock(getState().mutex);
+  getState().statistics.hits = 0;
+  getState().statistics.misses = 0;
+}
+
+namespace BufferPoolDetail {
+
+std::mutex& getMutex() { return getState().mutex; }
+
+void recordHit() {
+  std::lock_guard<std::mutex> lock(getState().mutex);
+  ++getState().statistics.hits;
+}
+
+void recordMiss() {
+  std::lock_guard<std::mutex> lock(getState().mutex);
+  ++getState().statistics.misses;
+}
+
+int bucketForSize(std::size_t numElements) {
+  int bucket = 0;
+  while ((std::size_t(1) << bucket) < numElements) {
+    ++bucket;
+  }
+  return bucket;
+}
+
+int bucketForCapacity(std::size_t capacity) {
+  int bucket = 0;
+  while ((std::size_t(2) << bucket) <= capacity) {
+    ++bucket;
+  }
+  return bucket;
+}
+
+void* allocateBlock(std::size_t numBytes) {
+  {
+    std::lock_guard<std::mutex> lock(getState().mutex);
+    std::vector<void*>& freeList = getState().freeBlocks[numBytes];
+    if (!freeList.empty()) {
+      void* block = freeList.back();
+      freeList.pop_back();
+      return block;
+    }
+  }
+  return ::operator new(numBytes);
+}
+
+void deallocateBlock(void* block, std::size_t numBytes) {
+  std::lock_guard<std::mutex> lock(getState().mutex);
+  getState().freeBlocks[numBytes].push_back(block);
+}
+
+}  // namespace BufferPoolDetail
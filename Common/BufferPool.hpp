@@ -0,0 +1,188 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef BUFFERPOOL_HPP
+#define BUFFERPOOL_HPP
+
+// A per-process pool of the vectors that hold image pixels. Images get their
+// buffers with acquirePooledBuffer, and when the last image using a buffer
+// lets go of it, the buffer goes back in the pool rather than being freed.
+// Buffers are bucketed by capacity in powers of two. The shared_ptr control
+// blocks are also recycled, so once the pool holds buffers for all the sizes
+// a compositing pass needs, getting and releasing buffers does not touch the
+// heap.
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct BufferPoolStatistics {
+  /// Number of buffers handed out that came from the pool.
+  long hits;
+  /// Number of buffers handed out that had to be allocated.
+  long misses;
+};
+
+/// \brief Turns the buffer pool on or off. It is on by default.
+///
+/// When off, acquirePooledBuffer simply allocates a new buffer. Buffers
+/// already in the pool stay there.
+void setBufferPoolEnabled(bool enabled);
+
+bool getBufferPoolEnabled();
+
+/// \brief Returns the hits and misses since the last reset.
+BufferPoolStatistics getBufferPoolStatistics();
+
+void resetBufferPoolStatistics();
+
+namespace BufferPoolDetail {
+
+std::mutex& getMutex();
+void recordHit();
+void recordMiss();
+
+// Returns the index of the smallest power of two at least numElements.
+int bucketForSize(std::size_t numElements);
+// Returns the index of the largest power of two no more than capacity.
+int bucketForCapacity(std::size_t capacity);
+
+// Fixed size blocks of memory that are recycled rather than freed. Used for
+// the shared_ptr control blocks.
+void* allocateBlock(std::size_t numBytes);
+void deallocateBlock(void* block, std::size_t numBytes);
+
+template <typename U>
+struct BlockAllocator {
+  using value_type = U;
+
+  BlockAllocator() = default;
+  template <typename V>
+  BlockAllocator(const BlockAllocator<V>&) {}
+
+  U* allocate(std::size_t n) {
+    return static_cast<U*>(allocateBlock(n * sizeof(U)));
+  }
+  void deallocate(U* block, std::size_t n) {
+    deallocateBlock(block, n * sizeof(U));
+  }
+};
+
+template <typename U, typename V>
+bool operator==(const BlockAllocator<U>&, const BlockAllocator<V>&) {
+  return true;
+}
+template <typename U, typename V>
+bool operator!=(const BlockAllocator<U>&, const BlockAllocator<V>&) {
+  return false;
+}
+
+template <typename BufferType>
+struct FreeBuffers {
+  // Indexed by bucket.
+  std::vector<std::vector<BufferType*>> buckets;
+};
+
+template <typename BufferType>
+FreeBuffers<BufferType>& getFreeBuffers() {
+  // Intentionally never deleted so that buffers released during static
+  // destruction still have somewhere to go.
+  static FreeBuffers<BufferType>* freeBuffers = new FreeBuffers<BufferType>;
+  return *freeBuffers;
+}
+
+template <typename BufferType>
+struct ReturnToPool {
+  void operator()(BufferType* buffer) const {
+    buffer->clear();
+    int bucket = bucketForCapacity(buffer->capacity());
+    std::lock_guard<std::mutex> lock(getMutex());
+    FreeBuffers<BufferType>& freeBuffers = getFreeBuffers<BufferType>();
+    if (static_cast<int>(freeBuffers.buckets.size()) <= bucket) {
+      freeBuffers.buckets.resize(bucket + 1);
+    }
+    freeBuffers.buckets[bucket].push_back(buffer);
+  }
+};
+
+}  // namespace BufferPoolDetail
+
+/// \brief Returns a buffer with the given number of elements.
+///
+/// The contents of the buffer are value initialized. The capacity of the
+/// buffer will be at least \c minCapacity. When the returned shared_ptr (and
+/// all copies) are destroyed, the buffer goes back into the pool. Buffers
+/// with different allocators are kept in separate pools.
+template <typename T, typename Allocator = std::allocator<T>>
+std::shared_ptr<std::vector<T, Allocator>> acquirePooledBuffer(
+    std::size_t size, std::size_t minCapacity = 0) {
+  using namespace BufferPoolDetail;
+  using BufferType = std::vector<T, Allocator>;
+
+  if (!getBufferPoolEnabled()) {
+    std::shared_ptr<BufferType> buffer(new BufferType);
+    buffer->reserve(minCapacity);
+    buffer->resize(size);
+    return buffer;
+  }
+
+  int bucket = bucketForSize((size > minCapacity) ? size : minCapacity);
+  BufferType* buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(getMutex());
+    FreeBuffers<BufferType>& freeBuffers = getFreeBuffers<BufferType>();
+    if ((bucket < static_cast<int>(freeBuffers.buckets.size())) &&
+        !freeBuffers.buckets[bucket].empty()) {
+      buffer = freeBuffers.buckets[bucket].back();
+      freeBuffers.buckets[bucket].pop_back();
+    }
+  }
+
+  if (buffer != nullptr) {
+    recordHit();
+  } else {
+    recordMiss();
+    buffer = new BufferType;
+    buffer->reserve(std::size_t(1) << bucket);
+  }
+  buffer->resize(size);
+
+  return std::shared_ptr<BufferType>(
+      buffer, ReturnToPool<BufferType>(), BlockAllocator<BufferType>());
+}
+
+/// \brief Resizes a buffer, replacing it from the pool if necessary.
+///
+/// If the buffer is not shared with anyone else and has enough capacity, it
+/// is resized in place (so shrinking keeps the leading elements). Otherwise,
+/// it is replaced with a buffer from the pool, and the contents are not
+/// kept. A null buffer is also replaced.
+template <typename T, typename Allocator>
+void resizePooledBuffer(std::shared_ptr<std::vector<T, Allocator>>& buffer,
+                        std::size_t size) {
+  if (buffer && (buffer.use_count() == 1) && (buffer->capacity() >= size)) {
+    buffer->resize(size);
+  } else {
+    buffer = acquirePooledBuffer<T, Allocator>(size);
+  }
+}
+
+/// \brief Makes sure a buffer can grow to the given size without allocating.
+///
+/// If the buffer is shared with anyone else or does not have enough
+/// capacity, it is replaced with an empty buffer from the pool.
+template <typename T, typename Allocator>
+void reservePooledBuffer(std::shared_ptr<std::vector<T, Allocator>>& buffer,
+                         std::size_t capacity) {
+  if (!buffer || (buffer.use_count() > 1) || (buffer->capacity() < capacity)) {
+    buffer = acquirePooledBuffer<T, Allocator>(0, capacity);
+  }
+}
+
+#endif  // BUFFERPOOL_HPP
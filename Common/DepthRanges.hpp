@@ -0,0 +1,324 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef DEPTHRANGES_HPP
+#define DEPTHRANGES_HPP
+
+#include "BufferPool.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/// Number of consecutive pixels summarized by one depth range. Blocks are
+/// aligned to pixel indices of the full image so that the blocks of images
+/// covering the same pixels line up.
+constexpr int DEPTH_RANGE_BLOCK_SIZE = 64;
+
+/// Which image of a depth blend wins over a span of pixels.
+enum DepthOrder { DEPTH_ORDER_TOP, DEPTH_ORDER_BOTTOM, DEPTH_ORDER_MIXED };
+
+/// \brief Nearest and farthest depth of each block of a depth buffer.
+///
+/// DepthRanges is a coarse (hierarchical) summary of a depth buffer. When the
+/// depth ranges of two blocks do not overlap, a depth blend of those blocks
+/// is just a copy of the nearer one, so no per-pixel comparisons are needed.
+///
+/// The ranges are held in a shared buffer so that images sharing a depth
+/// buffer (shallow copies and windows) also share its summary. Blocks are
+/// located by global pixel index, so most methods take the pixel index of
+/// the first element of the depth buffer (the buffer base). Ranges start
+/// unknown and are computed when first needed. Code that writes depths must
+/// either invalidate the blocks it touches or set them itself.
+///
+/// The Features template argument is the same as for ImageColorDepth.
+///
+template <typename Features>
+class DepthRanges {
+ public:
+  using DepthType = typename Features::DepthType;
+
+  struct Range {
+    DepthType nearest;
+    DepthType farthest;
+  };
+
+ private:
+  using RangeBufferType = std::vector<Range>;
+
+  std::shared_ptr<RangeBufferType> ranges;
+
+  static int blockOf(int pixel) { return pixel / DEPTH_RANGE_BLOCK_SIZE; }
+
+  static int entryOf(int bufferBase, int element) {
+    return blockOf(bufferBase + element) - blockOf(bufferBase);
+  }
+
+  // First buffer element of the given entry (may be negative).
+  static int entryBegin(int bufferBase, int entry) {
+    return (blockOf(bufferBase) + entry) * DEPTH_RANGE_BLOCK_SIZE - bufferBase;
+  }
+
+  static const DepthType& nearer(const DepthType& a, const DepthType& b) {
+    return Features::closer(b, a) ? b : a;
+  }
+
+  static const DepthType& farther(const DepthType& a, const DepthType& b) {
+    return Features::closer(a, b) ? b : a;
+  }
+
+  // Sets the ranges of the blocks of this buffer that lie entirely within
+  // elements [outElement, outElement + numPixels) using rangeOf(sourceOffset,
+  // range), which returns false if it cannot bound the pixels starting at
+  // that offset. Partly covered blocks become unknown.
+  template <typename RangeOf>
+  void setCoveredRanges(int outBase,
+                        int outBufferSize,
+                        int outElement,
+                        int numPixels,
+                        const RangeOf& rangeOf) {
+    if (!this->ranges || (numPixels < 1)) {
+      return;
+    }
+    int entryEnd = entryOf(outBase, outElement + numPixels - 1) + 1;
+    for (int entry = entryOf(outBase, outElement); entry < entryEnd; ++entry) {
+      int blockBegin = std::max(entryBegin(outBase, entry), 0);
+      int blockEnd = std::min(entryBegin(outBase, entry + 1), outBufferSize);
+      Range& range = (*this->ranges)[entry];
+      if ((blockBegin < outElement) ||
+          (blockEnd > outElement + numPixels) ||
+          !rangeOf(blockBegin - outElement, blockEnd - blockBegin, range)) {
+        range = unknownRange();
+      }
+    }
+  }
+
+  // Returns the range of the block holding all of [element, element + num),
+  // or false if those elements span blocks or the range is unknown.
+  bool rangeOfSpan(int bufferBase, int element, int num, Range& range) const {
+    int entry = entryOf(bufferBase, element);
+    if (!this->ranges || (entry != entryOf(bufferBase, element + num - 1))) {
+      return false;
+    }
+    range = (*this->ranges)[entry];
+    return isKnown(range);
+  }
+
+ public:
+  static Range unknownRange() {
+    // An inverted range (nearest farther than farthest) marks an unknown one.
+    DepthType zero;
+    DepthType one;
+    Features::encodeDepth(0.0f, &zero);
+    Features::encodeDepth(1.0f, &one);
+    Range range;
+    range.nearest = farther(zero, one);
+    range.farthest = nearer(zero, one);
+    return range;
+  }
+
+  static bool isKnown(const Range& range) {
+    return !Features::closer(range.farthest, range.nearest);
+  }
+
+  /// Returns which image wins a depth blend everywhere in two blocks. Ties
+  /// go to the top image to match depthBlendGeneric.
+  static DepthOrder compare(const Range& top, const Range& bottom) {
+    if (!isKnown(top) || !isKnown(bottom)) {
+      return DEPTH_ORDER_MIXED;
+    } else if (!Features::closer(bottom.nearest, top.farthest)) {
+      return DEPTH_ORDER_TOP;
+    } else if (Features::closer(bottom.farthest, top.nearest)) {
+      return DEPTH_ORDER_BOTTOM;
+    } else {
+      return DEPTH_ORDER_MIXED;
+    }
+  }
+
+  /// Number of entries needed for the global pixels [pixelBegin, pixelEnd).
+  static int numberOfBlocks(int pixelBegin, int pixelEnd) {
+    return (pixelBegin < pixelEnd)
+               ? (blockOf(pixelEnd - 1) - blockOf(pixelBegin) + 1)
+               : 0;
+  }
+
+  /// Replaces the ranges with unknown ranges for a buffer of numElements
+  /// depths starting at any pixel. Ranges shared with another image are
+  /// replaced rather than overwritten.
+  void reset(int numElements) {
+    resizePooledBuffer(this->ranges,
+                       numElements / DEPTH_RANGE_BLOCK_SIZE + 2);
+    std::fill(this->ranges->begin(), this->ranges->end(), unknownRange());
+  }
+
+  void release() { this->ranges.reset(); }
+
+  /// Marks the blocks holding buffer elements [elementBegin, elementEnd)
+  /// unknown.
+  void invalidate(int bufferBase, int elementBegin, int elementEnd) {
+    if (!this->ranges || (elementBegin >= elementEnd)) {
+      return;
+    }
+    std::fill(this->ranges->begin() + entryOf(bufferBase, elementBegin),
+              this->ranges->begin() + entryOf(bufferBase, elementEnd - 1) + 1,
+              unknownRange());
+  }
+
+  /// Marks the block holding the given buffer element unknown.
+  void invalidate(int bufferBase, int element) {
+    if (this->ranges) {
+      (*this->ranges)[entryOf(bufferBase, element)] = unknownRange();
+    }
+  }
+
+  /// Computes any unknown ranges of the blocks holding buffer elements
+  /// [elementBegin, elementEnd). A block's range covers all of its elements
+  /// in the buffer, which may be more than the requested ones.
+  void update(int bufferBase,
+              const DepthType* depthBuffer,
+              int bufferSize,
+              int elementBegin,
+              int elementEnd) const {
+    if (!this->ranges || (elementBegin >= elementEnd)) {
+      return;
+    }
+    int firstEntry = entryOf(bufferBase, elementBegin);
+    int numEntries = entryOf(bufferBase, elementEnd - 1) + 1 - firstEntry;
+    RangeBufferType& rangeBuffer = *this->ranges;
+    parallelFor(numEntries,
+                MIN_PIXELS_PER_THREAD / DEPTH_RANGE_BLOCK_SIZE,
+                [&](int begin, int end) {
+                  for (int entry = firstEntry + begin;
+                       entry < firstEntry + end;
+                       ++entry) {
+                    if (isKnown(rangeBuffer[entry])) {
+                      continue;
+                    }
+                    int blockBegin =
+                        std::max(entryBegin(bufferBase, entry), 0);
+                    int blockEnd = std::min(
+                        entryBegin(bufferBase, entry + 1), bufferSize);
+                    Range range;
+                    range.nearest = range.farthest = depthBuffer[blockBegin];
+                    for (int i = blockBegin + 1; i < blockEnd; ++i) {
+                      range.nearest = nearer(range.nearest, depthBuffer[i]);
+                      range.farthest = farther(range.farthest, depthBuffer[i]);
+                    }
+                    rangeBuffer[entry] = range;
+                  }
+                });
+  }
+
+  /// Returns the ranges starting with the block holding the given element.
+  /// Used to send and receive the summary with the depth buffer.
+  Range* getRanges(int bufferBase, int element) {
+    return this->ranges->data() + entryOf(bufferBase, element);
+  }
+  const Range* getRanges(int bufferBase, int element) const {
+    return this->ranges->data() + entryOf(bufferBase, element);
+  }
+
+  /// \brief Splits a depth blend of numPixels pixels by depth order.
+  ///
+  /// Walks the pixels in pieces that each stay within one block of both
+  /// images and calls visit(offset, count, order) for each maximal run of
+  /// pieces with the same order. Offsets are relative to the given elements.
+  template <typename Visit>
+  static void forEachDepthOrder(const DepthRanges& top,
+                                int topBase,
+                                int topElement,
+                                const DepthRanges& bottom,
+                                int bottomBase,
+                                int bottomElement,
+                                int numPixels,
+                                const Visit& visit) {
+    if (!top.ranges || !bottom.ranges) {
+      visit(0, numPixels, DEPTH_ORDER_MIXED);
+      return;
+    }
+    int runBegin = 0;
+    DepthOrder runOrder = DEPTH_ORDER_MIXED;
+    int offset = 0;
+    while (offset < numPixels) {
+      int topPixel = topBase + topElement + offset;
+      int bottomPixel = bottomBase + bottomElement + offset;
+      int pieceSize = std::min(
+          std::min(DEPTH_RANGE_BLOCK_SIZE - topPixel % DEPTH_RANGE_BLOCK_SIZE,
+                   DEPTH_RANGE_BLOCK_SIZE -
+                       bottomPixel % DEPTH_RANGE_BLOCK_SIZE),
+          numPixels - offset);
+      DepthOrder order = compare(
+          (*top.ranges)[entryOf(topBase, topElement + offset)],
+          (*bottom.ranges)[entryOf(bottomBase, bottomElement + offset)]);
+      if ((order != runOrder) && (offset > runBegin)) {
+        visit(runBegin, offset - runBegin, runOrder);
+        runBegin = offset;
+      }
+      runOrder = order;
+      offset += pieceSize;
+    }
+    if (offset > runBegin) {
+      visit(runBegin, offset - runBegin, runOrder);
+    }
+  }
+
+  /// Sets the ranges for pixels copied from another buffer. Blocks only
+  /// partly copied become unknown.
+  void copyRanges(int outBase,
+                  int outBufferSize,
+                  int outElement,
+                  const DepthRanges& source,
+                  int sourceBase,
+                  int sourceElement,
+                  int numPixels) {
+    this->setCoveredRanges(
+        outBase,
+        outBufferSize,
+        outElement,
+        numPixels,
+        [&](int offset, int num, Range& range) {
+          return source.rangeOfSpan(
+              sourceBase, sourceElement + offset, num, range);
+        });
+  }
+
+  /// Sets the ranges for pixels written by a depth blend of two buffers.
+  /// Blocks only partly written become unknown.
+  void blendRanges(int outBase,
+                   int outBufferSize,
+                   int outElement,
+                   const DepthRanges& top,
+                   int topBase,
+                   int topElement,
+                   const DepthRanges& bottom,
+                   int bottomBase,
+                   int bottomElement,
+                   int numPixels) {
+    this->setCoveredRanges(
+        outBase,
+        outBufferSize,
+        outElement,
+        numPixels,
+        [&](int offset, int num, Range& range) {
+          Range topRange;
+          Range bottomRange;
+          if (!top.rangeOfSpan(topBase, topElement + offset, num, topRange) ||
+              !bottom.rangeOfSpan(
+                  bottomBase, bottomElement + offset, num, bottomRange)) {
+            return false;
+          }
+          // Every blended pixel is no farther than either input.
+          range.nearest = nearer(topRange.nearest, bottomRange.nearest);
+          range.farthest = nearer(topRange.farthest, bottomRange.farthest);
+          return true;
+        });
+  }
+};
+
+#endif  // DEPTHRANGES_HPP
@@ -0,0 +1,174 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include "Half.hpp"
+
+#include "SimdDispatch.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef MINIGRAPHICS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Scalar implementations. These give bit-identical results to F16C.
+
+static Half floatToHalfScalar(float value) {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  std::uint32_t sign = (bits >> 16) & 0x8000;
+  std::uint32_t absBits = bits & 0x7FFFFFFF;
+
+  if (absBits >= 0x7F800000) {
+    // Infinity or NaN. NaNs are quieted and keep their upper payload bits.
+    std::uint32_t nanBits =
+        (absBits > 0x7F800000) ? (0x200 | ((absBits >> 13) & 0x3FF)) : 0;
+    return static_cast<Half>(sign | 0x7C00 | nanBits);
+  }
+
+  if (absBits >= 0x477FF000) {
+    // 65520 and above rounds to infinity.
+    return static_cast<Half>(sign | 0x7C00);
+  }
+
+  if (absBits < 0x38800000) {
+    // Below the smallest normal half (2^-14). Anything at or below 2^-25
+    // rounds to zero.
+    if (absBits <= 0x33000000) {
+      return static_cast<Half>(sign);
+    }
+    std::uint32_t exponent = absBits >> 23;
+    std::uint32_t mantissa = (absBits & 0x7FFFFF) | 0x800000;
+    std::uint32_t shift = 126 - exponent;
+    std::uint32_t halfBits = mantissa >> shift;
+    std::uint32_t remainder = mantissa & ((1u << shift) - 1);
+    std::uint32_t halfway = 1u << (shift - 1);
+    if ((remainder > halfway) || ((remainder == halfway) && (halfBits & 1))) {
+      ++halfBits;
+    }
+    return static_cast<Half>(sign | halfBits);
+  }
+
+  // Normal number. Rebias the exponent and round the mantissa. A carry out of
+  // the mantissa correctly increments the exponent.
+  std::uint32_t halfBits = (absBits >> 13) - ((127 - 15) << 10);
+  std::uint32_t remainder = absBits & 0x1FFF;
+  if ((remainder > 0x1000) || ((remainder == 0x1000) && (halfBits & 1))) {
+    ++halfBits;
+  }
+  return static_cast<Half>(sign | halfBits);
+}
+
+static float halfToFloatScalar(Half value) {
+  std::uint32_t sign = static_cast<std::uint32_t>(value & 0x8000) << 16;
+  std::uint32_t exponent = (value >> 10) & 0x1F;
+  std::uint32_t mantissa = value & 0x3FF;
+
+  std::uint32_t bits;
+  if (exponent == 0x1F) {
+    // Infinity or NaN. NaNs are quieted.
+    bits = sign | 0x7F800000 | (mantissa << 13);
+    if (mantissa != 0) {
+      bits |= 0x400000;
+    }
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + (127 - 15)) << 23) | (mantissa << 13);
+  } else if (mantissa == 0) {
+    bits = sign;
+  } else {
+    // Subnormal half. Normalize it for the float representation.
+    exponent = 127 - 14;
+    while ((mantissa & 0x400) == 0) {
+      mantissa <<= 1;
+      --exponent;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+  }
+
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+// -----------------------------------------------------------------------------
+// F16C implementations.
+
+#ifdef MINIGRAPHICS_SIMD_X86
+
+MINIGRAPHICS_SIMD_TARGET("f16c")
+static void floatToHalfF16C(const float* values, Half* halves, int numValues) {
+  int index = 0;
+  for (; index + 8 <= numValues; index += 8) {
+    __m128i converted = _mm256_cvtps_ph(_mm256_loadu_ps(values + index),
+                                        _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(halves + index), converted);
+  }
+  for (; index < numValues; ++index) {
+    __m128i converted =
+        _mm_cvtps_ph(_mm_set_ss(values[index]), _MM_FROUND_TO_NEAREST_INT);
+    halves[index] = static_cast<Half>(_mm_extract_epi16(converted, 0));
+  }
+}
+
+MINIGRAPHICS_SIMD_TARGET("f16c")
+static void halfToFloatF16C(const Half* halves, float* values, int numValues) {
+  int index = 0;
+  for (; index + 8 <= numValues; index += 8) {
+    __m128i packed =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(halves + index));
+    _mm256_storeu_ps(values + index, _mm256_cvtph_ps(packed));
+  }
+  for (; index < numValues; ++index) {
+    __m128i packed = _mm_cvtsi32_si128(halves[index]);
+    values[index] = _mm_cvtss_f32(_mm_cvtph_ps(packed));
+  }
+}
+
+#endif  // MINIGRAPHICS_SIMD_X86
+
+// -----------------------------------------------------------------------------
+// Dispatch
+
+Half floatToHalf(float value) {
+  Half result;
+  floatToHalf(&value, &result, 1);
+  return result;
+}
+
+float halfToFloat(Half value) {
+  float result;
+  halfToFloat(&value, &result, 1);
+  return result;
+}
+
+void floatToHalf(const float* values, Half* halves, int numValues) {
+#ifdef MINIGRAPHICS_SIMD_X86
+  if (getSimdF16C()) {
+    floatToHalfF16C(values, halves, numValues);
+    return;
+  }
+#endif
+  for (int index = 0; index < numValues; ++index) {
+    halves[index] = floatToHalfScalar(values[index]);
+  }
+}
+
+void halfToFloat(const Half* halves, float* values, int numValues) {
+#ifdef MINIGRAPHICS_SIMD_X86
+  if (getSimdF16C()) {
+    halfToFloatF16C(halves, values, numValues);
+    return;
+  }
+#endif
+  for (int index = 0; index < numValues; ++index) {
+    values[index] = halfToFloatScalar(halves[index]);
+  }
+}
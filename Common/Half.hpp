@@ -0,0 +1,44 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef HALF_HPP
+#define HALF_HPP
+
+// Support for IEEE 754 half-precision (binary16) values. Halves are stored as
+// their raw 16-bit pattern and converted to and from float for arithmetic.
+// Conversions round to nearest even and use the F16C instructions when the
+// CPU has them (see SimdDispatch.hpp).
+
+using Half = unsigned short;
+
+/// \brief Converts a float to the nearest half (ties to even).
+Half floatToHalf(float value);
+
+/// \brief Converts a half to a float. This conversion is exact.
+float halfToFloat(Half value);
+
+/// \brief Converts an array of floats to halves.
+void floatToHalf(const float* values, Half* halves, int numValues);
+
+/// \brief Converts an array of halves to floats.
+void halfToFloat(const Half* halves, float* values, int numValues);
+
+/// \brief Returns true if half value1 is less than half value2.
+///
+/// The comparison is done directly on the bit patterns without converting to
+/// float. Results are undefined for NaN values, and -0 compares less than +0.
+///
+inline bool halfLess(Half value1, Half value2) {
+  // Flip the bits so that the sign-magnitude encoding sorts as unsigned.
+  auto orderKey = [](Half value) -> unsigned int {
+    return (value & 0x8000) ? (~value & 0xFFFF) : (value | 0x8000);
+  };
+  return orderKey(value1) < orderKey(value2);
+}
+
+#endif  // HALF_HPP
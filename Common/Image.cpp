@@ -8,12 +8,28 @@
 
 #include "Image.hpp"
 
+int Image::tileSize = 0;
+int Image::interleave = 0;
+
 Image::~Image() {}
 
+void Image::setTileSize(int _tileSize) { Image::tileSize = _tileSize; }
+
+void Image::setInterleave(int _interleave) {
+  Image::interleave = _interleave;
+}
+
 void Image::clear(const Color& color, float depth) {
   this->clearImpl(color, depth);
 }
 
+std::unique_ptr<Image> Image::blend(const Image& otherImage) const {
+  // The output starts empty. blendInto will size it to the blended region.
+  std::unique_ptr<Image> outImage = this->createNew(0, 0);
+  this->blendInto(otherImage, *outImage);
+  return outImage;
+}
+
 std::unique_ptr<Image> Image::createNew(int _width,
                                         int _height,
                                         int _regionBegin,
@@ -13,7 +13,9 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <memory>
+#include <typeinfo>
 #include <vector>
 
 #include <Common/Color.hpp>
@@ -51,6 +53,9 @@ class Image {
   };
   Internals internals;
 
+  static int tileSize;
+  static int interleave;
+
  protected:
   void resizeRegion(int _regionBegin, int _regionEnd) {
     this->internals.regionBegin = _regionBegin;
@@ -98,6 +103,24 @@ class Image {
         Viewport(0, 0, this->getWidth() - 1, this->getHeight() - 1));
   }
 
+  /// \brief Casts an image to ImageType if it is of the same class as like.
+  ///
+  /// This is a cheaper replacement for dynamic_cast when an image must be of
+  /// the same class as another one (such as two images being blended). It
+  /// returns null if the two images are of different classes. ImageType must
+  /// be a class (or base class) of like.
+  template <typename ImageType>
+  static const ImageType* sameTypeCast(const Image* image, const Image* like) {
+    return (typeid(*image) == typeid(*like))
+               ? static_cast<const ImageType*>(image)
+               : nullptr;
+  }
+  template <typename ImageType>
+  static ImageType* sameTypeCast(Image* image, const Image* like) {
+    return (typeid(*image) == typeid(*like)) ? static_cast<ImageType*>(image)
+                                             : nullptr;
+  }
+
   /// \brief Returns the number of (valid) pixels in the image.
   ///
   /// Note that an Image might actually only contain a subregion of pixels for
@@ -107,15 +130,156 @@ class Image {
     return this->getRegionEnd() - this->getRegionBegin();
   }
 
+  /// \brief Sets the size of the square tiles that pixels are ordered by.
+  ///
+  /// With the default tile size of 0, pixel indices run along scanlines. With
+  /// a tile size of n, the image is cut into n x n tiles (smaller along the
+  /// right and top edges), the pixels of each tile are consecutive in
+  /// scanline order, and the tiles themselves are in scanline order. A
+  /// contiguous region of pixels is then a compact patch of the image rather
+  /// than a long strip. The layout applies to all images, so set it before
+  /// creating any.
+  static void setTileSize(int _tileSize);
+  static int getTileSize() { return tileSize; }
+
+  /// \brief Sets the number of groups that rows of tiles are interleaved in.
+  ///
+  /// By default rows of tiles (scanlines when there are no tiles) are in
+  /// order from the bottom of the image to the top. With an interleave of n,
+  /// every nth row is gathered into a group, and the groups are placed one
+  /// after another: first rows 0, n, 2n, ..., then rows 1, n + 1, 2n + 1,
+  /// ..., and so on. Splitting the pixels into n contiguous pieces then
+  /// gives each piece rows spread evenly over the image rather than one
+  /// band of it, which balances the active pixels among the pieces when the
+  /// geometry covers only part of the screen. Compositors that split images
+  /// set this to the number of pieces they make. Like the tile size, it
+  /// applies to all images and must be set before creating any.
+  static void setInterleave(int _interleave);
+  static int getInterleave() { return interleave; }
+
+  /// \brief Returns true if pixel indices run along scanlines.
+  ///
+  /// This is the case when neither tiles nor interleaving are used. Code that
+  /// hands pixel buffers to other libraries needs this order.
+  static bool hasScanlineOrder() { return (tileSize < 1) && (interleave < 2); }
+
+  /// \brief Returns the width of the tiles pixels are ordered by.
+  ///
+  /// Scanline order is the same as tiles one row high spanning the image, so
+  /// code that walks the image tile by tile handles both layouts.
+  int getTileWidth() const {
+    return (tileSize > 0) ? tileSize : this->getWidth();
+  }
+
+  /// \brief Returns the height of the tiles pixels are ordered by.
+  int getTileHeight() const { return (tileSize > 0) ? tileSize : 1; }
+
+  /// \brief Returns the number of rows of tiles in the image.
+  int getNumberOfTileRows() const {
+    int tileHeight = this->getTileHeight();
+    return (this->getHeight() + tileHeight - 1) / tileHeight;
+  }
+
+  /// \brief Returns the row of tiles at the given position in pixel order.
+  ///
+  /// Without interleaving, this is the position itself.
+  int tileRowAtPosition(int position) const {
+    if (interleave < 2) {
+      return position;
+    }
+    int numTileRows = this->getNumberOfTileRows();
+    int groupSize = numTileRows / interleave;
+    int numLargeGroups = numTileRows % interleave;
+    int largeGroupsEnd = numLargeGroups * (groupSize + 1);
+    if (position < largeGroupsEnd) {
+      return (position % (groupSize + 1)) * interleave +
+             (position / (groupSize + 1));
+    }
+    position -= largeGroupsEnd;
+    return (position % groupSize) * interleave + numLargeGroups +
+           (position / groupSize);
+  }
+
+  /// \brief Returns the position in pixel order of the given row of tiles.
+  int tileRowPosition(int tileRow) const {
+    if (interleave < 2) {
+      return tileRow;
+    }
+    int numTileRows = this->getNumberOfTileRows();
+    int groupSize = numTileRows / interleave;
+    int group = tileRow % interleave;
+    return group * groupSize +
+           std::min(group, numTileRows % interleave) + (tileRow / interleave);
+  }
+
+  /// \brief Returns the index of the first pixel of the row of tiles at the
+  /// given position in pixel order.
+  ///
+  /// The position may be the number of tile rows, which gives the index one
+  /// past the last pixel.
+  int tileRowPixelIndex(int position) const {
+    int rowPixels = this->getTileHeight() * this->getWidth();
+    int index = position * rowPixels;
+    // The top row of tiles may be short, which shifts the rows after it.
+    int lastTileRow = this->getNumberOfTileRows() - 1;
+    if (position > this->tileRowPosition(lastTileRow)) {
+      index -= (lastTileRow + 1) * rowPixels -
+               this->getHeight() * this->getWidth();
+    }
+    return index - this->getRegionBegin();
+  }
+
   /// \brief Converts x/y location in image to a pixel index.
   int pixelIndex(int x, int y) const {
-    return y * this->getWidth() + x - this->getRegionBegin();
+    if (hasScanlineOrder()) {
+      return y * this->getWidth() + x - this->getRegionBegin();
+    }
+    int tileRow = y / this->getTileHeight();
+    int tileRowBegin = this->tileRowPixelIndex(this->tileRowPosition(tileRow));
+    if (tileSize < 1) {
+      return tileRowBegin + x;
+    }
+    int tileMinX = x - (x % tileSize);
+    int tileMinY = tileRow * tileSize;
+    int tileWidth = std::min(tileSize, this->getWidth() - tileMinX);
+    int tileHeight = std::min(tileSize, this->getHeight() - tileMinY);
+    return tileRowBegin + (tileMinX * tileHeight) +
+           ((y - tileMinY) * tileWidth) + (x - tileMinX);
   }
 
   /// \brief Converts a pixel index to the x/y location.
-  void xyIndices(int pixelIndex, int& x, int& y) {
-    x = (pixelIndex + this->getRegionBegin()) % this->getWidth();
-    y = (pixelIndex + this->getRegionBegin()) / this->getWidth();
+  void xyIndices(int pixelIndex, int& x, int& y) const {
+    int index = pixelIndex + this->getRegionBegin();
+    if (hasScanlineOrder()) {
+      x = index % this->getWidth();
+      y = index / this->getWidth();
+      return;
+    }
+    int rowPixels = this->getTileHeight() * this->getWidth();
+    int position = index / rowPixels;
+    int lastTileRow = this->getNumberOfTileRows() - 1;
+    int lastPosition = this->tileRowPosition(lastTileRow);
+    if (position >= lastPosition) {
+      // Rows of tiles after a short top row are shifted down.
+      int shift =
+          (lastTileRow + 1) * rowPixels - this->getHeight() * this->getWidth();
+      if (index >= (lastPosition + 1) * rowPixels - shift) {
+        position = (index + shift) / rowPixels;
+      }
+    }
+    index -= this->tileRowPixelIndex(position) + this->getRegionBegin();
+    int tileMinY = this->tileRowAtPosition(position) * this->getTileHeight();
+    if (tileSize < 1) {
+      x = index;
+      y = tileMinY;
+      return;
+    }
+    int tileHeight = std::min(tileSize, this->getHeight() - tileMinY);
+    int tileMinX = index / (tileSize * tileHeight) * tileSize;
+    int tileWidth = std::min(tileSize, this->getWidth() - tileMinX);
+    index -= tileMinX * tileHeight;
+    x = tileMinX + (index % tileWidth);
+    y = tileMinY + (index / tileWidth);
   }
 
   /// \brief Clears the image to the given color and depth (if applicable).
@@ -136,7 +300,30 @@ class Image {
   /// to the output. Likewise for the region end. It is an error to have a gap
   /// between the region end of one image and the region begin of the other.
   ///
-  virtual std::unique_ptr<Image> blend(const Image& otherImage) const = 0;
+  std::unique_ptr<Image> blend(const Image& otherImage) const;
+
+  /// \brief Blend this image with another image into an existing image
+  ///
+  /// This behaves the same as \c blend except that the result is written to
+  /// \c outImage rather than a newly allocated image. \c outImage must be of
+  /// the same type as this image. Its buffers are only resized if its region
+  /// differs from the union of the two input regions, so an image reused for
+  /// several blends does not allocate memory once it is large enough.
+  ///
+  /// \c outImage may be one of the two input images. In that case the result
+  /// replaces the contents of that image.
+  ///
+  virtual void blendInto(const Image& otherImage, Image& outImage) const = 0;
+
+  /// \brief Blend another image underneath this one
+  ///
+  /// The result of blending this image on top of \c underImage replaces the
+  /// contents of this image. This is the same as calling
+  /// <tt>blendInto(underImage, *this)</tt>.
+  ///
+  void blendInPlace(const Image& underImage) {
+    this->blendInto(underImage, *this);
+  }
 
   /// \brief Returns whether blending in this buffer is order dependent.
   ///
@@ -167,6 +354,13 @@ class Image {
   /// The memory is allocated but no data are set.
   std::unique_ptr<Image> createNew() const;
 
+  /// \brief Changes the region of pixels held by this image.
+  ///
+  /// Any memory already held by the image is reused when possible. The
+  /// contents of the image are undefined after this call. This is useful for
+  /// preparing an image that is being reused as a receive buffer.
+  virtual void resizeBuffers(int newRegionBegin, int newRegionEnd) = 0;
+
   /// \brief Creates a new image containing a subrange of the given image.
   ///
   /// Allocates a new image of an appropriate size and then copies the data
@@ -9,9 +9,15 @@
 #ifndef IMAGECOLORDEPTH_HPP
 #define IMAGECOLORDEPTH_HPP
 
+#include "AlignedAllocator.hpp"
+#include "BufferPool.hpp"
+#include "DepthRanges.hpp"
 #include "ImageFull.hpp"
+#include "ThreadPool.hpp"
 
+#include <algorithm>
 #include <memory>
+#include <numeric>
 #include <vector>
 
 struct ImageColorDepthBase {};
@@ -37,6 +43,11 @@ struct ImageColorDepthBase {};
 ///     fills a given array (of size one) of DepthType.
 ///   - A static function named decodeDepth that takes an array (of size 1)
 ///     of DepthType and returns a float object.
+///   - A static function named blendPixels that takes arrays of top color,
+///     top depth, bottom color, bottom depth, output color, and output depth
+///     values along with a number of pixels and performs the depth blend for
+///     all of them. The output arrays may be the same as the input arrays.
+///     (depthBlendGeneric in BlendKernels.hpp implements this with closer.)
 ///
 template <typename Features>
 class ImageColorDepth : public ImageFull, ImageColorDepthBase {
@@ -48,24 +59,35 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
  private:
   using ThisType = ImageColorDepth<Features>;
 
-  std::shared_ptr<std::vector<ColorType>> colorBuffer;
-  std::shared_ptr<std::vector<DepthType>> depthBuffer;
+  // Pixel buffers start on cache lines (and optionally huge pages).
+  using ColorBufferType = std::vector<ColorType, AlignedAllocator<ColorType>>;
+  using DepthBufferType = std::vector<DepthType, AlignedAllocator<DepthType>>;
+
+  std::shared_ptr<ColorBufferType> colorBuffer;
+  std::shared_ptr<DepthBufferType> depthBuffer;
+
+  // Per-block depth summary of depthBuffer, shared along with it.
+  DepthRanges<Features> depthRanges;
 
   static constexpr int COLOR_BUFFER_TAG = 12900;
   static constexpr int DEPTH_BUFFER_TAG = 12901;
+  static constexpr int DEPTH_RANGES_TAG = 12902;
+
+  // Global pixel index of the first element of the buffers.
+  int getBufferBase() const {
+    return this->getRegionBegin() - this->bufferOffset;
+  }
+
+  int getBufferSize() const { return this->bufferSize; }
 
  protected:
   ImageColorDepth(int _width, int _height)
-      : ImageFull(_width, _height),
-        colorBuffer(new std::vector<ColorType>),
-        depthBuffer(new std::vector<DepthType>) {
+      : ImageFull(_width, _height) {
     this->resizeBuffers(this->getRegionBegin(), this->getRegionEnd());
   }
 
   ImageColorDepth(int _width, int _height, int _regionBegin, int _regionEnd)
-      : ImageFull(_width, _height, _regionBegin, _regionEnd),
-        colorBuffer(new std::vector<ColorType>),
-        depthBuffer(new std::vector<DepthType>) {
+      : ImageFull(_width, _height, _regionBegin, _regionEnd) {
     this->resizeBuffers(this->getRegionBegin(), this->getRegionEnd());
   }
 
@@ -81,6 +103,8 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
            ((pixelIndex + this->bufferOffset) * ColorVecSize);
   }
 
+  /// Code that writes depths through this pointer must then call
+  /// invalidateDepthRanges.
   DepthType* getDepthBuffer(int pixelIndex = 0) {
     return this->depthBuffer->data() + pixelIndex + this->bufferOffset;
   }
@@ -88,10 +112,69 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
     return this->depthBuffer->data() + pixelIndex + this->bufferOffset;
   }
 
-  void resizeBuffers(int newRegionBegin, int newRegionEnd) {
+  void resizeBuffers(int newRegionBegin, int newRegionEnd) final {
+    this->resizeBuffers(
+        newRegionBegin, newRegionEnd, 0, newRegionEnd - newRegionBegin);
+  }
+
+  void resizeBuffers(int newRegionBegin,
+                     int newRegionEnd,
+                     int heldPixelBegin,
+                     int heldPixelEnd) final {
+    assert((0 <= heldPixelBegin) && (heldPixelBegin <= heldPixelEnd) &&
+           (heldPixelEnd <= newRegionEnd - newRegionBegin));
     this->resizeRegion(newRegionBegin, newRegionEnd);
-    this->colorBuffer->resize(this->getNumberOfPixels() * ColorVecSize);
-    this->depthBuffer->resize(this->getNumberOfPixels());
+    this->bufferOffset = -heldPixelBegin;
+    this->bufferSize = heldPixelEnd - heldPixelBegin;
+    // Buffers shared with another image (such as a shallow copy or window)
+    // are replaced rather than resized so that the other image is not
+    // corrupted.
+    resizePooledBuffer(this->colorBuffer, this->bufferSize * ColorVecSize);
+    resizePooledBuffer(this->depthBuffer, this->bufferSize);
+    this->depthRanges.reset(this->bufferSize);
+  }
+
+  /// Forgets the depth summary of this image's pixels. Call after writing
+  /// depths directly into the depth buffer.
+  void invalidateDepthRanges() {
+    this->depthRanges.invalidate(
+        this->getBufferBase(),
+        this->getHeldPixelBegin() + this->bufferOffset,
+        this->getHeldPixelEnd() + this->bufferOffset);
+  }
+
+  /// Computes the depth summary of this image's pixels where not known.
+  void updateDepthRanges() const {
+    this->depthRanges.update(this->getBufferBase(),
+                             this->depthBuffer->data(),
+                             this->getBufferSize(),
+                             this->getHeldPixelBegin() + this->bufferOffset,
+                             this->getHeldPixelEnd() + this->bufferOffset);
+  }
+
+  /// \brief Splits a depth blend over another image by depth order.
+  ///
+  /// Considers blending numPixels pixels of this image, starting at
+  /// pixelIndex, over those of bottomImage starting at bottomPixelIndex.
+  /// Calls visit(offset, count, order) for each span of pixels where this
+  /// image is in front (DEPTH_ORDER_TOP), the bottom image is in front
+  /// (DEPTH_ORDER_BOTTOM), or a per-pixel blend is needed. The depth ranges
+  /// of both images must be up to date (see updateDepthRanges).
+  template <typename Visit>
+  void forEachDepthOrder(int pixelIndex,
+                         const ThisType& bottomImage,
+                         int bottomPixelIndex,
+                         int numPixels,
+                         const Visit& visit) const {
+    DepthRanges<Features>::forEachDepthOrder(
+        this->depthRanges,
+        this->getBufferBase(),
+        pixelIndex + this->bufferOffset,
+        bottomImage.depthRanges,
+        bottomImage.getBufferBase(),
+        bottomPixelIndex + bottomImage.bufferOffset,
+        numPixels,
+        visit);
   }
 
   Color getColor(int x, int y) const {
@@ -102,6 +185,10 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
     assert(pixelIndex >= 0);
     assert(pixelIndex < this->getNumberOfPixels());
 
+    if (!this->holdsPixel(pixelIndex)) {
+      return Color(0, 0, 0, 0);
+    }
+
     return Features::decodeColor(this->getColorBuffer(pixelIndex));
   }
 
@@ -110,12 +197,30 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
   }
 
   void setColor(int pixelIndex, const Color& color) final {
-    assert(pixelIndex >= 0);
-    assert(pixelIndex < this->getNumberOfPixels());
+    assert(this->holdsPixel(pixelIndex) && "Cannot set an unheld pixel.");
 
     Features::encodeColor(color, this->getColorBuffer(pixelIndex));
   }
 
+  /// \brief Encodes a color in the components stored for each pixel.
+  static void encodeColor(const Color& color,
+                          ColorType colorComponents[ColorVecSize]) {
+    Features::encodeColor(color, colorComponents);
+  }
+
+  /// \brief Sets the color of the n'th pixel to an already encoded color.
+  ///
+  /// Code writing the same color to many pixels can encode it once with
+  /// encodeColor rather than on every setColor.
+  void setEncodedColor(int pixelIndex,
+                       const ColorType colorComponents[ColorVecSize]) {
+    assert(this->holdsPixel(pixelIndex) && "Cannot set an unheld pixel.");
+
+    std::copy(colorComponents,
+              colorComponents + ColorVecSize,
+              this->getColorBuffer(pixelIndex));
+  }
+
   float getDepth(int x, int y) const {
     return this->getDepth(this->pixelIndex(x, y));
   }
@@ -124,6 +229,10 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
     assert(pixelIndex >= 0);
     assert(pixelIndex < this->getNumberOfPixels());
 
+    if (!this->holdsPixel(pixelIndex)) {
+      return 1.0f;
+    }
+
     return Features::decodeDepth(this->getDepthBuffer(pixelIndex));
   }
 
@@ -132,15 +241,18 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
   }
 
   void setDepth(int pixelIndex, float depth) final {
-    assert(pixelIndex >= 0);
-    assert(pixelIndex < this->getNumberOfPixels());
+    assert(this->holdsPixel(pixelIndex) && "Cannot set an unheld pixel.");
 
     Features::encodeDepth(depth, this->getDepthBuffer(pixelIndex));
+    this->depthRanges.invalidate(this->getBufferBase(),
+                                 pixelIndex + this->bufferOffset);
   }
 
-  std::unique_ptr<Image> blend(const Image& _otherImage) const final {
-    const ThisType* otherImage = dynamic_cast<const ThisType*>(&_otherImage);
+  void blendInto(const Image& _otherImage, Image& _outImage) const final {
+    const ThisType* otherImage = sameTypeCast<ThisType>(&_otherImage, this);
     assert((otherImage != NULL) && "Attempting to blend invalid images.");
+    ThisType* outImage = sameTypeCast<ThisType>(&_outImage, this);
+    assert((outImage != NULL) && "Attempting to blend into invalid image.");
 
     const ThisType* topImage = this;
     const ThisType* bottomImage = otherImage;
@@ -152,95 +264,90 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
         std::min(topImage->getRegionBegin(), bottomImage->getRegionBegin());
     int totalRegionEnd =
         std::max(topImage->getRegionEnd(), bottomImage->getRegionEnd());
-
-    std::unique_ptr<Image> outImageHolder = topImage->createNew(
-        this->getWidth(),
-        this->getHeight(),
-        totalRegionBegin,
-        totalRegionEnd,
-        this->getValidViewport().unionWith(otherImage->getValidViewport()));
-    ThisType* outImage = dynamic_cast<ThisType*>(outImageHolder.get());
-    assert((outImage != NULL) && "Internal error: createNew bad type.");
-
-    int topPixelIndex = 0;
-    int bottomPixelIndex = 0;
-    int outPixelIndex = 0;
-
-    // Manage where part of one image has a region that starts before the other
-    if (topImage->getRegionBegin() < bottomImage->getRegionBegin()) {
-      int numToCopy =
-          bottomImage->getRegionBegin() - topImage->getRegionBegin();
-      std::copy(topImage->getColorBuffer(0),
-                topImage->getColorBuffer(numToCopy),
-                outImage->getColorBuffer(0));
-      std::copy(topImage->getDepthBuffer(0),
-                topImage->getDepthBuffer(numToCopy),
-                outImage->getDepthBuffer(0));
-      topPixelIndex += numToCopy;
-      outPixelIndex += numToCopy;
-    } else if (bottomImage->getRegionBegin() < topImage->getRegionBegin()) {
-      int numToCopy =
-          topImage->getRegionBegin() - bottomImage->getRegionBegin();
-      std::copy(bottomImage->getColorBuffer(0),
-                bottomImage->getColorBuffer(numToCopy),
-                outImage->getColorBuffer(0));
-      std::copy(bottomImage->getDepthBuffer(0),
-                bottomImage->getDepthBuffer(numToCopy),
-                outImage->getDepthBuffer(0));
-      bottomPixelIndex += numToCopy;
-      outPixelIndex += numToCopy;
-    }
-
-    // Blend where the two images intersect
-    while ((topPixelIndex < topImage->getNumberOfPixels()) &&
-           (bottomPixelIndex < bottomImage->getNumberOfPixels())) {
-      if (Features::closer(*bottomImage->getDepthBuffer(bottomPixelIndex),
-                           *topImage->getDepthBuffer(topPixelIndex))) {
-        std::copy(bottomImage->getColorBuffer(bottomPixelIndex),
-                  bottomImage->getColorBuffer(bottomPixelIndex + 1),
-                  outImage->getColorBuffer(outPixelIndex));
-        *outImage->getDepthBuffer(outPixelIndex) =
-            *bottomImage->getDepthBuffer(bottomPixelIndex);
-      } else {
-        std::copy(topImage->getColorBuffer(topPixelIndex),
-                  topImage->getColorBuffer(topPixelIndex + 1),
-                  outImage->getColorBuffer(outPixelIndex));
-        *outImage->getDepthBuffer(outPixelIndex) =
-            *topImage->getDepthBuffer(topPixelIndex);
+    Viewport totalViewport =
+        this->getValidViewport().unionWith(otherImage->getValidViewport());
+
+    // The output holds whatever either image holds.
+    int heldBegin;
+    int heldEnd;
+    heldPixelsOfBlend(
+        *topImage, *bottomImage, totalRegionBegin, heldBegin, heldEnd);
+
+    if ((outImage->getRegionBegin() != totalRegionBegin) ||
+        (outImage->getRegionEnd() != totalRegionEnd) ||
+        (outImage->getHeldPixelBegin() != heldBegin - totalRegionBegin) ||
+        (outImage->getHeldPixelEnd() != heldEnd - totalRegionBegin)) {
+      if (outImage->sharesBuffersWith(*topImage) ||
+          outImage->sharesBuffersWith(*bottomImage)) {
+        // The output is growing over memory we still need to read. Blend into
+        // new memory and then have the output take it over. The blend sizes
+        // the buffers of the new image.
+        std::unique_ptr<Image> newImageHolder =
+            this->createNew(totalRegionBegin, totalRegionBegin);
+        ThisType* newImage =
+            sameTypeCast<ThisType>(newImageHolder.get(), this);
+        assert((newImage != NULL) && "Internal error: createNew bad type.");
+        this->blendInto(*otherImage, *newImage);
+        outImage->resizeRegion(totalRegionBegin, totalRegionEnd);
+        outImage->setValidViewport(totalViewport);
+        outImage->colorBuffer = newImage->colorBuffer;
+        outImage->depthBuffer = newImage->depthBuffer;
+        outImage->depthRanges = newImage->depthRanges;
+        outImage->bufferOffset = newImage->bufferOffset;
+        outImage->bufferSize = newImage->bufferSize;
+        return;
       }
-      ++topPixelIndex;
-      ++bottomPixelIndex;
-      ++outPixelIndex;
+      outImage->resizeBuffers(totalRegionBegin,
+                              totalRegionEnd,
+                              heldBegin - totalRegionBegin,
+                              heldEnd - totalRegionBegin);
     }
 
-    // Manage where part of one image has a region past the end of the other
-    if (topPixelIndex < topImage->getNumberOfPixels()) {
-      int numToCopy = topImage->getNumberOfPixels() - topPixelIndex;
-      std::copy(topImage->getColorBuffer(topPixelIndex),
-                topImage->getColorBuffer(topPixelIndex + numToCopy),
-                outImage->getColorBuffer(outPixelIndex));
-      std::copy(topImage->getDepthBuffer(topPixelIndex),
-                topImage->getDepthBuffer(topPixelIndex + numToCopy),
-                outImage->getDepthBuffer(outPixelIndex));
-      topPixelIndex += numToCopy;
-      outPixelIndex += numToCopy;
-    }
-
-    if (bottomPixelIndex < bottomImage->getNumberOfPixels()) {
-      int numToCopy = bottomImage->getNumberOfPixels() - bottomPixelIndex;
-      std::copy(bottomImage->getColorBuffer(bottomPixelIndex),
-                bottomImage->getColorBuffer(bottomPixelIndex + numToCopy),
-                outImage->getColorBuffer(outPixelIndex));
-      std::copy(bottomImage->getDepthBuffer(bottomPixelIndex),
-                bottomImage->getDepthBuffer(bottomPixelIndex + numToCopy),
-                outImage->getDepthBuffer(outPixelIndex));
-      bottomPixelIndex += numToCopy;
-      outPixelIndex += numToCopy;
-    }
-
-    assert(outPixelIndex == outImage->getNumberOfPixels());
-
-    return outImageHolder;
+    // Blend where both images hold pixels, copy where one does, and fill in
+    // background between pixels held by only one of them.
+    forEachHeldSpan(
+        *topImage,
+        *bottomImage,
+        heldBegin,
+        heldEnd,
+        [&](int pixel, int count, bool topHolds, bool bottomHolds) {
+          int topPixelIndex = pixel - topImage->getRegionBegin();
+          int bottomPixelIndex = pixel - bottomImage->getRegionBegin();
+          int outPixelIndex = pixel - totalRegionBegin;
+          if (topHolds && bottomHolds) {
+            topImage->updateDepthRanges();
+            bottomImage->updateDepthRanges();
+            parallelFor(count, MIN_PIXELS_PER_THREAD, [&](int begin, int end) {
+              blendPixelsByDepthRange(topImage,
+                                      topPixelIndex + begin,
+                                      bottomImage,
+                                      bottomPixelIndex + begin,
+                                      outImage,
+                                      outPixelIndex + begin,
+                                      end - begin);
+            });
+            outImage->depthRanges.blendRanges(
+                outImage->getBufferBase(),
+                outImage->getBufferSize(),
+                outPixelIndex + outImage->bufferOffset,
+                topImage->depthRanges,
+                topImage->getBufferBase(),
+                topPixelIndex + topImage->bufferOffset,
+                bottomImage->depthRanges,
+                bottomImage->getBufferBase(),
+                bottomPixelIndex + bottomImage->bufferOffset,
+                count);
+          } else if (topHolds) {
+            copyPixels(topImage, topPixelIndex, outImage, outPixelIndex, count);
+          } else if (bottomHolds) {
+            copyPixels(
+                bottomImage, bottomPixelIndex, outImage, outPixelIndex, count);
+          } else {
+            outImage->fillBackground(outPixelIndex, count);
+          }
+        });
+
+    outImage->setValidViewport(totalViewport);
   }
 
   bool blendIsOrderDependent() const final { return false; }
@@ -249,18 +356,24 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
                                       int subregionEnd) const final {
     assert(subregionBegin <= subregionEnd);
 
+    // The copy holds the pixels of the subrange that this image holds.
+    int heldBegin = std::min(
+        std::max(this->getHeldPixelBegin(), subregionBegin), subregionEnd);
+    int heldEnd =
+        std::max(std::min(this->getHeldPixelEnd(), subregionEnd), heldBegin);
     std::unique_ptr<Image> outImageHolder =
-        this->createNew(subregionBegin + this->getRegionBegin(),
-                        subregionEnd + this->getRegionBegin());
+        this->createNewCropped(subregionBegin + this->getRegionBegin(),
+                               subregionEnd + this->getRegionBegin(),
+                               heldBegin - subregionBegin,
+                               heldEnd - subregionBegin);
     ThisType* subImage = dynamic_cast<ThisType*>(outImageHolder.get());
     assert((subImage != NULL) && "Internal error: createNew bad type.");
 
-    std::copy(this->getColorBuffer(subregionBegin),
-              this->getColorBuffer(subregionEnd),
-              subImage->getColorBuffer());
-    std::copy(this->getDepthBuffer(subregionBegin),
-              this->getDepthBuffer(subregionEnd),
-              subImage->getDepthBuffer());
+    copyPixels(this,
+               heldBegin,
+               subImage,
+               heldBegin - subregionBegin,
+               heldEnd - heldBegin);
 
     return outImageHolder;
   }
@@ -273,8 +386,12 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
     int numProc;
     MPI_Comm_size(communicator, &numProc);
 
+    // Only the held pixels are sent.
+    int heldBegin = this->getHeldPixelBegin();
+    int heldEnd = this->getHeldPixelEnd();
+
     std::vector<int> allRegionBegin(numProc);
-    int regionBegin = this->getRegionBegin() * sizeof(ColorType) * ColorVecSize;
+    int regionBegin = (this->getRegionBegin() + heldBegin) * sizeof(ColorType) * ColorVecSize;
     MPI_Gather(&regionBegin,
                1,
                MPI_INT,
@@ -285,7 +402,7 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
                communicator);
 
     std::vector<int> allRegionCounts(numProc);
-    int dataSize = this->getNumberOfPixels() * sizeof(ColorType) * ColorVecSize;
+    int dataSize = (heldEnd - heldBegin) * sizeof(ColorType) * ColorVecSize;
     MPI_Gather(&dataSize,
                1,
                MPI_INT,
@@ -304,7 +421,14 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
     ThisType* recvImage = dynamic_cast<ThisType*>(outImageHolder.release());
     assert((recvImage != NULL) && "Internal error: createNew bad type.");
 
-    MPI_Gatherv(this->getColorBuffer(),
+    // Pixels that no image holds are background.
+    if ((rank == recvRank) &&
+        (std::accumulate(allRegionCounts.begin(), allRegionCounts.end(), 0) <
+         static_cast<int>(recvImage->getNumberOfPixels() * sizeof(ColorType) * ColorVecSize))) {
+      recvImage->clear();
+    }
+
+    MPI_Gatherv(this->getColorBuffer(heldBegin),
                 dataSize,
                 MPI_BYTE,
                 recvImage->getColorBuffer(),
@@ -320,11 +444,13 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
   std::vector<MPI_Request> ISend(int destRank,
                                  MPI_Comm communicator) const final {
     std::vector<MPI_Request> requests =
-        this->ISendMetaData(destRank, communicator);
+        this->ISendBufferMetaData(destRank, communicator);
+    int heldBegin = this->getHeldPixelBegin();
+    int heldEnd = this->getHeldPixelEnd();
 
     MPI_Request colorRequest;
-    MPI_Isend(this->getColorBuffer(),
-              this->getNumberOfPixels() * sizeof(ColorType) * ColorVecSize,
+    MPI_Isend(this->getColorBuffer(heldBegin),
+              (heldEnd - heldBegin) * sizeof(ColorType) * ColorVecSize,
               MPI_BYTE,
               destRank,
               COLOR_BUFFER_TAG,
@@ -333,8 +459,8 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
     requests.push_back(colorRequest);
 
     MPI_Request depthRequest;
-    MPI_Isend(this->getDepthBuffer(),
-              this->getNumberOfPixels() * sizeof(DepthType),
+    MPI_Isend(this->getDepthBuffer(heldBegin),
+              (heldEnd - heldBegin) * sizeof(DepthType),
               MPI_BYTE,
               destRank,
               DEPTH_BUFFER_TAG,
@@ -342,16 +468,34 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
               &depthRequest);
     requests.push_back(depthRequest);
 
+    // Send the depth summary so the receiver need not compute it.
+    this->updateDepthRanges();
+    MPI_Request rangesRequest;
+    MPI_Isend(this->depthRanges.getRanges(this->getBufferBase(),
+                                          heldBegin + this->bufferOffset),
+              DepthRanges<Features>::numberOfBlocks(
+                  this->getRegionBegin() + heldBegin,
+                  this->getRegionBegin() + heldEnd) *
+                  sizeof(typename DepthRanges<Features>::Range),
+              MPI_BYTE,
+              destRank,
+              DEPTH_RANGES_TAG,
+              communicator,
+              &rangesRequest);
+    requests.push_back(rangesRequest);
+
     return requests;
   }
 
   std::vector<MPI_Request> IReceive(int sourceRank,
                                     MPI_Comm communicator) final {
+    // Ranges shared with another image are stale once new depths arrive.
+    this->invalidateDepthRanges();
     std::vector<MPI_Request> requests =
-        this->IReceiveMetaData(sourceRank, communicator);
+        this->IReceiveBufferMetaData(sourceRank, communicator);
 
     MPI_Request colorRequest;
-    MPI_Irecv(this->getColorBuffer(),
+    MPI_Irecv(this->colorBuffer->data(),
               this->getNumberOfPixels() * sizeof(ColorType) * ColorVecSize,
               MPI_BYTE,
               sourceRank,
@@ -361,7 +505,7 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
     requests.push_back(colorRequest);
 
     MPI_Request depthRequest;
-    MPI_Irecv(this->getDepthBuffer(),
+    MPI_Irecv(this->depthBuffer->data(),
               this->getNumberOfPixels() * sizeof(DepthType),
               MPI_BYTE,
               sourceRank,
@@ -370,12 +514,140 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
               &depthRequest);
     requests.push_back(depthRequest);
 
+    // The region (and so the block alignment) is not known until the
+    // metadata arrives, so receive into ranges big enough for any alignment.
+    // Ranges that are not sent stay unknown.
+    this->depthRanges.reset(this->getNumberOfPixels());
+    MPI_Request rangesRequest;
+    MPI_Irecv(this->depthRanges.getRanges(0, 0),
+              DepthRanges<Features>::numberOfBlocks(
+                  0, this->getNumberOfPixels() + DEPTH_RANGE_BLOCK_SIZE) *
+                  sizeof(typename DepthRanges<Features>::Range),
+              MPI_BYTE,
+              sourceRank,
+              DEPTH_RANGES_TAG,
+              communicator,
+              &rangesRequest);
+    requests.push_back(rangesRequest);
+
     return requests;
   }
 
+ private:
+  bool sharesBuffersWith(const ThisType& otherImage) const {
+    return (this->colorBuffer == otherImage.colorBuffer) ||
+           (this->depthBuffer == otherImage.depthBuffer);
+  }
+
+  // Copies pixels, and their depth ranges, between images.
+  static void copyPixels(const ThisType* sourceImage,
+                         int sourcePixelIndex,
+                         ThisType* destImage,
+                         int destPixelIndex,
+                         int numPixels) {
+    copyPixelData(
+        sourceImage, sourcePixelIndex, destImage, destPixelIndex, numPixels);
+    destImage->depthRanges.copyRanges(destImage->getBufferBase(),
+                                      destImage->getBufferSize(),
+                                      destPixelIndex + destImage->bufferOffset,
+                                      sourceImage->depthRanges,
+                                      sourceImage->getBufferBase(),
+                                      sourcePixelIndex +
+                                          sourceImage->bufferOffset,
+                                      numPixels);
+  }
+
+  // Copies pixels between images without touching the depth ranges. When
+  // blending in place the source and destination can be the same memory, in
+  // which case there is nothing to do.
+  static void copyPixelData(const ThisType* sourceImage,
+                            int sourcePixelIndex,
+                            ThisType* destImage,
+                            int destPixelIndex,
+                            int numPixels) {
+    const ColorType* sourceColor =
+        sourceImage->getColorBuffer(sourcePixelIndex);
+    ColorType* destColor = destImage->getColorBuffer(destPixelIndex);
+    if (sourceColor != destColor) {
+      std::copy(sourceColor, sourceColor + numPixels * ColorVecSize, destColor);
+    }
+    const DepthType* sourceDepth =
+        sourceImage->getDepthBuffer(sourcePixelIndex);
+    DepthType* destDepth = destImage->getDepthBuffer(destPixelIndex);
+    if (sourceDepth != destDepth) {
+      std::copy(sourceDepth, sourceDepth + numPixels, destDepth);
+    }
+  }
+
+  // Depth blends pixels, copying the nearer image wherever the depth ranges
+  // of the two images do not overlap. The ranges must be up to date.
+  static void blendPixelsByDepthRange(const ThisType* topImage,
+                                      int topPixelIndex,
+                                      const ThisType* bottomImage,
+                                      int bottomPixelIndex,
+                                      ThisType* outImage,
+                                      int outPixelIndex,
+                                      int numPixels) {
+    topImage->forEachDepthOrder(
+        topPixelIndex,
+        *bottomImage,
+        bottomPixelIndex,
+        numPixels,
+        [&](int offset, int count, DepthOrder order) {
+          if (order == DEPTH_ORDER_MIXED) {
+            Features::blendPixels(
+                topImage->getColorBuffer(topPixelIndex + offset),
+                topImage->getDepthBuffer(topPixelIndex + offset),
+                bottomImage->getColorBuffer(bottomPixelIndex + offset),
+                bottomImage->getDepthBuffer(bottomPixelIndex + offset),
+                outImage->getColorBuffer(outPixelIndex + offset),
+                outImage->getDepthBuffer(outPixelIndex + offset),
+                count);
+          } else {
+            bool topWins = (order == DEPTH_ORDER_TOP);
+            copyPixelData(topWins ? topImage : bottomImage,
+                          (topWins ? topPixelIndex : bottomPixelIndex) + offset,
+                          outImage,
+                          outPixelIndex + offset,
+                          count);
+          }
+        });
+  }
+
+  // Sets held pixels to an encoded color and depth.
+  void fillPixels(int pixelIndex,
+                  int numPixels,
+                  const ColorType colorValue[ColorVecSize],
+                  const DepthType& depthValue) {
+    ColorType* cBuffer = this->getColorBuffer(pixelIndex);
+    DepthType* dBuffer = this->getDepthBuffer(pixelIndex);
+
+    for (int i = 0; i < numPixels; ++i) {
+      for (int colorComponent = 0; colorComponent < ColorVecSize;
+           ++colorComponent) {
+        cBuffer[i * ColorVecSize + colorComponent] =
+            colorValue[colorComponent];
+      }
+      dBuffer[i] = depthValue;
+    }
+    this->depthRanges.invalidate(this->getBufferBase(),
+                                 pixelIndex + this->bufferOffset,
+                                 pixelIndex + this->bufferOffset + numPixels);
+  }
+
+  // Sets held pixels to the background that pixels not held read as.
+  void fillBackground(int pixelIndex, int numPixels) {
+    ColorType colorValue[ColorVecSize];
+    Features::encodeColor(Color(0, 0, 0, 0), colorValue);
+    DepthType depthValue;
+    Features::encodeDepth(1.0f, &depthValue);
+    this->fillPixels(pixelIndex, numPixels, colorValue, depthValue);
+  }
+
  protected:
   void clearImpl(const Color& color, float depth) final {
-    int numPixels = this->getNumberOfPixels();
+    int heldBegin = this->getHeldPixelBegin();
+    int numPixels = this->getHeldPixelEnd() - heldBegin;
     if (numPixels < 1) {
       return;
     }
@@ -385,17 +657,7 @@ class ImageColorDepth : public ImageFull, ImageColorDepthBase {
     DepthType depthValue;
     Features::encodeDepth(depth, &depthValue);
 
-    ColorType* cBuffer = this->getColorBuffer();
-    DepthType* dBuffer = this->getDepthBuffer();
-
-    for (int pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
-      for (int colorComponent = 0; colorComponent < ColorVecSize;
-           ++colorComponent) {
-        cBuffer[pixelIndex * ColorVecSize + colorComponent] =
-            colorValue[colorComponent];
-      }
-      dBuffer[pixelIndex] = depthValue;
-    }
+    this->fillPixels(heldBegin, numPixels, colorValue, depthValue);
   }
 };
 
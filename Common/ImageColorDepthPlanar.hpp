@@ -0,0 +1,677 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef IMAGECOLORDEPTHPLANAR_HPP
+#define IMAGECOLORDEPTHPLANAR_HPP
+
+#include "AlignedAllocator.hpp"
+#include "BufferPool.hpp"
+#include "DepthRanges.hpp"
+#include "ImageColorDepth.hpp"
+#include "ImageFull.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+/// \brief Implementation of color/depth images with planar color channels
+///
+/// ImageColorDepthPlanar behaves like ImageColorDepth except that each color
+/// channel is kept in its own contiguous array rather than interleaving the
+/// channels of each pixel. This lets blending operate on whole vectors of a
+/// single channel. The features structure must contain the same items as
+/// that of ImageColorDepth except for blendPixels, which takes arrays of
+/// ColorVecSize channel pointers for the top, bottom, and output colors.
+/// Additionally, the features structure must contain the following item.
+///   - An InterleavedFeatures typename giving the features of the equivalent
+///     interleaved ImageColorDepth. Compressed images store their active
+///     pixels in that layout.
+///
+/// All color channels share a single buffer. Channel c of pixel i is at
+/// c * channelStride + i, where channelStride is the number of pixels in the
+/// image that allocated the buffer (windows keep the stride of the image they
+/// were made from).
+///
+template <typename Features>
+class ImageColorDepthPlanar : public ImageFull, ImageColorDepthBase {
+ public:
+  using ColorType = typename Features::ColorType;
+  using DepthType = typename Features::DepthType;
+  static constexpr int ColorVecSize = Features::ColorVecSize;
+
+ private:
+  using ThisType = ImageColorDepthPlanar<Features>;
+
+  using ColorBufferType = std::vector<ColorType, AlignedAllocator<ColorType>>;
+  using DepthBufferType = std::vector<DepthType, AlignedAllocator<DepthType>>;
+
+  std::shared_ptr<ColorBufferType> colorBuffer;
+  std::shared_ptr<DepthBufferType> depthBuffer;
+  int channelStride;
+
+  // Per-block depth summary of depthBuffer, shared along with it.
+  DepthRanges<Features> depthRanges;
+
+  // Channel c of the color is sent with tag COLOR_BUFFER_TAG + c.
+  static constexpr int COLOR_BUFFER_TAG = 12910;
+  static constexpr int DEPTH_BUFFER_TAG = 12901;
+  static constexpr int DEPTH_RANGES_TAG = 12902;
+
+  // Global pixel index of the first element of the buffers.
+  int getBufferBase() const {
+    return this->getRegionBegin() - this->bufferOffset;
+  }
+
+  int getBufferSize() const { return this->bufferSize; }
+
+ protected:
+  ImageColorDepthPlanar(int _width, int _height)
+      : ImageFull(_width, _height), channelStride(0) {
+    this->resizeBuffers(this->getRegionBegin(), this->getRegionEnd());
+  }
+
+  ImageColorDepthPlanar(int _width,
+                        int _height,
+                        int _regionBegin,
+                        int _regionEnd)
+      : ImageFull(_width, _height, _regionBegin, _regionEnd),
+        channelStride(0) {
+    this->resizeBuffers(this->getRegionBegin(), this->getRegionEnd());
+  }
+
+ public:
+  ~ImageColorDepthPlanar() = default;
+
+  ColorType* getColorChannel(int channel, int pixelIndex = 0) {
+    return this->colorBuffer->data() + (channel * this->channelStride) +
+           pixelIndex + this->bufferOffset;
+  }
+  const ColorType* getColorChannel(int channel, int pixelIndex = 0) const {
+    return this->colorBuffer->data() + (channel * this->channelStride) +
+           pixelIndex + this->bufferOffset;
+  }
+
+  /// Code that writes depths through this pointer must then call
+  /// invalidateDepthRanges.
+  DepthType* getDepthBuffer(int pixelIndex = 0) {
+    return this->depthBuffer->data() + pixelIndex + this->bufferOffset;
+  }
+  const DepthType* getDepthBuffer(int pixelIndex = 0) const {
+    return this->depthBuffer->data() + pixelIndex + this->bufferOffset;
+  }
+
+  /// \brief Copies colors out with the channels of each pixel interleaved.
+  void getInterleavedColors(int pixelIndex,
+                            int numPixels,
+                            ColorType* interleavedColors) const {
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      const ColorType* channelColors =
+          this->getColorChannel(channel, pixelIndex);
+      for (int i = 0; i < numPixels; ++i) {
+        interleavedColors[i * ColorVecSize + channel] = channelColors[i];
+      }
+    }
+  }
+
+  void resizeBuffers(int newRegionBegin, int newRegionEnd) final {
+    this->resizeBuffers(
+        newRegionBegin, newRegionEnd, 0, newRegionEnd - newRegionBegin);
+  }
+
+  void resizeBuffers(int newRegionBegin,
+                     int newRegionEnd,
+                     int heldPixelBegin,
+                     int heldPixelEnd) final {
+    assert((0 <= heldPixelBegin) && (heldPixelBegin <= heldPixelEnd) &&
+           (heldPixelEnd <= newRegionEnd - newRegionBegin));
+    this->resizeRegion(newRegionBegin, newRegionEnd);
+    this->bufferOffset = -heldPixelBegin;
+    this->bufferSize = heldPixelEnd - heldPixelBegin;
+    // Buffers shared with another image (such as a shallow copy or window)
+    // are replaced rather than resized so that the other image is not
+    // corrupted.
+    resizePooledBuffer(this->colorBuffer, this->bufferSize * ColorVecSize);
+    resizePooledBuffer(this->depthBuffer, this->bufferSize);
+    this->channelStride = this->bufferSize;
+    this->depthRanges.reset(this->bufferSize);
+  }
+
+  /// Forgets the depth summary of this image's pixels. Call after writing
+  /// depths directly into the depth buffer.
+  void invalidateDepthRanges() {
+    this->depthRanges.invalidate(
+        this->getBufferBase(),
+        this->getHeldPixelBegin() + this->bufferOffset,
+        this->getHeldPixelEnd() + this->bufferOffset);
+  }
+
+  /// Computes the depth summary of this image's pixels where not known.
+  void updateDepthRanges() const {
+    this->depthRanges.update(this->getBufferBase(),
+                             this->depthBuffer->data(),
+                             this->getBufferSize(),
+                             this->getHeldPixelBegin() + this->bufferOffset,
+                             this->getHeldPixelEnd() + this->bufferOffset);
+  }
+
+  Color getColor(int x, int y) const {
+    return this->getColor(this->pixelIndex(x, y));
+  }
+
+  Color getColor(int pixelIndex) const final {
+    assert(pixelIndex >= 0);
+    assert(pixelIndex < this->getNumberOfPixels());
+
+    if (!this->holdsPixel(pixelIndex)) {
+      return Color(0, 0, 0, 0);
+    }
+
+    ColorType colorComponents[ColorVecSize];
+    this->getInterleavedColors(pixelIndex, 1, colorComponents);
+    return Features::decodeColor(colorComponents);
+  }
+
+  void setColor(int x, int y, const Color& color) {
+    this->setColor(this->pixelIndex(x, y), color);
+  }
+
+  void setColor(int pixelIndex, const Color& color) final {
+    assert(this->holdsPixel(pixelIndex) && "Cannot set an unheld pixel.");
+
+    ColorType colorComponents[ColorVecSize];
+    Features::encodeColor(color, colorComponents);
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      *this->getColorChannel(channel, pixelIndex) = colorComponents[channel];
+    }
+  }
+
+  /// \brief Encodes a color in the components stored for each pixel.
+  static void encodeColor(const Color& color,
+                          ColorType colorComponents[ColorVecSize]) {
+    Features::encodeColor(color, colorComponents);
+  }
+
+  /// \brief Sets the color of the n'th pixel to an already encoded color.
+  ///
+  /// Code writing the same color to many pixels can encode it once with
+  /// encodeColor rather than on every setColor.
+  void setEncodedColor(int pixelIndex,
+                       const ColorType colorComponents[ColorVecSize]) {
+    assert(this->holdsPixel(pixelIndex) && "Cannot set an unheld pixel.");
+
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      *this->getColorChannel(channel, pixelIndex) = colorComponents[channel];
+    }
+  }
+
+  float getDepth(int x, int y) const {
+    return this->getDepth(this->pixelIndex(x, y));
+  }
+
+  float getDepth(int pixelIndex) const final {
+    assert(pixelIndex >= 0);
+    assert(pixelIndex < this->getNumberOfPixels());
+
+    if (!this->holdsPixel(pixelIndex)) {
+      return 1.0f;
+    }
+
+    return Features::decodeDepth(this->getDepthBuffer(pixelIndex));
+  }
+
+  void setDepth(int x, int y, float depth) {
+    this->setDepth(this->pixelIndex(x, y), depth);
+  }
+
+  void setDepth(int pixelIndex, float depth) final {
+    assert(this->holdsPixel(pixelIndex) && "Cannot set an unheld pixel.");
+
+    Features::encodeDepth(depth, this->getDepthBuffer(pixelIndex));
+    this->depthRanges.invalidate(this->getBufferBase(),
+                                 pixelIndex + this->bufferOffset);
+  }
+
+  void blendInto(const Image& _otherImage, Image& _outImage) const final {
+    const ThisType* otherImage = sameTypeCast<ThisType>(&_otherImage, this);
+    assert((otherImage != NULL) && "Attempting to blend invalid images.");
+    ThisType* outImage = sameTypeCast<ThisType>(&_outImage, this);
+    assert((outImage != NULL) && "Attempting to blend into invalid image.");
+
+    const ThisType* topImage = this;
+    const ThisType* bottomImage = otherImage;
+
+    assert(topImage->getRegionBegin() <= bottomImage->getRegionEnd());
+    assert(bottomImage->getRegionBegin() <= topImage->getRegionEnd());
+
+    int totalRegionBegin =
+        std::min(topImage->getRegionBegin(), bottomImage->getRegionBegin());
+    int totalRegionEnd =
+        std::max(topImage->getRegionEnd(), bottomImage->getRegionEnd());
+    Viewport totalViewport =
+        this->getValidViewport().unionWith(otherImage->getValidViewport());
+
+    // The output holds whatever either image holds.
+    int heldBegin;
+    int heldEnd;
+    heldPixelsOfBlend(
+        *topImage, *bottomImage, totalRegionBegin, heldBegin, heldEnd);
+
+    if ((outImage->getRegionBegin() != totalRegionBegin) ||
+        (outImage->getRegionEnd() != totalRegionEnd) ||
+        (outImage->getHeldPixelBegin() != heldBegin - totalRegionBegin) ||
+        (outImage->getHeldPixelEnd() != heldEnd - totalRegionBegin)) {
+      if (outImage->sharesBuffersWith(*topImage) ||
+          outImage->sharesBuffersWith(*bottomImage)) {
+        // The output is growing over memory we still need to read. Blend into
+        // new memory and then have the output take it over. The blend sizes
+        // the buffers of the new image.
+        std::unique_ptr<Image> newImageHolder =
+            this->createNew(totalRegionBegin, totalRegionBegin);
+        ThisType* newImage =
+            sameTypeCast<ThisType>(newImageHolder.get(), this);
+        assert((newImage != NULL) && "Internal error: createNew bad type.");
+        this->blendInto(*otherImage, *newImage);
+        outImage->resizeRegion(totalRegionBegin, totalRegionEnd);
+        outImage->setValidViewport(totalViewport);
+        outImage->colorBuffer = newImage->colorBuffer;
+        outImage->depthBuffer = newImage->depthBuffer;
+        outImage->depthRanges = newImage->depthRanges;
+        outImage->channelStride = newImage->channelStride;
+        outImage->bufferOffset = newImage->bufferOffset;
+        outImage->bufferSize = newImage->bufferSize;
+        return;
+      }
+      outImage->resizeBuffers(totalRegionBegin,
+                              totalRegionEnd,
+                              heldBegin - totalRegionBegin,
+                              heldEnd - totalRegionBegin);
+    }
+
+    // Blend where both images hold pixels, copy where one does, and fill in
+    // background between pixels held by only one of them.
+    forEachHeldSpan(
+        *topImage,
+        *bottomImage,
+        heldBegin,
+        heldEnd,
+        [&](int pixel, int count, bool topHolds, bool bottomHolds) {
+          int topPixelIndex = pixel - topImage->getRegionBegin();
+          int bottomPixelIndex = pixel - bottomImage->getRegionBegin();
+          int outPixelIndex = pixel - totalRegionBegin;
+          if (topHolds && bottomHolds) {
+            topImage->updateDepthRanges();
+            bottomImage->updateDepthRanges();
+            parallelFor(count, MIN_PIXELS_PER_THREAD, [&](int begin, int end) {
+              blendPixelsByDepthRange(topImage,
+                                      topPixelIndex + begin,
+                                      bottomImage,
+                                      bottomPixelIndex + begin,
+                                      outImage,
+                                      outPixelIndex + begin,
+                                      end - begin);
+            });
+            outImage->depthRanges.blendRanges(
+                outImage->getBufferBase(),
+                outImage->getBufferSize(),
+                outPixelIndex + outImage->bufferOffset,
+                topImage->depthRanges,
+                topImage->getBufferBase(),
+                topPixelIndex + topImage->bufferOffset,
+                bottomImage->depthRanges,
+                bottomImage->getBufferBase(),
+                bottomPixelIndex + bottomImage->bufferOffset,
+                count);
+          } else if (topHolds) {
+            copyPixels(topImage, topPixelIndex, outImage, outPixelIndex, count);
+          } else if (bottomHolds) {
+            copyPixels(
+                bottomImage, bottomPixelIndex, outImage, outPixelIndex, count);
+          } else {
+            outImage->fillBackground(outPixelIndex, count);
+          }
+        });
+
+    outImage->setValidViewport(totalViewport);
+  }
+
+  bool blendIsOrderDependent() const final { return false; }
+
+  std::unique_ptr<Image> copySubrange(int subregionBegin,
+                                      int subregionEnd) const final {
+    assert(subregionBegin <= subregionEnd);
+
+    // The copy holds the pixels of the subrange that this image holds.
+    int heldBegin = std::min(
+        std::max(this->getHeldPixelBegin(), subregionBegin), subregionEnd);
+    int heldEnd =
+        std::max(std::min(this->getHeldPixelEnd(), subregionEnd), heldBegin);
+    std::unique_ptr<Image> outImageHolder =
+        this->createNewCropped(subregionBegin + this->getRegionBegin(),
+                               subregionEnd + this->getRegionBegin(),
+                               heldBegin - subregionBegin,
+                               heldEnd - subregionBegin);
+    ThisType* subImage = dynamic_cast<ThisType*>(outImageHolder.get());
+    assert((subImage != NULL) && "Internal error: createNew bad type.");
+
+    copyPixels(this,
+               heldBegin,
+               subImage,
+               heldBegin - subregionBegin,
+               heldEnd - heldBegin);
+
+    return outImageHolder;
+  }
+
+  std::unique_ptr<ImageFull> Gather(int recvRank,
+                                    MPI_Comm communicator) const final {
+    int rank;
+    MPI_Comm_rank(communicator, &rank);
+
+    int numProc;
+    MPI_Comm_size(communicator, &numProc);
+
+    // Each channel is gathered separately, so offsets are within a channel.
+    // Only the held pixels are sent.
+    int heldBegin = this->getHeldPixelBegin();
+    int heldEnd = this->getHeldPixelEnd();
+
+    std::vector<int> allRegionBegin(numProc);
+    int regionBegin = (this->getRegionBegin() + heldBegin) * sizeof(ColorType);
+    MPI_Gather(&regionBegin,
+               1,
+               MPI_INT,
+               allRegionBegin.data(),
+               1,
+               MPI_INT,
+               recvRank,
+               communicator);
+
+    std::vector<int> allRegionCounts(numProc);
+    int dataSize = (heldEnd - heldBegin) * sizeof(ColorType);
+    MPI_Gather(&dataSize,
+               1,
+               MPI_INT,
+               allRegionCounts.data(),
+               1,
+               MPI_INT,
+               recvRank,
+               communicator);
+
+    std::unique_ptr<Image> outImageHolder = this->createNew(
+        this->getWidth(),
+        this->getHeight(),
+        0,
+        this->getWidth() * this->getHeight(),
+        Viewport(0, 0, this->getWidth() - 1, this->getHeight() - 1));
+    ThisType* recvImage = dynamic_cast<ThisType*>(outImageHolder.release());
+    assert((recvImage != NULL) && "Internal error: createNew bad type.");
+
+    // Pixels that no image holds are background.
+    if ((rank == recvRank) &&
+        (std::accumulate(allRegionCounts.begin(), allRegionCounts.end(), 0) <
+         static_cast<int>(recvImage->getNumberOfPixels() * sizeof(ColorType)))) {
+      recvImage->clear();
+    }
+
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      MPI_Gatherv(this->getColorChannel(channel, heldBegin),
+                  dataSize,
+                  MPI_BYTE,
+                  recvImage->getColorChannel(channel),
+                  allRegionCounts.data(),
+                  allRegionBegin.data(),
+                  MPI_BYTE,
+                  recvRank,
+                  communicator);
+    }
+
+    return std::unique_ptr<ImageFull>(recvImage);
+  }
+
+  std::vector<MPI_Request> ISend(int destRank,
+                                 MPI_Comm communicator) const final {
+    std::vector<MPI_Request> requests =
+        this->ISendBufferMetaData(destRank, communicator);
+    int heldBegin = this->getHeldPixelBegin();
+    int heldEnd = this->getHeldPixelEnd();
+
+    // Each channel goes in its own message. The receiver does not know how
+    // many pixels are coming until the metadata arrives, so the channels
+    // cannot be packed together.
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      MPI_Request colorRequest;
+      MPI_Isend(this->getColorChannel(channel, heldBegin),
+                (heldEnd - heldBegin) * sizeof(ColorType),
+                MPI_BYTE,
+                destRank,
+                COLOR_BUFFER_TAG + channel,
+                communicator,
+                &colorRequest);
+      requests.push_back(colorRequest);
+    }
+
+    MPI_Request depthRequest;
+    MPI_Isend(this->getDepthBuffer(heldBegin),
+              (heldEnd - heldBegin) * sizeof(DepthType),
+              MPI_BYTE,
+              destRank,
+              DEPTH_BUFFER_TAG,
+              communicator,
+              &depthRequest);
+    requests.push_back(depthRequest);
+
+    // Send the depth summary so the receiver need not compute it.
+    this->updateDepthRanges();
+    MPI_Request rangesRequest;
+    MPI_Isend(this->depthRanges.getRanges(this->getBufferBase(),
+                                          heldBegin + this->bufferOffset),
+              DepthRanges<Features>::numberOfBlocks(
+                  this->getRegionBegin() + heldBegin,
+                  this->getRegionBegin() + heldEnd) *
+                  sizeof(typename DepthRanges<Features>::Range),
+              MPI_BYTE,
+              destRank,
+              DEPTH_RANGES_TAG,
+              communicator,
+              &rangesRequest);
+    requests.push_back(rangesRequest);
+
+    return requests;
+  }
+
+  std::vector<MPI_Request> IReceive(int sourceRank,
+                                    MPI_Comm communicator) final {
+    // Ranges shared with another image are stale once new depths arrive.
+    this->invalidateDepthRanges();
+    std::vector<MPI_Request> requests =
+        this->IReceiveBufferMetaData(sourceRank, communicator);
+
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      MPI_Request colorRequest;
+      MPI_Irecv(this->colorBuffer->data() + (channel * this->channelStride),
+                this->getNumberOfPixels() * sizeof(ColorType),
+                MPI_BYTE,
+                sourceRank,
+                COLOR_BUFFER_TAG + channel,
+                communicator,
+                &colorRequest);
+      requests.push_back(colorRequest);
+    }
+
+    MPI_Request depthRequest;
+    MPI_Irecv(this->depthBuffer->data(),
+              this->getNumberOfPixels() * sizeof(DepthType),
+              MPI_BYTE,
+              sourceRank,
+              DEPTH_BUFFER_TAG,
+              communicator,
+              &depthRequest);
+    requests.push_back(depthRequest);
+
+    // The region (and so the block alignment) is not known until the
+    // metadata arrives, so receive into ranges big enough for any alignment.
+    // Ranges that are not sent stay unknown.
+    this->depthRanges.reset(this->getNumberOfPixels());
+    MPI_Request rangesRequest;
+    MPI_Irecv(this->depthRanges.getRanges(0, 0),
+              DepthRanges<Features>::numberOfBlocks(
+                  0, this->getNumberOfPixels() + DEPTH_RANGE_BLOCK_SIZE) *
+                  sizeof(typename DepthRanges<Features>::Range),
+              MPI_BYTE,
+              sourceRank,
+              DEPTH_RANGES_TAG,
+              communicator,
+              &rangesRequest);
+    requests.push_back(rangesRequest);
+
+    return requests;
+  }
+
+ private:
+  bool sharesBuffersWith(const ThisType& otherImage) const {
+    return (this->colorBuffer == otherImage.colorBuffer) ||
+           (this->depthBuffer == otherImage.depthBuffer);
+  }
+
+  // Copies pixels, and their depth ranges, between images.
+  static void copyPixels(const ThisType* sourceImage,
+                         int sourcePixelIndex,
+                         ThisType* destImage,
+                         int destPixelIndex,
+                         int numPixels) {
+    copyPixelData(
+        sourceImage, sourcePixelIndex, destImage, destPixelIndex, numPixels);
+    destImage->depthRanges.copyRanges(destImage->getBufferBase(),
+                                      destImage->getBufferSize(),
+                                      destPixelIndex + destImage->bufferOffset,
+                                      sourceImage->depthRanges,
+                                      sourceImage->getBufferBase(),
+                                      sourcePixelIndex +
+                                          sourceImage->bufferOffset,
+                                      numPixels);
+  }
+
+  // Copies pixels between images without touching the depth ranges. When
+  // blending in place the source and destination can be the same memory, in
+  // which case there is nothing to do.
+  static void copyPixelData(const ThisType* sourceImage,
+                            int sourcePixelIndex,
+                            ThisType* destImage,
+                            int destPixelIndex,
+                            int numPixels) {
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      const ColorType* sourceColor =
+          sourceImage->getColorChannel(channel, sourcePixelIndex);
+      ColorType* destColor =
+          destImage->getColorChannel(channel, destPixelIndex);
+      if (sourceColor != destColor) {
+        std::copy(sourceColor, sourceColor + numPixels, destColor);
+      }
+    }
+    const DepthType* sourceDepth =
+        sourceImage->getDepthBuffer(sourcePixelIndex);
+    DepthType* destDepth = destImage->getDepthBuffer(destPixelIndex);
+    if (sourceDepth != destDepth) {
+      std::copy(sourceDepth, sourceDepth + numPixels, destDepth);
+    }
+  }
+
+  // Depth blends pixels, copying the nearer image wherever the depth ranges
+  // of the two images do not overlap. The ranges must be up to date.
+  static void blendPixelsByDepthRange(const ThisType* topImage,
+                                      int topPixelIndex,
+                                      const ThisType* bottomImage,
+                                      int bottomPixelIndex,
+                                      ThisType* outImage,
+                                      int outPixelIndex,
+                                      int numPixels) {
+    DepthRanges<Features>::forEachDepthOrder(
+        topImage->depthRanges,
+        topImage->getBufferBase(),
+        topPixelIndex + topImage->bufferOffset,
+        bottomImage->depthRanges,
+        bottomImage->getBufferBase(),
+        bottomPixelIndex + bottomImage->bufferOffset,
+        numPixels,
+        [&](int offset, int count, DepthOrder order) {
+          int topBegin = topPixelIndex + offset;
+          int bottomBegin = bottomPixelIndex + offset;
+          int outBegin = outPixelIndex + offset;
+          if (order == DEPTH_ORDER_TOP) {
+            copyPixelData(topImage, topBegin, outImage, outBegin, count);
+            return;
+          } else if (order == DEPTH_ORDER_BOTTOM) {
+            copyPixelData(bottomImage, bottomBegin, outImage, outBegin, count);
+            return;
+          }
+          const ColorType* topColor[ColorVecSize];
+          const ColorType* bottomColor[ColorVecSize];
+          ColorType* outColor[ColorVecSize];
+          for (int channel = 0; channel < ColorVecSize; ++channel) {
+            topColor[channel] = topImage->getColorChannel(channel, topBegin);
+            bottomColor[channel] =
+                bottomImage->getColorChannel(channel, bottomBegin);
+            outColor[channel] = outImage->getColorChannel(channel, outBegin);
+          }
+          Features::blendPixels(topColor,
+                                topImage->getDepthBuffer(topBegin),
+                                bottomColor,
+                                bottomImage->getDepthBuffer(bottomBegin),
+                                outColor,
+                                outImage->getDepthBuffer(outBegin),
+                                count);
+        });
+  }
+
+  // Sets held pixels to an encoded color and depth.
+  void fillPixels(int pixelIndex,
+                  int numPixels,
+                  const ColorType colorValue[ColorVecSize],
+                  const DepthType& depthValue) {
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      std::fill(this->getColorChannel(channel, pixelIndex),
+                this->getColorChannel(channel, pixelIndex + numPixels),
+                colorValue[channel]);
+    }
+    std::fill(this->getDepthBuffer(pixelIndex),
+              this->getDepthBuffer(pixelIndex + numPixels),
+              depthValue);
+    this->depthRanges.invalidate(this->getBufferBase(),
+                                 pixelIndex + this->bufferOffset,
+                                 pixelIndex + this->bufferOffset + numPixels);
+  }
+
+  // Sets held pixels to the background that pixels not held read as.
+  void fillBackground(int pixelIndex, int numPixels) {
+    ColorType colorValue[ColorVecSize];
+    Features::encodeColor(Color(0, 0, 0, 0), colorValue);
+    DepthType depthValue;
+    Features::encodeDepth(1.0f, &depthValue);
+    this->fillPixels(pixelIndex, numPixels, colorValue, depthValue);
+  }
+
+ protected:
+  void clearImpl(const Color& color, float depth) final {
+    int heldBegin = this->getHeldPixelBegin();
+    int numPixels = this->getHeldPixelEnd() - heldBegin;
+    if (numPixels < 1) {
+      return;
+    }
+
+    ColorType colorValue[ColorVecSize];
+    Features::encodeColor(color, colorValue);
+    DepthType depthValue;
+    Features::encodeDepth(depth, &depthValue);
+
+    this->fillPixels(heldBegin, numPixels, colorValue, depthValue);
+  }
+};
+
+#endif  // IMAGECOLORDEPTHPLANAR_HPP
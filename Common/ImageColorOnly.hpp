@@ -9,10 +9,14 @@
 #ifndef IMAGECOLORONLY_HPP
 #define IMAGECOLORONLY_HPP
 
+#include "AlignedAllocator.hpp"
+#include "BufferPool.hpp"
 #include "ImageFull.hpp"
+#include "ThreadPool.hpp"
 
 #include <algorithm>
 #include <memory>
+#include <numeric>
 #include <vector>
 
 struct ImageColorOnlyBase {};
@@ -28,6 +32,10 @@ struct ImageColorOnlyBase {};
 ///   - A static function named blend that takes takes two ColorType arrays
 ///     each representing a single color and a third ColorType array to put
 ///     the result of blending one on top of the other.
+///   - A static function named blendPixels that takes top, bottom, and output
+///     ColorType arrays along with a number of pixels and does the same blend
+///     for all of them. The output array may be the same as an input array.
+///     (overBlendGeneric in BlendKernels.hpp implements this with blend.)
 ///   - A static function named encodeColor that takes a Color object and
 ///     fills a given array of ColorType values.
 ///   - A static function named decodeColor that takes an array of ColorType
@@ -42,19 +50,21 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
  private:
   using ThisType = ImageColorOnly<Features>;
 
-  std::shared_ptr<std::vector<ColorType>> colorBuffer;
+  // Pixel buffers start on cache lines (and optionally huge pages).
+  using ColorBufferType = std::vector<ColorType, AlignedAllocator<ColorType>>;
+
+  std::shared_ptr<ColorBufferType> colorBuffer;
 
   static constexpr int COLOR_BUFFER_TAG = 12900;
 
  protected:
   ImageColorOnly(int _width, int _height)
-      : ImageFull(_width, _height), colorBuffer(new std::vector<ColorType>) {
+      : ImageFull(_width, _height) {
     this->resizeBuffers(this->getRegionBegin(), this->getRegionEnd());
   }
 
   ImageColorOnly(int _width, int _height, int _regionBegin, int _regionEnd)
-      : ImageFull(_width, _height, _regionBegin, _regionEnd),
-        colorBuffer(new std::vector<ColorType>) {
+      : ImageFull(_width, _height, _regionBegin, _regionEnd) {
     this->resizeBuffers(this->getRegionBegin(), this->getRegionEnd());
   }
 
@@ -70,9 +80,24 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
            ((pixelIndex + this->bufferOffset) * ColorVecSize);
   }
 
-  void resizeBuffers(int newRegionBegin, int newRegionEnd) {
+  void resizeBuffers(int newRegionBegin, int newRegionEnd) final {
+    this->resizeBuffers(
+        newRegionBegin, newRegionEnd, 0, newRegionEnd - newRegionBegin);
+  }
+
+  void resizeBuffers(int newRegionBegin,
+                     int newRegionEnd,
+                     int heldPixelBegin,
+                     int heldPixelEnd) final {
+    assert((0 <= heldPixelBegin) && (heldPixelBegin <= heldPixelEnd) &&
+           (heldPixelEnd <= newRegionEnd - newRegionBegin));
     this->resizeRegion(newRegionBegin, newRegionEnd);
-    this->colorBuffer->resize(this->getNumberOfPixels() * ColorVecSize);
+    this->bufferOffset = -heldPixelBegin;
+    this->bufferSize = heldPixelEnd - heldPixelBegin;
+    // A buffer shared with another image (such as a shallow copy or window)
+    // is replaced rather than resized so that the other image is not
+    // corrupted.
+    resizePooledBuffer(this->colorBuffer, this->bufferSize * ColorVecSize);
   }
 
   Color getColor(int x, int y) const {
@@ -83,6 +108,10 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
     assert(pixelIndex >= 0);
     assert(pixelIndex < this->getNumberOfPixels());
 
+    if (!this->holdsPixel(pixelIndex)) {
+      return Color(0, 0, 0, 0);
+    }
+
     return Features::decodeColor(this->getColorBuffer(pixelIndex));
   }
 
@@ -91,12 +120,30 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
   }
 
   void setColor(int pixelIndex, const Color& color) final {
-    assert(pixelIndex >= 0);
-    assert(pixelIndex < this->getNumberOfPixels());
+    assert(this->holdsPixel(pixelIndex) && "Cannot set an unheld pixel.");
 
     Features::encodeColor(color, this->getColorBuffer(pixelIndex));
   }
 
+  /// \brief Encodes a color in the components stored for each pixel.
+  static void encodeColor(const Color& color,
+                          ColorType colorComponents[ColorVecSize]) {
+    Features::encodeColor(color, colorComponents);
+  }
+
+  /// \brief Sets the color of the n'th pixel to an already encoded color.
+  ///
+  /// Code writing the same color to many pixels can encode it once with
+  /// encodeColor rather than on every setColor.
+  void setEncodedColor(int pixelIndex,
+                       const ColorType colorComponents[ColorVecSize]) {
+    assert(this->holdsPixel(pixelIndex) && "Cannot set an unheld pixel.");
+
+    std::copy(colorComponents,
+              colorComponents + ColorVecSize,
+              this->getColorBuffer(pixelIndex));
+  }
+
   float getDepth(int, int) const {
     // No depth
     return 1.0f;
@@ -115,9 +162,11 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
     // No depth
   }
 
-  std::unique_ptr<Image> blend(const Image& _otherImage) const final {
-    const ThisType* otherImage = dynamic_cast<const ThisType*>(&_otherImage);
+  void blendInto(const Image& _otherImage, Image& _outImage) const final {
+    const ThisType* otherImage = sameTypeCast<ThisType>(&_otherImage, this);
     assert((otherImage != NULL) && "Attempting to blend invalid images.");
+    ThisType* outImage = sameTypeCast<ThisType>(&_outImage, this);
+    assert((outImage != NULL) && "Attempting to blend into invalid image.");
 
     const ThisType* topImage = this;
     const ThisType* bottomImage = otherImage;
@@ -129,72 +178,73 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
         std::min(topImage->getRegionBegin(), bottomImage->getRegionBegin());
     int totalRegionEnd =
         std::max(topImage->getRegionEnd(), bottomImage->getRegionEnd());
-
-    std::unique_ptr<Image> outImageHolder = topImage->createNew(
-        this->getWidth(),
-        this->getHeight(),
-        totalRegionBegin,
-        totalRegionEnd,
-        this->getValidViewport().intersectWith(otherImage->getValidViewport()));
-    ThisType* outImage = dynamic_cast<ThisType*>(outImageHolder.get());
-    assert((outImage != NULL) && "Internal error: createNew bad type.");
-
-    int topPixelIndex = 0;
-    int bottomPixelIndex = 0;
-    int outPixelIndex = 0;
-
-    // Manage where part of one image has a region that starts before the other
-    if (topImage->getRegionBegin() < bottomImage->getRegionBegin()) {
-      int numToCopy =
-          bottomImage->getRegionBegin() - topImage->getRegionBegin();
-      std::copy(topImage->getColorBuffer(0),
-                topImage->getColorBuffer(numToCopy),
-                outImage->getColorBuffer(0));
-      topPixelIndex += numToCopy;
-      outPixelIndex += numToCopy;
-    } else if (bottomImage->getRegionBegin() < topImage->getRegionBegin()) {
-      int numToCopy =
-          topImage->getRegionBegin() - bottomImage->getRegionBegin();
-      std::copy(bottomImage->getColorBuffer(0),
-                bottomImage->getColorBuffer(numToCopy),
-                outImage->getColorBuffer(0));
-      bottomPixelIndex += numToCopy;
-      outPixelIndex += numToCopy;
-    }
-
-    // Blend where the two images intersect
-    while ((topPixelIndex < topImage->getNumberOfPixels()) &&
-           (bottomPixelIndex < bottomImage->getNumberOfPixels())) {
-      Features::blend(topImage->getColorBuffer(topPixelIndex),
-                      bottomImage->getColorBuffer(bottomPixelIndex),
-                      outImage->getColorBuffer(outPixelIndex));
-      ++topPixelIndex;
-      ++bottomPixelIndex;
-      ++outPixelIndex;
-    }
-
-    // Manage where part of one image has a region past the end of the other
-    if (topPixelIndex < topImage->getNumberOfPixels()) {
-      int numToCopy = topImage->getNumberOfPixels() - topPixelIndex;
-      std::copy(topImage->getColorBuffer(topPixelIndex),
-                topImage->getColorBuffer(topPixelIndex + numToCopy),
-                outImage->getColorBuffer(outPixelIndex));
-      topPixelIndex += numToCopy;
-      outPixelIndex += numToCopy;
-    }
-
-    if (bottomPixelIndex < bottomImage->getNumberOfPixels()) {
-      int numToCopy = bottomImage->getNumberOfPixels() - bottomPixelIndex;
-      std::copy(bottomImage->getColorBuffer(bottomPixelIndex),
-                bottomImage->getColorBuffer(bottomPixelIndex + numToCopy),
-                outImage->getColorBuffer(outPixelIndex));
-      bottomPixelIndex += numToCopy;
-      outPixelIndex += numToCopy;
+    Viewport totalViewport =
+        this->getValidViewport().intersectWith(otherImage->getValidViewport());
+
+    // The output holds whatever either image holds.
+    int heldBegin;
+    int heldEnd;
+    heldPixelsOfBlend(
+        *topImage, *bottomImage, totalRegionBegin, heldBegin, heldEnd);
+
+    if ((outImage->getRegionBegin() != totalRegionBegin) ||
+        (outImage->getRegionEnd() != totalRegionEnd) ||
+        (outImage->getHeldPixelBegin() != heldBegin - totalRegionBegin) ||
+        (outImage->getHeldPixelEnd() != heldEnd - totalRegionBegin)) {
+      if ((outImage->colorBuffer == topImage->colorBuffer) ||
+          (outImage->colorBuffer == bottomImage->colorBuffer)) {
+        // The output is growing over memory we still need to read. Blend into
+        // new memory and then have the output take it over. The blend sizes
+        // the buffers of the new image.
+        std::unique_ptr<Image> newImageHolder =
+            this->createNew(totalRegionBegin, totalRegionBegin);
+        ThisType* newImage =
+            sameTypeCast<ThisType>(newImageHolder.get(), this);
+        assert((newImage != NULL) && "Internal error: createNew bad type.");
+        this->blendInto(*otherImage, *newImage);
+        outImage->resizeRegion(totalRegionBegin, totalRegionEnd);
+        outImage->setValidViewport(totalViewport);
+        outImage->colorBuffer = newImage->colorBuffer;
+        outImage->bufferOffset = newImage->bufferOffset;
+        outImage->bufferSize = newImage->bufferSize;
+        return;
+      }
+      outImage->resizeBuffers(totalRegionBegin,
+                              totalRegionEnd,
+                              heldBegin - totalRegionBegin,
+                              heldEnd - totalRegionBegin);
     }
 
-    assert(outPixelIndex == outImage->getNumberOfPixels());
-
-    return outImageHolder;
+    // Blend where both images hold pixels, copy where one does, and fill in
+    // background between pixels held by only one of them.
+    forEachHeldSpan(
+        *topImage,
+        *bottomImage,
+        heldBegin,
+        heldEnd,
+        [&](int pixel, int count, bool topHolds, bool bottomHolds) {
+          int topPixelIndex = pixel - topImage->getRegionBegin();
+          int bottomPixelIndex = pixel - bottomImage->getRegionBegin();
+          int outPixelIndex = pixel - totalRegionBegin;
+          if (topHolds && bottomHolds) {
+            parallelFor(count, MIN_PIXELS_PER_THREAD, [&](int begin, int end) {
+              Features::blendPixels(
+                  topImage->getColorBuffer(topPixelIndex + begin),
+                  bottomImage->getColorBuffer(bottomPixelIndex + begin),
+                  outImage->getColorBuffer(outPixelIndex + begin),
+                  end - begin);
+            });
+          } else if (topHolds) {
+            copyPixels(topImage, topPixelIndex, outImage, outPixelIndex, count);
+          } else if (bottomHolds) {
+            copyPixels(
+                bottomImage, bottomPixelIndex, outImage, outPixelIndex, count);
+          } else {
+            outImage->fillBackground(outPixelIndex, count);
+          }
+        });
+
+    outImage->setValidViewport(totalViewport);
   }
 
   bool blendIsOrderDependent() const final { return true; }
@@ -203,15 +253,24 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
                                       int subregionEnd) const final {
     assert(subregionBegin <= subregionEnd);
 
+    // The copy holds the pixels of the subrange that this image holds.
+    int heldBegin = std::min(
+        std::max(this->getHeldPixelBegin(), subregionBegin), subregionEnd);
+    int heldEnd =
+        std::max(std::min(this->getHeldPixelEnd(), subregionEnd), heldBegin);
     std::unique_ptr<Image> outImageHolder =
-        this->createNew(subregionBegin + this->getRegionBegin(),
-                        subregionEnd + this->getRegionBegin());
+        this->createNewCropped(subregionBegin + this->getRegionBegin(),
+                               subregionEnd + this->getRegionBegin(),
+                               heldBegin - subregionBegin,
+                               heldEnd - subregionBegin);
     ThisType* subImage = dynamic_cast<ThisType*>(outImageHolder.get());
     assert((subImage != NULL) && "Internal error: createNew bad type.");
 
-    std::copy(this->getColorBuffer(subregionBegin),
-              this->getColorBuffer(subregionEnd),
-              subImage->getColorBuffer());
+    copyPixels(this,
+               heldBegin,
+               subImage,
+               heldBegin - subregionBegin,
+               heldEnd - heldBegin);
 
     return outImageHolder;
   }
@@ -224,8 +283,12 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
     int numProc;
     MPI_Comm_size(communicator, &numProc);
 
+    // Only the held pixels are sent.
+    int heldBegin = this->getHeldPixelBegin();
+    int heldEnd = this->getHeldPixelEnd();
+
     std::vector<int> allRegionBegin(numProc);
-    int regionBegin = this->getRegionBegin() * sizeof(ColorType) * ColorVecSize;
+    int regionBegin = (this->getRegionBegin() + heldBegin) * sizeof(ColorType) * ColorVecSize;
     MPI_Gather(&regionBegin,
                1,
                MPI_INT,
@@ -236,7 +299,7 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
                communicator);
 
     std::vector<int> allRegionCounts(numProc);
-    int dataSize = this->getNumberOfPixels() * sizeof(ColorType) * ColorVecSize;
+    int dataSize = (heldEnd - heldBegin) * sizeof(ColorType) * ColorVecSize;
     MPI_Gather(&dataSize,
                1,
                MPI_INT,
@@ -255,7 +318,14 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
     ThisType* recvImage = dynamic_cast<ThisType*>(outImageHolder.release());
     assert((recvImage != NULL) && "Internal error: createNew bad type.");
 
-    MPI_Gatherv(this->getColorBuffer(),
+    // Pixels that no image holds are background.
+    if ((rank == recvRank) &&
+        (std::accumulate(allRegionCounts.begin(), allRegionCounts.end(), 0) <
+         static_cast<int>(recvImage->getNumberOfPixels() * sizeof(ColorType) * ColorVecSize))) {
+      recvImage->clear();
+    }
+
+    MPI_Gatherv(this->getColorBuffer(heldBegin),
                 dataSize,
                 MPI_BYTE,
                 recvImage->getColorBuffer(),
@@ -271,11 +341,13 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
   std::vector<MPI_Request> ISend(int destRank,
                                  MPI_Comm communicator) const final {
     std::vector<MPI_Request> requests =
-        this->ISendMetaData(destRank, communicator);
+        this->ISendBufferMetaData(destRank, communicator);
+    int heldBegin = this->getHeldPixelBegin();
+    int heldEnd = this->getHeldPixelEnd();
 
     MPI_Request colorRequest;
-    MPI_Isend(this->getColorBuffer(),
-              this->getNumberOfPixels() * sizeof(ColorType) * ColorVecSize,
+    MPI_Isend(this->getColorBuffer(heldBegin),
+              (heldEnd - heldBegin) * sizeof(ColorType) * ColorVecSize,
               MPI_BYTE,
               destRank,
               COLOR_BUFFER_TAG,
@@ -289,10 +361,10 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
   std::vector<MPI_Request> IReceive(int sourceRank,
                                     MPI_Comm communicator) final {
     std::vector<MPI_Request> requests =
-        this->IReceiveMetaData(sourceRank, communicator);
+        this->IReceiveBufferMetaData(sourceRank, communicator);
 
     MPI_Request colorRequest;
-    MPI_Irecv(this->getColorBuffer(),
+    MPI_Irecv(this->colorBuffer->data(),
               this->getNumberOfPixels() * sizeof(ColorType) * ColorVecSize,
               MPI_BYTE,
               sourceRank,
@@ -304,9 +376,48 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
     return requests;
   }
 
+ private:
+  // Copies pixels between images. When blending in place the source and
+  // destination can be the same memory, in which case there is nothing to do.
+  static void copyPixels(const ThisType* sourceImage,
+                         int sourcePixelIndex,
+                         ThisType* destImage,
+                         int destPixelIndex,
+                         int numPixels) {
+    const ColorType* sourceColor =
+        sourceImage->getColorBuffer(sourcePixelIndex);
+    ColorType* destColor = destImage->getColorBuffer(destPixelIndex);
+    if (sourceColor != destColor) {
+      std::copy(sourceColor, sourceColor + numPixels * ColorVecSize, destColor);
+    }
+  }
+
+  // Sets held pixels to an encoded color.
+  void fillPixels(int pixelIndex,
+                  int numPixels,
+                  const ColorType colorValue[ColorVecSize]) {
+    ColorType* cBuffer = this->getColorBuffer(pixelIndex);
+
+    for (int i = 0; i < numPixels; ++i) {
+      for (int colorComponent = 0; colorComponent < ColorVecSize;
+           ++colorComponent) {
+        cBuffer[i * ColorVecSize + colorComponent] =
+            colorValue[colorComponent];
+      }
+    }
+  }
+
+  // Sets held pixels to the background that pixels not held read as.
+  void fillBackground(int pixelIndex, int numPixels) {
+    ColorType colorValue[ColorVecSize];
+    Features::encodeColor(Color(0, 0, 0, 0), colorValue);
+    this->fillPixels(pixelIndex, numPixels, colorValue);
+  }
+
  protected:
   void clearImpl(const Color& color, float) final {
-    int numPixels = this->getNumberOfPixels();
+    int heldBegin = this->getHeldPixelBegin();
+    int numPixels = this->getHeldPixelEnd() - heldBegin;
     if (numPixels < 1) {
       return;
     }
@@ -314,15 +425,7 @@ class ImageColorOnly : public ImageFull, ImageColorOnlyBase {
     ColorType colorValue[ColorVecSize];
     Features::encodeColor(color, colorValue);
 
-    ColorType* cBuffer = this->getColorBuffer();
-
-    for (int pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
-      for (int colorComponent = 0; colorComponent < ColorVecSize;
-           ++colorComponent) {
-        cBuffer[pixelIndex * ColorVecSize + colorComponent] =
-            colorValue[colorComponent];
-      }
-    }
+    this->fillPixels(heldBegin, numPixels, colorValue);
   }
 };
 
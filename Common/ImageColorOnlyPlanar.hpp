@@ -0,0 +1,472 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef IMAGECOLORONLYPLANAR_HPP
+#define IMAGECOLORONLYPLANAR_HPP
+
+#include "AlignedAllocator.hpp"
+#include "BufferPool.hpp"
+#include "ImageColorOnly.hpp"
+#include "ImageFull.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+/// \brief Implementation of color-only images with planar color channels
+///
+/// ImageColorOnlyPlanar behaves like ImageColorOnly except that each color
+/// channel is kept in its own contiguous array rather than interleaving the
+/// channels of each pixel. This lets blending operate on whole vectors of a
+/// single channel. The features structure must contain the same items as
+/// that of ImageColorOnly except for blendPixels, which takes arrays of
+/// ColorVecSize channel pointers for the top, bottom, and output colors.
+/// Additionally, the features structure must contain the following item.
+///   - An InterleavedFeatures typename giving the features of the equivalent
+///     interleaved ImageColorOnly. Compressed images store their active
+///     pixels in that layout.
+///
+/// All color channels share a single buffer. Channel c of pixel i is at
+/// c * channelStride + i, where channelStride is the number of pixels in the
+/// image that allocated the buffer (windows keep the stride of the image they
+/// were made from).
+///
+template <typename Features>
+class ImageColorOnlyPlanar : public ImageFull, ImageColorOnlyBase {
+ public:
+  using ColorType = typename Features::ColorType;
+  static constexpr int ColorVecSize = Features::ColorVecSize;
+
+ private:
+  using ThisType = ImageColorOnlyPlanar<Features>;
+
+  using ColorBufferType = std::vector<ColorType, AlignedAllocator<ColorType>>;
+
+  std::shared_ptr<ColorBufferType> colorBuffer;
+  int channelStride;
+
+  // Channel c of the color is sent with tag COLOR_BUFFER_TAG + c.
+  static constexpr int COLOR_BUFFER_TAG = 12910;
+
+ protected:
+  ImageColorOnlyPlanar(int _width, int _height)
+      : ImageFull(_width, _height), channelStride(0) {
+    this->resizeBuffers(this->getRegionBegin(), this->getRegionEnd());
+  }
+
+  ImageColorOnlyPlanar(int _width,
+                       int _height,
+                       int _regionBegin,
+                       int _regionEnd)
+      : ImageFull(_width, _height, _regionBegin, _regionEnd),
+        channelStride(0) {
+    this->resizeBuffers(this->getRegionBegin(), this->getRegionEnd());
+  }
+
+ public:
+  ~ImageColorOnlyPlanar() = default;
+
+  ColorType* getColorChannel(int channel, int pixelIndex = 0) {
+    return this->colorBuffer->data() + (channel * this->channelStride) +
+           pixelIndex + this->bufferOffset;
+  }
+  const ColorType* getColorChannel(int channel, int pixelIndex = 0) const {
+    return this->colorBuffer->data() + (channel * this->channelStride) +
+           pixelIndex + this->bufferOffset;
+  }
+
+  /// \brief Copies colors out with the channels of each pixel interleaved.
+  void getInterleavedColors(int pixelIndex,
+                            int numPixels,
+                            ColorType* interleavedColors) const {
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      const ColorType* channelColors =
+          this->getColorChannel(channel, pixelIndex);
+      for (int i = 0; i < numPixels; ++i) {
+        interleavedColors[i * ColorVecSize + channel] = channelColors[i];
+      }
+    }
+  }
+
+  void resizeBuffers(int newRegionBegin, int newRegionEnd) final {
+    this->resizeBuffers(
+        newRegionBegin, newRegionEnd, 0, newRegionEnd - newRegionBegin);
+  }
+
+  void resizeBuffers(int newRegionBegin,
+                     int newRegionEnd,
+                     int heldPixelBegin,
+                     int heldPixelEnd) final {
+    assert((0 <= heldPixelBegin) && (heldPixelBegin <= heldPixelEnd) &&
+           (heldPixelEnd <= newRegionEnd - newRegionBegin));
+    this->resizeRegion(newRegionBegin, newRegionEnd);
+    this->bufferOffset = -heldPixelBegin;
+    this->bufferSize = heldPixelEnd - heldPixelBegin;
+    // A buffer shared with another image (such as a shallow copy or window)
+    // is replaced rather than resized so that the other image is not
+    // corrupted.
+    resizePooledBuffer(this->colorBuffer, this->bufferSize * ColorVecSize);
+    this->channelStride = this->bufferSize;
+  }
+
+  Color getColor(int x, int y) const {
+    return this->getColor(this->pixelIndex(x, y));
+  }
+
+  Color getColor(int pixelIndex) const final {
+    assert(pixelIndex >= 0);
+    assert(pixelIndex < this->getNumberOfPixels());
+
+    if (!this->holdsPixel(pixelIndex)) {
+      return Color(0, 0, 0, 0);
+    }
+
+    ColorType colorComponents[ColorVecSize];
+    this->getInterleavedColors(pixelIndex, 1, colorComponents);
+    return Features::decodeColor(colorComponents);
+  }
+
+  void setColor(int x, int y, const Color& color) {
+    this->setColor(this->pixelIndex(x, y), color);
+  }
+
+  void setColor(int pixelIndex, const Color& color) final {
+    assert(this->holdsPixel(pixelIndex) && "Cannot set an unheld pixel.");
+
+    ColorType colorComponents[ColorVecSize];
+    Features::encodeColor(color, colorComponents);
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      *this->getColorChannel(channel, pixelIndex) = colorComponents[channel];
+    }
+  }
+
+  /// \brief Encodes a color in the components stored for each pixel.
+  static void encodeColor(const Color& color,
+                          ColorType colorComponents[ColorVecSize]) {
+    Features::encodeColor(color, colorComponents);
+  }
+
+  /// \brief Sets the color of the n'th pixel to an already encoded color.
+  ///
+  /// Code writing the same color to many pixels can encode it once with
+  /// encodeColor rather than on every setColor.
+  void setEncodedColor(int pixelIndex,
+                       const ColorType colorComponents[ColorVecSize]) {
+    assert(this->holdsPixel(pixelIndex) && "Cannot set an unheld pixel.");
+
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      *this->getColorChannel(channel, pixelIndex) = colorComponents[channel];
+    }
+  }
+
+  float getDepth(int, int) const {
+    // No depth
+    return 1.0f;
+  }
+
+  float getDepth(int) const final {
+    // No depth
+    return 1.0f;
+  }
+
+  void setDepth(int, int, float) {
+    // No depth
+  }
+
+  void setDepth(int, float) final {
+    // No depth
+  }
+
+  void blendInto(const Image& _otherImage, Image& _outImage) const final {
+    const ThisType* otherImage = sameTypeCast<ThisType>(&_otherImage, this);
+    assert((otherImage != NULL) && "Attempting to blend invalid images.");
+    ThisType* outImage = sameTypeCast<ThisType>(&_outImage, this);
+    assert((outImage != NULL) && "Attempting to blend into invalid image.");
+
+    const ThisType* topImage = this;
+    const ThisType* bottomImage = otherImage;
+
+    assert(topImage->getRegionBegin() <= bottomImage->getRegionEnd());
+    assert(bottomImage->getRegionBegin() <= topImage->getRegionEnd());
+
+    int totalRegionBegin =
+        std::min(topImage->getRegionBegin(), bottomImage->getRegionBegin());
+    int totalRegionEnd =
+        std::max(topImage->getRegionEnd(), bottomImage->getRegionEnd());
+    Viewport totalViewport =
+        this->getValidViewport().intersectWith(otherImage->getValidViewport());
+
+    // The output holds whatever either image holds.
+    int heldBegin;
+    int heldEnd;
+    heldPixelsOfBlend(
+        *topImage, *bottomImage, totalRegionBegin, heldBegin, heldEnd);
+
+    if ((outImage->getRegionBegin() != totalRegionBegin) ||
+        (outImage->getRegionEnd() != totalRegionEnd) ||
+        (outImage->getHeldPixelBegin() != heldBegin - totalRegionBegin) ||
+        (outImage->getHeldPixelEnd() != heldEnd - totalRegionBegin)) {
+      if ((outImage->colorBuffer == topImage->colorBuffer) ||
+          (outImage->colorBuffer == bottomImage->colorBuffer)) {
+        // The output is growing over memory we still need to read. Blend into
+        // new memory and then have the output take it over. The blend sizes
+        // the buffers of the new image.
+        std::unique_ptr<Image> newImageHolder =
+            this->createNew(totalRegionBegin, totalRegionBegin);
+        ThisType* newImage =
+            sameTypeCast<ThisType>(newImageHolder.get(), this);
+        assert((newImage != NULL) && "Internal error: createNew bad type.");
+        this->blendInto(*otherImage, *newImage);
+        outImage->resizeRegion(totalRegionBegin, totalRegionEnd);
+        outImage->setValidViewport(totalViewport);
+        outImage->colorBuffer = newImage->colorBuffer;
+        outImage->channelStride = newImage->channelStride;
+        outImage->bufferOffset = newImage->bufferOffset;
+        outImage->bufferSize = newImage->bufferSize;
+        return;
+      }
+      outImage->resizeBuffers(totalRegionBegin,
+                              totalRegionEnd,
+                              heldBegin - totalRegionBegin,
+                              heldEnd - totalRegionBegin);
+    }
+
+    // Blend where both images hold pixels, copy where one does, and fill in
+    // background between pixels held by only one of them.
+    forEachHeldSpan(
+        *topImage,
+        *bottomImage,
+        heldBegin,
+        heldEnd,
+        [&](int pixel, int count, bool topHolds, bool bottomHolds) {
+          int topPixelIndex = pixel - topImage->getRegionBegin();
+          int bottomPixelIndex = pixel - bottomImage->getRegionBegin();
+          int outPixelIndex = pixel - totalRegionBegin;
+          if (topHolds && bottomHolds) {
+            parallelFor(count, MIN_PIXELS_PER_THREAD, [&](int begin, int end) {
+              int topBegin = topPixelIndex + begin;
+              int bottomBegin = bottomPixelIndex + begin;
+              int outBegin = outPixelIndex + begin;
+              const ColorType* topColor[ColorVecSize];
+              const ColorType* bottomColor[ColorVecSize];
+              ColorType* outColor[ColorVecSize];
+              for (int channel = 0; channel < ColorVecSize; ++channel) {
+                topColor[channel] = topImage->getColorChannel(channel, topBegin);
+                bottomColor[channel] =
+                    bottomImage->getColorChannel(channel, bottomBegin);
+                outColor[channel] = outImage->getColorChannel(channel, outBegin);
+              }
+              Features::blendPixels(topColor, bottomColor, outColor, end - begin);
+            });
+          } else if (topHolds) {
+            copyPixels(topImage, topPixelIndex, outImage, outPixelIndex, count);
+          } else if (bottomHolds) {
+            copyPixels(
+                bottomImage, bottomPixelIndex, outImage, outPixelIndex, count);
+          } else {
+            outImage->fillBackground(outPixelIndex, count);
+          }
+        });
+
+    outImage->setValidViewport(totalViewport);
+  }
+
+  bool blendIsOrderDependent() const final { return true; }
+
+  std::unique_ptr<Image> copySubrange(int subregionBegin,
+                                      int subregionEnd) const final {
+    assert(subregionBegin <= subregionEnd);
+
+    // The copy holds the pixels of the subrange that this image holds.
+    int heldBegin = std::min(
+        std::max(this->getHeldPixelBegin(), subregionBegin), subregionEnd);
+    int heldEnd =
+        std::max(std::min(this->getHeldPixelEnd(), subregionEnd), heldBegin);
+    std::unique_ptr<Image> outImageHolder =
+        this->createNewCropped(subregionBegin + this->getRegionBegin(),
+                               subregionEnd + this->getRegionBegin(),
+                               heldBegin - subregionBegin,
+                               heldEnd - subregionBegin);
+    ThisType* subImage = dynamic_cast<ThisType*>(outImageHolder.get());
+    assert((subImage != NULL) && "Internal error: createNew bad type.");
+
+    copyPixels(this,
+               heldBegin,
+               subImage,
+               heldBegin - subregionBegin,
+               heldEnd - heldBegin);
+
+    return outImageHolder;
+  }
+
+  std::unique_ptr<ImageFull> Gather(int recvRank,
+                                    MPI_Comm communicator) const final {
+    int rank;
+    MPI_Comm_rank(communicator, &rank);
+
+    int numProc;
+    MPI_Comm_size(communicator, &numProc);
+
+    // Each channel is gathered separately, so offsets are within a channel.
+    // Only the held pixels are sent.
+    int heldBegin = this->getHeldPixelBegin();
+    int heldEnd = this->getHeldPixelEnd();
+
+    std::vector<int> allRegionBegin(numProc);
+    int regionBegin = (this->getRegionBegin() + heldBegin) * sizeof(ColorType);
+    MPI_Gather(&regionBegin,
+               1,
+               MPI_INT,
+               allRegionBegin.data(),
+               1,
+               MPI_INT,
+               recvRank,
+               communicator);
+
+    std::vector<int> allRegionCounts(numProc);
+    int dataSize = (heldEnd - heldBegin) * sizeof(ColorType);
+    MPI_Gather(&dataSize,
+               1,
+               MPI_INT,
+               allRegionCounts.data(),
+               1,
+               MPI_INT,
+               recvRank,
+               communicator);
+
+    std::unique_ptr<Image> outImageHolder = this->createNew(
+        this->getWidth(),
+        this->getHeight(),
+        0,
+        this->getWidth() * this->getHeight(),
+        Viewport(0, 0, this->getWidth() - 1, this->getHeight() - 1));
+    ThisType* recvImage = dynamic_cast<ThisType*>(outImageHolder.release());
+    assert((recvImage != NULL) && "Internal error: createNew bad type.");
+
+    // Pixels that no image holds are background.
+    if ((rank == recvRank) &&
+        (std::accumulate(allRegionCounts.begin(), allRegionCounts.end(), 0) <
+         static_cast<int>(recvImage->getNumberOfPixels() * sizeof(ColorType)))) {
+      recvImage->clear();
+    }
+
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      MPI_Gatherv(this->getColorChannel(channel, heldBegin),
+                  dataSize,
+                  MPI_BYTE,
+                  recvImage->getColorChannel(channel),
+                  allRegionCounts.data(),
+                  allRegionBegin.data(),
+                  MPI_BYTE,
+                  recvRank,
+                  communicator);
+    }
+
+    return std::unique_ptr<ImageFull>(recvImage);
+  }
+
+  std::vector<MPI_Request> ISend(int destRank,
+                                 MPI_Comm communicator) const final {
+    std::vector<MPI_Request> requests =
+        this->ISendBufferMetaData(destRank, communicator);
+    int heldBegin = this->getHeldPixelBegin();
+    int heldEnd = this->getHeldPixelEnd();
+
+    // Each channel goes in its own message. The receiver does not know how
+    // many pixels are coming until the metadata arrives, so the channels
+    // cannot be packed together.
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      MPI_Request colorRequest;
+      MPI_Isend(this->getColorChannel(channel, heldBegin),
+                (heldEnd - heldBegin) * sizeof(ColorType),
+                MPI_BYTE,
+                destRank,
+                COLOR_BUFFER_TAG + channel,
+                communicator,
+                &colorRequest);
+      requests.push_back(colorRequest);
+    }
+
+    return requests;
+  }
+
+  std::vector<MPI_Request> IReceive(int sourceRank,
+                                    MPI_Comm communicator) final {
+    std::vector<MPI_Request> requests =
+        this->IReceiveBufferMetaData(sourceRank, communicator);
+
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      MPI_Request colorRequest;
+      MPI_Irecv(this->colorBuffer->data() + (channel * this->channelStride),
+                this->getNumberOfPixels() * sizeof(ColorType),
+                MPI_BYTE,
+                sourceRank,
+                COLOR_BUFFER_TAG + channel,
+                communicator,
+                &colorRequest);
+      requests.push_back(colorRequest);
+    }
+
+    return requests;
+  }
+
+ private:
+  // Copies pixels between images. When blending in place the source and
+  // destination can be the same memory, in which case there is nothing to do.
+  static void copyPixels(const ThisType* sourceImage,
+                         int sourcePixelIndex,
+                         ThisType* destImage,
+                         int destPixelIndex,
+                         int numPixels) {
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      const ColorType* sourceColor =
+          sourceImage->getColorChannel(channel, sourcePixelIndex);
+      ColorType* destColor =
+          destImage->getColorChannel(channel, destPixelIndex);
+      if (sourceColor != destColor) {
+        std::copy(sourceColor, sourceColor + numPixels, destColor);
+      }
+    }
+  }
+
+  // Sets held pixels to an encoded color.
+  void fillPixels(int pixelIndex,
+                  int numPixels,
+                  const ColorType colorValue[ColorVecSize]) {
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      std::fill(this->getColorChannel(channel, pixelIndex),
+                this->getColorChannel(channel, pixelIndex + numPixels),
+                colorValue[channel]);
+    }
+  }
+
+  // Sets held pixels to the background that pixels not held read as.
+  void fillBackground(int pixelIndex, int numPixels) {
+    ColorType colorValue[ColorVecSize];
+    Features::encodeColor(Color(0, 0, 0, 0), colorValue);
+    this->fillPixels(pixelIndex, numPixels, colorValue);
+  }
+
+ protected:
+  void clearImpl(const Color& color, float) final {
+    int heldBegin = this->getHeldPixelBegin();
+    int numPixels = this->getHeldPixelEnd() - heldBegin;
+    if (numPixels < 1) {
+      return;
+    }
+
+    ColorType colorValue[ColorVecSize];
+    Features::encodeColor(color, colorValue);
+
+    this->fillPixels(heldBegin, numPixels, colorValue);
+  }
+};
+
+#endif  // IMAGECOLORONLYPLANAR_HPP
@@ -0,0 +1,91 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef IMAGEDISPATCH_HPP
+#define IMAGEDISPATCH_HPP
+
+#include "ImageRGBAFloatColorOnly.hpp"
+#include "ImageRGBAFloatPlanarColorOnly.hpp"
+#include "ImageRGBAHalfColorOnly.hpp"
+#include "ImageRGBAUByteColorFloatDepth.hpp"
+#include "ImageRGBAUByteColorOnly.hpp"
+#include "ImageRGBFloatColorDepth.hpp"
+#include "ImageRGBFloatPlanarColorDepth.hpp"
+#include "ImageRGBHalfColorHalfDepth.hpp"
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <tuple>
+#include <typeinfo>
+
+/// The full image classes that dispatchImageFull resolves.
+using ImageFullTypes = std::tuple<ImageRGBAFloatColorOnly,
+                                  ImageRGBAFloatPlanarColorOnly,
+                                  ImageRGBAHalfColorOnly,
+                                  ImageRGBAUByteColorFloatDepth,
+                                  ImageRGBAUByteColorOnly,
+                                  ImageRGBFloatColorDepth,
+                                  ImageRGBFloatPlanarColorDepth,
+                                  ImageRGBHalfColorHalfDepth>;
+
+// Tries the classes of ImageFullTypes from TypeIndex on.
+template <std::size_t TypeIndex,
+          std::size_t NumTypes = std::tuple_size<ImageFullTypes>::value>
+struct ImageFullDispatcher {
+  using ImageType =
+      typename std::tuple_element<TypeIndex, ImageFullTypes>::type;
+
+  template <typename Kernel>
+  static void dispatch(ImageFull& image, Kernel& kernel) {
+    if (typeid(image) == typeid(ImageType)) {
+      kernel(static_cast<ImageType&>(image));
+    } else {
+      ImageFullDispatcher<TypeIndex + 1>::dispatch(image, kernel);
+    }
+  }
+
+  template <typename Kernel>
+  static void dispatch(const ImageFull& image, Kernel& kernel) {
+    if (typeid(image) == typeid(ImageType)) {
+      kernel(static_cast<const ImageType&>(image));
+    } else {
+      ImageFullDispatcher<TypeIndex + 1>::dispatch(image, kernel);
+    }
+  }
+};
+
+template <std::size_t NumTypes>
+struct ImageFullDispatcher<NumTypes, NumTypes> {
+  template <typename ImageRef, typename Kernel>
+  static void dispatch(ImageRef& image, Kernel&) {
+    std::cerr << "Unknown image class " << typeid(image).name() << std::endl;
+    abort();
+  }
+};
+
+/// \brief Runs a kernel on an image cast to its concrete class.
+///
+/// The virtual pixel accessors of ImageFull cost a virtual call and a Color
+/// conversion for every pixel. Code that visits many pixels can instead put
+/// its loop in the templated operator() of a kernel object, which this calls
+/// once with the image cast to its class in ImageFullTypes. Within the
+/// kernel, the accessors of the image are not virtual, and the encoded
+/// buffers can be used directly.
+///
+template <typename Kernel>
+void dispatchImageFull(ImageFull& image, Kernel&& kernel) {
+  ImageFullDispatcher<0>::dispatch(image, kernel);
+}
+
+template <typename Kernel>
+void dispatchImageFull(const ImageFull& image, Kernel&& kernel) {
+  ImageFullDispatcher<0>::dispatch(image, kernel);
+}
+
+#endif  // IMAGEDISPATCH_HPP
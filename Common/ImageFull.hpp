@@ -11,17 +11,107 @@
 
 #include "Image.hpp"
 
+#include <algorithm>
+
 class ImageSparse;
 
 class ImageFull : public Image {
  protected:
+  // Buffer element of the first pixel of the region. Windows start past the
+  // beginning of the buffers. Cropped images can start before it (that is,
+  // the offset is negative) when they do not hold their first pixels.
   int bufferOffset;
+  // Number of buffer elements holding pixels.
+  int bufferSize;
+
   ImageFull(int _width, int _height)
-      : Image(_width, _height, 0, _width * _height), bufferOffset(0) {}
+      : Image(_width, _height, 0, _width * _height),
+        bufferOffset(0),
+        bufferSize(0) {}
   ImageFull(int _width, int _height, int _regionBegin, int _regionEnd)
-      : Image(_width, _height, _regionBegin, _regionEnd), bufferOffset(0) {}
+      : Image(_width, _height, _regionBegin, _regionEnd),
+        bufferOffset(0),
+        bufferSize(0) {}
 
  public:
+  using Image::resizeBuffers;
+
+  /// \brief Changes the region of pixels and which of them are held.
+  ///
+  /// Like resizeBuffers, except that memory is only kept for the pixels
+  /// [heldPixelBegin, heldPixelEnd) of the new region. The rest of the
+  /// pixels are background (see getHeldPixelBegin).
+  virtual void resizeBuffers(int newRegionBegin,
+                             int newRegionEnd,
+                             int heldPixelBegin,
+                             int heldPixelEnd) = 0;
+
+  /// \brief Returns the first pixel held in memory.
+  ///
+  /// An image can be cropped so that its buffers hold only the pixels
+  /// [getHeldPixelBegin(), getHeldPixelEnd()) of its region, which saves
+  /// clearing, blending, and sending the others. Pixels that are not held
+  /// are background: transparent black at the far depth, which is what
+  /// clear sets by default. Reading them gives the background. They cannot
+  /// be set.
+  int getHeldPixelBegin() const {
+    return std::min(std::max(-this->bufferOffset, 0),
+                    this->getNumberOfPixels());
+  }
+
+  /// \brief Returns one past the last pixel held in memory.
+  int getHeldPixelEnd() const {
+    return std::min(std::max(this->bufferSize - this->bufferOffset,
+                             this->getHeldPixelBegin()),
+                    this->getNumberOfPixels());
+  }
+
+  bool holdsPixel(int pixelIndex) const {
+    return (pixelIndex >= this->getHeldPixelBegin()) &&
+           (pixelIndex < this->getHeldPixelEnd());
+  }
+
+  bool holdsAllPixels() const {
+    return (this->getHeldPixelBegin() == 0) &&
+           (this->getHeldPixelEnd() == this->getNumberOfPixels());
+  }
+
+  /// \brief Crops the image to the pixels of its valid viewport.
+  ///
+  /// Buffers can only hold a contiguous range of pixels, so this holds all
+  /// pixels from the first to the last one in the viewport. In scanline
+  /// order those are the rows the viewport spans. Like resizeBuffers, this
+  /// leaves the held pixels undefined.
+  void cropToValidViewport() {
+    Viewport viewport = this->getValidViewport().intersectWith(
+        Viewport(0, 0, this->getWidth() - 1, this->getHeight() - 1));
+    int heldBegin = this->getNumberOfPixels();
+    int heldEnd = 0;
+    if ((viewport.getWidth() > 0) && (viewport.getHeight() > 0)) {
+      // In each row of tiles, the viewport starts in the first row of its
+      // leftmost tile and ends in the last row of its rightmost tile.
+      int tileHeight = this->getTileHeight();
+      for (int tileRow = viewport.getMinY() / tileHeight;
+           tileRow <= viewport.getMaxY() / tileHeight;
+           ++tileRow) {
+        int minY = std::max(viewport.getMinY(), tileRow * tileHeight);
+        int maxY =
+            std::min(viewport.getMaxY(), (tileRow + 1) * tileHeight - 1);
+        heldBegin =
+            std::min(heldBegin, this->pixelIndex(viewport.getMinX(), minY));
+        heldEnd = std::max(heldEnd,
+                           this->pixelIndex(viewport.getMaxX(), maxY) + 1);
+      }
+    }
+    heldBegin = std::max(heldBegin, 0);
+    heldEnd = std::min(heldEnd, this->getNumberOfPixels());
+    if (heldEnd <= heldBegin) {
+      heldBegin = heldEnd = 0;
+    }
+    this->resizeBuffers(
+        this->getRegionBegin(), this->getRegionEnd(), heldBegin, heldEnd);
+  }
+
   /// \brief Gets the color of the n'th pixel.
   virtual Color getColor(int pixelIndex) const = 0;
 
@@ -87,6 +177,165 @@ class ImageFull : public Image {
   /// distinct subregion.
   virtual std::unique_ptr<ImageFull> Gather(int recvRank,
                                             MPI_Comm communicator) const = 0;
+
+ protected:
+  /// \brief Sends the metadata and the layout of the held pixels.
+  ///
+  /// Implementations of ISend use this in place of ISendMetaData and then
+  /// send the held pixels starting with getHeldPixelBegin.
+  std::vector<MPI_Request> ISendBufferMetaData(int destRank,
+                                               MPI_Comm communicator) const {
+    std::vector<MPI_Request> requests =
+        this->ISendMetaData(destRank, communicator);
+
+    // The receiver holds the same pixels starting at its first element.
+    this->sentLayout[0] = -this->getHeldPixelBegin();
+    this->sentLayout[1] = this->getHeldPixelEnd() - this->getHeldPixelBegin();
+    MPI_Request offsetRequest;
+    MPI_Isend(&this->sentLayout[0],
+              1,
+              MPI_INT,
+              destRank,
+              BUFFER_OFFSET_TAG,
+              communicator,
+              &offsetRequest);
+    requests.push_back(offsetRequest);
+    MPI_Request sizeRequest;
+    MPI_Isend(&this->sentLayout[1],
+              1,
+              MPI_INT,
+              destRank,
+              BUFFER_SIZE_TAG,
+              communicator,
+              &sizeRequest);
+    requests.push_back(sizeRequest);
+
+    return requests;
+  }
+
+  /// \brief Receives what ISendBufferMetaData sends.
+  ///
+  /// The held pixels then arrive at the start of the buffers, which this
+  /// makes big enough for all the pixels of the current region. Until the
+  /// requests finish, the buffer layout is not known.
+  std::vector<MPI_Request> IReceiveBufferMetaData(int sourceRank,
+                                                  MPI_Comm communicator) {
+    assert((this->bufferOffset <= 0) && "Cannot receive into a window.");
+    if (!this->holdsAllPixels()) {
+      // The sender may hold all of its pixels.
+      this->resizeBuffers(this->getRegionBegin(), this->getRegionEnd());
+    }
+
+    std::vector<MPI_Request> requests =
+        this->IReceiveMetaData(sourceRank, communicator);
+
+    MPI_Request offsetRequest;
+    MPI_Irecv(&this->bufferOffset,
+              1,
+              MPI_INT,
+              sourceRank,
+              BUFFER_OFFSET_TAG,
+              communicator,
+              &offsetRequest);
+    requests.push_back(offsetRequest);
+    MPI_Request sizeRequest;
+    MPI_Irecv(&this->bufferSize,
+              1,
+              MPI_INT,
+              sourceRank,
+              BUFFER_SIZE_TAG,
+              communicator,
+              &sizeRequest);
+    requests.push_back(sizeRequest);
+
+    return requests;
+  }
+
+  /// \brief Creates a new image holding only some of its pixels.
+  ///
+  /// Like createNew, but the buffers hold only the pixels [heldPixelBegin,
+  /// heldPixelEnd) of the new region.
+  std::unique_ptr<ImageFull> createNewCropped(int regionBegin,
+                                              int regionEnd,
+                                              int heldPixelBegin,
+                                              int heldPixelEnd) const {
+    // Start with an empty region so that memory is only taken for the held
+    // pixels.
+    std::unique_ptr<ImageFull> newImage(
+        dynamic_cast<ImageFull*>(this->createNew(regionBegin, regionBegin)
+                                     .release()));
+    assert((newImage != NULL) && "Internal error: createNew bad type.");
+    newImage->resizeBuffers(
+        regionBegin, regionEnd, heldPixelBegin, heldPixelEnd);
+    return newImage;
+  }
+
+  /// \brief Splits pixels by which of two images hold them.
+  ///
+  /// Walks the pixels with global indices [pixelBegin, pixelEnd) and calls
+  /// visit(pixel, count, firstHolds, secondHolds) for each span of them
+  /// that each image holds all or none of. Pixels outside the region of an
+  /// image are not held by it.
+  template <typename Visit>
+  static void forEachHeldSpan(const ImageFull& first,
+                              const ImageFull& second,
+                              int pixelBegin,
+                              int pixelEnd,
+                              const Visit& visit) {
+    int firstBegin = first.getRegionBegin() + first.getHeldPixelBegin();
+    int firstEnd = first.getRegionBegin() + first.getHeldPixelEnd();
+    int secondBegin = second.getRegionBegin() + second.getHeldPixelBegin();
+    int secondEnd = second.getRegionBegin() + second.getHeldPixelEnd();
+    const int bounds[] = {firstBegin, firstEnd, secondBegin, secondEnd};
+    int spanBegin = pixelBegin;
+    while (spanBegin < pixelEnd) {
+      int spanEnd = pixelEnd;
+      for (int bound : bounds) {
+        if ((bound > spanBegin) && (bound < spanEnd)) {
+          spanEnd = bound;
+        }
+      }
+      visit(spanBegin,
+            spanEnd - spanBegin,
+            (spanBegin >= firstBegin) && (spanBegin < firstEnd),
+            (spanBegin >= secondBegin) && (spanBegin < secondEnd));
+      spanBegin = spanEnd;
+    }
+  }
+
+  /// \brief Finds the pixels a blend of two images must hold.
+  ///
+  /// Sets [pixelBegin, pixelEnd) (as global indices) to the smallest range
+  /// containing the pixels held by either image. If neither holds any, the
+  /// range is empty and starts at regionBegin.
+  static void heldPixelsOfBlend(const ImageFull& topImage,
+                                const ImageFull& bottomImage,
+                                int regionBegin,
+                                int& pixelBegin,
+                                int& pixelEnd) {
+    pixelBegin = regionBegin;
+    pixelEnd = regionBegin;
+    for (const ImageFull* image : {&topImage, &bottomImage}) {
+      int heldBegin = image->getRegionBegin() + image->getHeldPixelBegin();
+      int heldEnd = image->getRegionBegin() + image->getHeldPixelEnd();
+      if (heldBegin >= heldEnd) {
+        continue;
+      } else if (pixelBegin >= pixelEnd) {
+        pixelBegin = heldBegin;
+        pixelEnd = heldEnd;
+      } else {
+        pixelBegin = std::min(pixelBegin, heldBegin);
+        pixelEnd = std::max(pixelEnd, heldEnd);
+      }
+    }
+  }
+
+ private:
+  static constexpr int BUFFER_OFFSET_TAG = 59464;
+  static constexpr int BUFFER_SIZE_TAG = 59465;
+
+  // Sent by ISendBufferMetaData. It must stay put until the send finishes.
+  mutable int sentLayout[2];
 };
 
 #endif  // IMAGEFULL_HPP
@@ -8,6 +8,7 @@
 
 #include "ImageRGBAFloatColorOnly.hpp"
 
+#include "BlendKernels.hpp"
 #include "ImageSparseColorOnly.hpp"
 
 #include <assert.h>
@@ -28,6 +29,13 @@ Color ImageRGBAFloatColorOnlyFeatures::decodeColor(
                colorComponents[3]);
 }
 
+void ImageRGBAFloatColorOnlyFeatures::blendPixels(const ColorType* topColor,
+                                                  const ColorType* bottomColor,
+                                                  ColorType* outColor,
+                                                  int numPixels) {
+  overBlendRGBAFloat(topColor, bottomColor, outColor, numPixels);
+}
+
 ImageRGBAFloatColorOnly::ImageRGBAFloatColorOnly(int _width, int _height)
     : ImageColorOnly(_width, _height) {}
 
@@ -24,6 +24,11 @@ struct ImageRGBAFloatColorOnlyFeatures {
     }
   }
 
+  static void blendPixels(const ColorType* topColor,
+                          const ColorType* bottomColor,
+                          ColorType* outColor,
+                          int numPixels);
+
   static void encodeColor(const Color& color,
                           ColorType colorComponents[ColorVecSize]);
   static Color decodeColor(const ColorType colorComponents[ColorVecSize]);
@@ -0,0 +1,54 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include "ImageRGBAFloatPlanarColorOnly.hpp"
+
+#include "BlendKernels.hpp"
+#include "ImageSparseColorOnly.hpp"
+
+#include <assert.h>
+
+void ImageRGBAFloatPlanarColorOnlyFeatures::blendPixels(
+    const ColorType* const topColor[ColorVecSize],
+    const ColorType* const bottomColor[ColorVecSize],
+    ColorType* const outColor[ColorVecSize],
+    int numPixels) {
+  overBlendRGBAFloatPlanar(topColor, bottomColor, outColor, numPixels);
+}
+
+ImageRGBAFloatPlanarColorOnly::ImageRGBAFloatPlanarColorOnly(int _width,
+                                                             int _height)
+    : ImageColorOnlyPlanar(_width, _height) {}
+
+ImageRGBAFloatPlanarColorOnly::ImageRGBAFloatPlanarColorOnly(int _width,
+                                                             int _height,
+                                                             int _regionBegin,
+                                                             int _regionEnd)
+    : ImageColorOnlyPlanar(_width, _height, _regionBegin, _regionEnd) {}
+
+std::unique_ptr<ImageSparse> ImageRGBAFloatPlanarColorOnly::compress() const {
+  // The active pixels of the compressed image are stored interleaved.
+  std::unique_ptr<ImageColorOnly<ImageRGBAFloatColorOnlyFeatures>>
+      pixelStorage(new ImageRGBAFloatColorOnly(
+          this->getWidth(), this->getHeight(), 0, 0));
+  return std::unique_ptr<ImageSparse>(
+      new ImageSparseColorOnly<ImageRGBAFloatColorOnlyFeatures>(
+          *this, std::move(pixelStorage)));
+}
+
+std::unique_ptr<Image> ImageRGBAFloatPlanarColorOnly::createNewImpl(
+    int _width, int _height, int _regionBegin, int _regionEnd) const {
+  return std::unique_ptr<Image>(new ImageRGBAFloatPlanarColorOnly(
+      _width, _height, _regionBegin, _regionEnd));
+}
+
+std::unique_ptr<const Image> ImageRGBAFloatPlanarColorOnly::shallowCopyImpl()
+    const {
+  return std::unique_ptr<const Image>(
+      new ImageRGBAFloatPlanarColorOnly(*this));
+}
@@ -0,0 +1,46 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef IMAGERGBAFLOATPLANARCOLORONLY_HPP
+#define IMAGERGBAFLOATPLANARCOLORONLY_HPP
+
+#include "ImageColorOnlyPlanar.hpp"
+#include "ImageRGBAFloatColorOnly.hpp"
+
+struct ImageRGBAFloatPlanarColorOnlyFeatures
+    : public ImageRGBAFloatColorOnlyFeatures {
+  using InterleavedFeatures = ImageRGBAFloatColorOnlyFeatures;
+
+  static void blendPixels(const ColorType* const topColor[ColorVecSize],
+                          const ColorType* const bottomColor[ColorVecSize],
+                          ColorType* const outColor[ColorVecSize],
+                          int numPixels);
+};
+
+class ImageRGBAFloatPlanarColorOnly
+    : public ImageColorOnlyPlanar<ImageRGBAFloatPlanarColorOnlyFeatures> {
+ public:
+  ImageRGBAFloatPlanarColorOnly(int _width, int _height);
+  ImageRGBAFloatPlanarColorOnly(int _width,
+                                int _height,
+                                int _regionBegin,
+                                int _regionEnd);
+  ~ImageRGBAFloatPlanarColorOnly() = default;
+
+  std::unique_ptr<ImageSparse> compress() const final;
+
+ protected:
+  std::unique_ptr<Image> createNewImpl(int _width,
+                                       int _height,
+                                       int _regionBegin,
+                                       int _regionEnd) const final;
+
+  std::unique_ptr<const Image> shallowCopyImpl() const final;
+};
+
+#endif  // IMAGERGBAFLOATPLANARCOLORONLY_HPP
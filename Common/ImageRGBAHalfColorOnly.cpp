@@ -0,0 +1,57 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include "ImageRGBAHalfColorOnly.hpp"
+
+#include "BlendKernels.hpp"
+#include "ImageSparseColorOnly.hpp"
+
+#include <assert.h>
+
+void ImageRGBAHalfColorOnlyFeatures::encodeColor(
+    const Color& color, ColorType colorComponents[ColorVecSize]) {
+  floatToHalf(color.Components, colorComponents, 4);
+}
+
+Color ImageRGBAHalfColorOnlyFeatures::decodeColor(
+    const ColorType colorComponents[ColorVecSize]) {
+  float components[4];
+  halfToFloat(colorComponents, components, 4);
+  return Color(components);
+}
+
+void ImageRGBAHalfColorOnlyFeatures::blendPixels(const ColorType* topColor,
+                                                 const ColorType* bottomColor,
+                                                 ColorType* outColor,
+                                                 int numPixels) {
+  overBlendRGBAHalf(topColor, bottomColor, outColor, numPixels);
+}
+
+ImageRGBAHalfColorOnly::ImageRGBAHalfColorOnly(int _width, int _height)
+    : ImageColorOnly(_width, _height) {}
+
+ImageRGBAHalfColorOnly::ImageRGBAHalfColorOnly(int _width,
+                                               int _height,
+                                               int _regionBegin,
+                                               int _regionEnd)
+    : ImageColorOnly(_width, _height, _regionBegin, _regionEnd) {}
+
+std::unique_ptr<ImageSparse> ImageRGBAHalfColorOnly::compress() const {
+  return std::unique_ptr<ImageSparse>(
+      new ImageSparseColorOnly<ImageRGBAHalfColorOnlyFeatures>(*this));
+}
+
+std::unique_ptr<Image> ImageRGBAHalfColorOnly::createNewImpl(
+    int _width, int _height, int _regionBegin, int _regionEnd) const {
+  return std::unique_ptr<Image>(
+      new ImageRGBAHalfColorOnly(_width, _height, _regionBegin, _regionEnd));
+}
+
+std::unique_ptr<const Image> ImageRGBAHalfColorOnly::shallowCopyImpl() const {
+  return std::unique_ptr<const Image>(new ImageRGBAHalfColorOnly(*this));
+}
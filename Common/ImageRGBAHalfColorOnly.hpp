@@ -0,0 +1,64 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef IMAGERGBAHALFCOLORONLY_HPP
+#define IMAGERGBAHALFCOLORONLY_HPP
+
+#include "Half.hpp"
+#include "ImageColorOnly.hpp"
+
+struct ImageRGBAHalfColorOnlyFeatures {
+  using ColorType = Half;
+  static constexpr int ColorVecSize = 4;
+
+  static void blend(const ColorType topColor[ColorVecSize],
+                    const ColorType bottomColor[ColorVecSize],
+                    ColorType outColor[ColorVecSize]) {
+    float top[4];
+    float bottom[4];
+    halfToFloat(topColor, top, 4);
+    halfToFloat(bottomColor, bottom, 4);
+    float out[4];
+    for (int component = 0; component < 4; ++component) {
+      out[component] = top[component] + bottom[component] * (1.0f - top[3]);
+    }
+    floatToHalf(out, outColor, 4);
+  }
+
+  static void blendPixels(const ColorType* topColor,
+                          const ColorType* bottomColor,
+                          ColorType* outColor,
+                          int numPixels);
+
+  static void encodeColor(const Color& color,
+                          ColorType colorComponents[ColorVecSize]);
+  static Color decodeColor(const ColorType colorComponents[ColorVecSize]);
+};
+
+class ImageRGBAHalfColorOnly
+    : public ImageColorOnly<ImageRGBAHalfColorOnlyFeatures> {
+ public:
+  ImageRGBAHalfColorOnly(int _width, int _height);
+  ImageRGBAHalfColorOnly(int _width,
+                         int _height,
+                         int _regionBegin,
+                         int _regionEnd);
+  ~ImageRGBAHalfColorOnly() = default;
+
+  std::unique_ptr<ImageSparse> compress() const final;
+
+ protected:
+  std::unique_ptr<Image> createNewImpl(int _width,
+                                       int _height,
+                                       int _regionBegin,
+                                       int _regionEnd) const final;
+
+  std::unique_ptr<const Image> shallowCopyImpl() const final;
+};
+
+#endif  // IMAGERGBAHALFCOLORONLY_HPP
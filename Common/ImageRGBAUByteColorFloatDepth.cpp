@@ -8,6 +8,7 @@
 
 #include "ImageRGBAUByteColorFloatDepth.hpp"
 
+#include "BlendKernels.hpp"
 #include "ImageSparseColorDepth.hpp"
 
 #include <assert.h>
@@ -47,6 +48,23 @@ float ImageRGBAUByteColorFloatDepthFeatures::decodeDepth(
   return depthComponents[0];
 }
 
+void ImageRGBAUByteColorFloatDepthFeatures::blendPixels(
+    const ColorType *topColor,
+    const DepthType *topDepth,
+    const ColorType *bottomColor,
+    const DepthType *bottomDepth,
+    ColorType *outColor,
+    DepthType *outDepth,
+    int numPixels) {
+  depthBlendRGBAUByte(topColor,
+                      topDepth,
+                      bottomColor,
+                      bottomDepth,
+                      outColor,
+                      outDepth,
+                      numPixels);
+}
+
 
 ImageRGBAUByteColorFloatDepth::ImageRGBAUByteColorFloatDepth(int _width,
                                                              int _height)
@@ -26,6 +26,14 @@ struct ImageRGBAUByteColorFloatDepthFeatures {
 
   static void encodeDepth(float depth, DepthType depthComponents[1]);
   static float decodeDepth(const DepthType depthComponents[1]);
+
+  static void blendPixels(const ColorType* topColor,
+                          const DepthType* topDepth,
+                          const ColorType* bottomColor,
+                          const DepthType* bottomDepth,
+                          ColorType* outColor,
+                          DepthType* outDepth,
+                          int numPixels);
 };
 
 class ImageRGBAUByteColorFloatDepth
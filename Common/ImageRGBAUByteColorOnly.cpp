@@ -8,6 +8,7 @@
 
 #include "ImageRGBAUByteColorOnly.hpp"
 
+#include "BlendKernels.hpp"
 #include "ImageSparseColorOnly.hpp"
 
 #include <assert.h>
@@ -37,6 +38,13 @@ Color ImageRGBAUByteColorOnlyFeatures::decodeColor(
   return color;
 }
 
+void ImageRGBAUByteColorOnlyFeatures::blendPixels(const ColorType *topColor,
+                                                  const ColorType *bottomColor,
+                                                  ColorType *outColor,
+                                                  int numPixels) {
+  overBlendRGBAUByte(topColor, bottomColor, outColor, numPixels);
+}
+
 ImageRGBAUByteColorOnly::ImageRGBAUByteColorOnly(int _width, int _height)
     : ImageColorOnly(_width, _height) {}
 
@@ -24,14 +24,23 @@ struct ImageRGBAUByteColorOnlyFeatures {
         reinterpret_cast<const unsigned char *>(bottomColorEncoded);
     unsigned char *outColor =
         reinterpret_cast<unsigned char *>(outColorEncoded);
-    float bottomScale = 1.0f - topColor[3] / 255.0f;
+    // Fixed-point version of bottom * (1 - topAlpha). The scaled bottom value
+    // is divided by 255 with rounding (exact for values up to 255 * 255).
+    unsigned int bottomScale = 255 - topColor[3];
     for (int component = 0; component < 4; ++component) {
+      unsigned int scaled = bottomColor[component] * bottomScale + 128;
+      scaled = (scaled + (scaled >> 8)) >> 8;
+      unsigned int value = topColor[component] + scaled;
       outColor[component] =
-          topColor[component] +
-          static_cast<unsigned char>(bottomColor[component] * bottomScale);
+          static_cast<unsigned char>((value < 255) ? value : 255);
     }
   }
 
+  static void blendPixels(const ColorType *topColor,
+                          const ColorType *bottomColor,
+                          ColorType *outColor,
+                          int numPixels);
+
   static void encodeColor(const Color &color,
                           ColorType colorComponents[ColorVecSize]);
   static Color decodeColor(const ColorType colorComponents[ColorVecSize]);
@@ -8,6 +8,7 @@
 
 #include "ImageRGBFloatColorDepth.hpp"
 
+#include "BlendKernels.hpp"
 #include "ImageSparseColorDepth.hpp"
 
 #include <assert.h>
@@ -34,6 +35,22 @@ float ImageRGBFloatColorDepthFeatures::decodeDepth(
   return depthComponents[0];
 }
 
+void ImageRGBFloatColorDepthFeatures::blendPixels(const ColorType* topColor,
+                                                  const DepthType* topDepth,
+                                                  const ColorType* bottomColor,
+                                                  const DepthType* bottomDepth,
+                                                  ColorType* outColor,
+                                                  DepthType* outDepth,
+                                                  int numPixels) {
+  depthBlendRGBFloat(topColor,
+                     topDepth,
+                     bottomColor,
+                     bottomDepth,
+                     outColor,
+                     outDepth,
+                     numPixels);
+}
+
 ImageRGBFloatColorDepth::ImageRGBFloatColorDepth(int _width, int _height)
     : ImageColorDepth(_width, _height) {}
 
@@ -0,0 +1,64 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include "ImageRGBFloatPlanarColorDepth.hpp"
+
+#include "BlendKernels.hpp"
+#include "ImageSparseColorDepth.hpp"
+
+#include <assert.h>
+
+void ImageRGBFloatPlanarColorDepthFeatures::blendPixels(
+    const ColorType* const topColor[ColorVecSize],
+    const DepthType* topDepth,
+    const ColorType* const bottomColor[ColorVecSize],
+    const DepthType* bottomDepth,
+    ColorType* const outColor[ColorVecSize],
+    DepthType* outDepth,
+    int numPixels) {
+  depthBlendFloatPlanar(topColor,
+                        topDepth,
+                        bottomColor,
+                        bottomDepth,
+                        outColor,
+                        outDepth,
+                        ColorVecSize,
+                        numPixels);
+}
+
+ImageRGBFloatPlanarColorDepth::ImageRGBFloatPlanarColorDepth(int _width,
+                                                             int _height)
+    : ImageColorDepthPlanar(_width, _height) {}
+
+ImageRGBFloatPlanarColorDepth::ImageRGBFloatPlanarColorDepth(int _width,
+                                                             int _height,
+                                                             int _regionBegin,
+                                                             int _regionEnd)
+    : ImageColorDepthPlanar(_width, _height, _regionBegin, _regionEnd) {}
+
+std::unique_ptr<ImageSparse> ImageRGBFloatPlanarColorDepth::compress() const {
+  // The active pixels of the compressed image are stored interleaved.
+  std::unique_ptr<ImageColorDepth<ImageRGBFloatColorDepthFeatures>>
+      pixelStorage(new ImageRGBFloatColorDepth(
+          this->getWidth(), this->getHeight(), 0, 0));
+  return std::unique_ptr<ImageSparse>(
+      new ImageSparseColorDepth<ImageRGBFloatColorDepthFeatures>(
+          *this, std::move(pixelStorage)));
+}
+
+std::unique_ptr<Image> ImageRGBFloatPlanarColorDepth::createNewImpl(
+    int _width, int _height, int _regionBegin, int _regionEnd) const {
+  return std::unique_ptr<Image>(new ImageRGBFloatPlanarColorDepth(
+      _width, _height, _regionBegin, _regionEnd));
+}
+
+std::unique_ptr<const Image> ImageRGBFloatPlanarColorDepth::shallowCopyImpl()
+    const {
+  return std::unique_ptr<const Image>(
+      new ImageRGBFloatPlanarColorDepth(*this));
+}
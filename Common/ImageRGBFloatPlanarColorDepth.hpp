@@ -0,0 +1,49 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef IMAGERGBFLOATPLANARCOLORDEPTH_HPP
+#define IMAGERGBFLOATPLANARCOLORDEPTH_HPP
+
+#include "ImageColorDepthPlanar.hpp"
+#include "ImageRGBFloatColorDepth.hpp"
+
+struct ImageRGBFloatPlanarColorDepthFeatures
+    : public ImageRGBFloatColorDepthFeatures {
+  using InterleavedFeatures = ImageRGBFloatColorDepthFeatures;
+
+  static void blendPixels(const ColorType* const topColor[ColorVecSize],
+                          const DepthType* topDepth,
+                          const ColorType* const bottomColor[ColorVecSize],
+                          const DepthType* bottomDepth,
+                          ColorType* const outColor[ColorVecSize],
+                          DepthType* outDepth,
+                          int numPixels);
+};
+
+class ImageRGBFloatPlanarColorDepth
+    : public ImageColorDepthPlanar<ImageRGBFloatPlanarColorDepthFeatures> {
+ public:
+  ImageRGBFloatPlanarColorDepth(int _width, int _height);
+  ImageRGBFloatPlanarColorDepth(int _width,
+                                int _height,
+                                int _regionBegin,
+                                int _regionEnd);
+  ~ImageRGBFloatPlanarColorDepth() = default;
+
+  std::unique_ptr<ImageSparse> compress() const final;
+
+ protected:
+  std::unique_ptr<Image> createNewImpl(int _width,
+                                       int _height,
+                                       int _regionBegin,
+                                       int _regionEnd) const final;
+
+  std::unique_ptr<const Image> shallowCopyImpl() const final;
+};
+
+#endif  // IMAGERGBFLOATPLANARCOLORDEPTH_HPP
@@ -0,0 +1,78 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include "ImageRGBHalfColorHalfDepth.hpp"
+
+#include "BlendKernels.hpp"
+#include "ImageSparseColorDepth.hpp"
+
+#include <assert.h>
+
+void ImageRGBHalfColorHalfDepthFeatures::encodeColor(
+    const Color& color, ColorType colorComponents[ColorVecSize]) {
+  floatToHalf(color.Components, colorComponents, 3);
+}
+
+Color ImageRGBHalfColorHalfDepthFeatures::decodeColor(
+    const ColorType colorComponents[ColorVecSize]) {
+  float components[3];
+  halfToFloat(colorComponents, components, 3);
+  return Color(components[0], components[1], components[2]);
+}
+
+void ImageRGBHalfColorHalfDepthFeatures::encodeDepth(
+    float depth, DepthType depthComponents[1]) {
+  depthComponents[0] = floatToHalf(depth);
+}
+
+float ImageRGBHalfColorHalfDepthFeatures::decodeDepth(
+    const DepthType depthComponents[1]) {
+  return halfToFloat(depthComponents[0]);
+}
+
+void ImageRGBHalfColorHalfDepthFeatures::blendPixels(
+    const ColorType* topColor,
+    const DepthType* topDepth,
+    const ColorType* bottomColor,
+    const DepthType* bottomDepth,
+    ColorType* outColor,
+    DepthType* outDepth,
+    int numPixels) {
+  depthBlendGeneric<ImageRGBHalfColorHalfDepthFeatures>(topColor,
+                                                        topDepth,
+                                                        bottomColor,
+                                                        bottomDepth,
+                                                        outColor,
+                                                        outDepth,
+                                                        numPixels);
+}
+
+ImageRGBHalfColorHalfDepth::ImageRGBHalfColorHalfDepth(int _width, int _height)
+    : ImageColorDepth(_width, _height) {}
+
+ImageRGBHalfColorHalfDepth::ImageRGBHalfColorHalfDepth(int _width,
+                                                       int _height,
+                                                       int _regionBegin,
+                                                       int _regionEnd)
+    : ImageColorDepth(_width, _height, _regionBegin, _regionEnd) {}
+
+std::unique_ptr<ImageSparse> ImageRGBHalfColorHalfDepth::compress() const {
+  return std::unique_ptr<ImageSparse>(
+      new ImageSparseColorDepth<ImageRGBHalfColorHalfDepthFeatures>(*this));
+}
+
+std::unique_ptr<Image> ImageRGBHalfColorHalfDepth::createNewImpl(
+    int _width, int _height, int _regionBegin, int _regionEnd) const {
+  return std::unique_ptr<Image>(new ImageRGBHalfColorHalfDepth(
+      _width, _height, _regionBegin, _regionEnd));
+}
+
+std::unique_ptr<const Image> ImageRGBHalfColorHalfDepth::shallowCopyImpl()
+    const {
+  return std::unique_ptr<const Image>(new ImageRGBHalfColorHalfDepth(*this));
+}
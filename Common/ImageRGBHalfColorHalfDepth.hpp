@@ -0,0 +1,61 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef IMAGERGBHALFCOLORHALFDEPTH_HPP
+#define IMAGERGBHALFCOLORHALFDEPTH_HPP
+
+#include "Half.hpp"
+#include "ImageColorDepth.hpp"
+
+struct ImageRGBHalfColorHalfDepthFeatures {
+  using ColorType = Half;
+  using DepthType = Half;
+  static constexpr int ColorVecSize = 3;
+
+  static bool closer(const DepthType& distance1, const DepthType& distance2) {
+    return halfLess(distance1, distance2);
+  }
+
+  static void encodeColor(const Color& color,
+                          ColorType colorComponents[ColorVecSize]);
+  static Color decodeColor(const ColorType colorComponents[ColorVecSize]);
+
+  static void encodeDepth(float depth, DepthType depthComponents[1]);
+  static float decodeDepth(const DepthType depthComponents[1]);
+
+  static void blendPixels(const ColorType* topColor,
+                          const DepthType* topDepth,
+                          const ColorType* bottomColor,
+                          const DepthType* bottomDepth,
+                          ColorType* outColor,
+                          DepthType* outDepth,
+                          int numPixels);
+};
+
+class ImageRGBHalfColorHalfDepth
+    : public ImageColorDepth<ImageRGBHalfColorHalfDepthFeatures> {
+ public:
+  ImageRGBHalfColorHalfDepth(int _width, int _height);
+  ImageRGBHalfColorHalfDepth(int _width,
+                             int _height,
+                             int _regionBegin,
+                             int _regionEnd);
+  ~ImageRGBHalfColorHalfDepth() = default;
+
+  std::unique_ptr<ImageSparse> compress() const final;
+
+ protected:
+  std::unique_ptr<Image> createNewImpl(int _width,
+                                       int _height,
+                                       int _regionBegin,
+                                       int _regionEnd) const final;
+
+  std::unique_ptr<const Image> shallowCopyImpl() const final;
+};
+
+#endif  // IMAGERGBHALFCOLORHALFDEPTH_HPP
@@ -70,6 +70,23 @@ void ImageSparse::RunLengthIterator::copyPixels(
   }
 }
 
+void ImageSparse::appendRunLengths(const std::vector<RunLengthRegion>& source,
+                                   std::vector<RunLengthRegion>& target) {
+  auto nextRegion = source.begin();
+  if ((nextRegion != source.end()) && !target.empty()) {
+    RunLengthRegion& lastRegion = target.back();
+    if (lastRegion.foregroundPixels == 0) {
+      lastRegion.backgroundPixels += nextRegion->backgroundPixels;
+      lastRegion.foregroundPixels = nextRegion->foregroundPixels;
+      ++nextRegion;
+    } else if (nextRegion->backgroundPixels == 0) {
+      lastRegion.foregroundPixels += nextRegion->foregroundPixels;
+      ++nextRegion;
+    }
+  }
+  target.insert(target.end(), nextRegion, source.end());
+}
+
 void ImageSparse::copyRunlengthRegion(
     int subregionBegin,
     int subregionEnd,
@@ -9,8 +9,11 @@
 #ifndef IMAGESPARSE_HPP
 #define IMAGESPARSE_HPP
 
+#include "BufferPool.hpp"
 #include "Image.hpp"
 
+#include <algorithm>
+
 class ImageFull;
 
 class ImageSparse : public Image {
@@ -96,7 +99,7 @@ class ImageSparse : public Image {
               int _regionEnd,
               const Viewport& _validViewport)
       : Image(_width, _height, _regionBegin, _regionEnd, _validViewport),
-        runLengths(new std::vector<RunLengthRegion>) {}
+        runLengths(acquirePooledBuffer<RunLengthRegion>(0)) {}
 
   ImageSparse(int _width,
               int _height,
@@ -142,6 +145,113 @@ class ImageSparse : public Image {
     this->runLengths->resize(runLengthSize);
   }
 
+  // Appends the run lengths in source to those in target, joining the runs
+  // where they meet.
+  static void appendRunLengths(const std::vector<RunLengthRegion>& source,
+                               std::vector<RunLengthRegion>& target);
+
+  // Finds the run lengths of the rows of tiles at positions [positionBegin,
+  // positionEnd) in pixel order and appends them to runLengths. The image is
+  // walked tile by tile. Pixels outside the valid viewport or the held pixels
+  // [heldPixelBegin, heldPixelEnd) are background without being checked;
+  // isBackgroundPixel(pixelIndex) checks the rest. Returns the number of
+  // active pixels found.
+  template <typename IsBackgroundPixel>
+  static int findRunLengthsImpl(const Image& toCompress,
+                                int heldPixelBegin,
+                                int heldPixelEnd,
+                                int positionBegin,
+                                int positionEnd,
+                                std::vector<RunLengthRegion>& runLengths,
+                                const IsBackgroundPixel& isBackgroundPixel) {
+    int numActivePixels = 0;
+    RunLengthRegion workingRunLength;
+    const Viewport& validViewport = toCompress.getValidViewport();
+    int width = toCompress.getWidth();
+    int height = toCompress.getHeight();
+    int iPixel = toCompress.tileRowPixelIndex(positionBegin);
+
+    auto skipPixels = [&](int numPixels) {
+      if (numPixels < 1) {
+        return;
+      }
+      if (workingRunLength.foregroundPixels > 0) {
+        runLengths.push_back(workingRunLength);
+        workingRunLength = RunLengthRegion();
+      }
+      workingRunLength.backgroundPixels += numPixels;
+      iPixel += numPixels;
+    };
+
+    auto scanPixels = [&](int numPixels) {
+      int scanEnd = iPixel + numPixels;
+      int heldBegin = std::min(std::max(iPixel, heldPixelBegin), scanEnd);
+      int heldEnd = std::max(std::min(scanEnd, heldPixelEnd), heldBegin);
+      skipPixels(heldBegin - iPixel);
+      while (iPixel < heldEnd) {
+        if (workingRunLength.foregroundPixels == 0) {
+          while ((iPixel < heldEnd) && isBackgroundPixel(iPixel)) {
+            ++workingRunLength.backgroundPixels;
+            ++iPixel;
+          }
+        }
+        while ((iPixel < heldEnd) && !isBackgroundPixel(iPixel)) {
+          ++workingRunLength.foregroundPixels;
+          ++iPixel;
+          ++numActivePixels;
+        }
+        if (iPixel < heldEnd) {
+          runLengths.push_back(workingRunLength);
+          workingRunLength = RunLengthRegion();
+        }
+      }
+      skipPixels(scanEnd - heldEnd);
+    };
+
+    for (int position = positionBegin; position < positionEnd; ++position) {
+      int tileMinY =
+          toCompress.tileRowAtPosition(position) * toCompress.getTileHeight();
+      int tileHeight = std::min(toCompress.getTileHeight(), height - tileMinY);
+      if ((tileMinY > validViewport.getMaxY()) ||
+          (tileMinY + tileHeight <= validViewport.getMinY())) {
+        skipPixels(width * tileHeight);
+        continue;
+      }
+      for (int tileMinX = 0; tileMinX < width;
+           tileMinX += toCompress.getTileWidth()) {
+        int tileWidth = std::min(toCompress.getTileWidth(), width - tileMinX);
+        if ((tileMinX > validViewport.getMaxX()) ||
+            (tileMinX + tileWidth <= validViewport.getMinX())) {
+          skipPixels(tileWidth * tileHeight);
+          continue;
+        }
+        int xBegin = std::max(validViewport.getMinX(), tileMinX);
+        int xEnd = std::min(validViewport.getMaxX() + 1, tileMinX + tileWidth);
+        for (int y = tileMinY; y < tileMinY + tileHeight; ++y) {
+          if ((y < validViewport.getMinY()) || (y > validViewport.getMaxY())) {
+            skipPixels(tileWidth);
+          } else {
+            skipPixels(xBegin - tileMinX);
+            scanPixels(xEnd - xBegin);
+            skipPixels(tileMinX + tileWidth - xEnd);
+          }
+        }
+      }
+    }
+
+    runLengths.push_back(workingRunLength);
+
+    return numActivePixels;
+  }
+
+  // The rows of tiles of an image that one thread compresses.
+  struct CompressBand {
+    int pixelBegin;
+    std::shared_ptr<std::vector<RunLengthRegion>> runLengths;
+    int numActivePixels;
+    int activePixelBegin;
+  };
+
   void copyRunlengthRegion(int subregionBegin,
                            int subregionEnd,
                            std::vector<RunLengthRegion>& targetRunLengths,
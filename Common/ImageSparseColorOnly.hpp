@@ -12,6 +12,7 @@
 #include "ImageSparse.hpp"
 
 #include "ImageColorOnly.hpp"
+#include "ThreadPool.hpp"
 
 #include <algorithm>
 
@@ -27,6 +28,11 @@ class ImageSparseColorOnly : public ImageSparse {
 
   std::shared_ptr<StorageType> pixelStorage;
 
+  // Arrays kept around from the last in-place blend so that the next one does
+  // not need to allocate them.
+  std::shared_ptr<StorageType> spareStorage;
+  std::shared_ptr<std::vector<RunLengthRegion>> spareRunLengths;
+
   static constexpr int BACKGROUND_TAG = 89016;
   static constexpr int RUN_LENGTHS_TAG = 89017;
 
@@ -81,6 +87,24 @@ class ImageSparseColorOnly : public ImageSparse {
     this->compress(toCompress);
   }
 
+  /// \brief Compresses an image whose layout differs from StorageType.
+  ///
+  /// This is used for images such as planar ones that hold the same pixels
+  /// in a different arrangement. The active pixels are copied into the
+  /// given empty storage image, so they are kept interleaved.
+  template <typename FullImageType>
+  ImageSparseColorOnly(const FullImageType& toCompress,
+                       std::unique_ptr<StorageType> emptyStorage)
+      : ImageSparse(toCompress.getWidth(),
+                    toCompress.getHeight(),
+                    toCompress.getRegionBegin(),
+                    toCompress.getRegionEnd(),
+                    toCompress.getValidViewport()),
+        pixelStorage(emptyStorage.release()) {
+    this->setBackground(Color(0, 0, 0, 0));
+    this->compress(toCompress);
+  }
+
  private:
   bool isBackground(const ColorType colorComponents[ColorVecSize]) const {
     // Might want a more sophisticated way to check for background if we run
@@ -93,13 +117,76 @@ class ImageSparseColorOnly : public ImageSparse {
     return true;
   }
 
-  void compress(const StorageType& toCompress) {
-    int numActivePixels = 0;
-    int iPixel;
-    this->runLengths->resize(0);
-    RunLengthRegion workingRunLength;
-    const Viewport& validViewport = toCompress.getValidViewport();
+  static void copyColors(const StorageType& source,
+                         int pixelIndex,
+                         int numPixels,
+                         ColorType* dest) {
+    std::copy(source.getColorBuffer(pixelIndex),
+              source.getColorBuffer(pixelIndex + numPixels),
+              dest);
+  }
+
+  template <typename FullImageType>
+  static void copyColors(const FullImageType& source,
+                         int pixelIndex,
+                         int numPixels,
+                         ColorType* dest) {
+    source.getInterleavedColors(pixelIndex, numPixels, dest);
+  }
 
+  bool isBackgroundPixel(const StorageType& image, int pixelIndex) const {
+    return this->isBackground(image.getColorBuffer(pixelIndex));
+  }
+
+  template <typename FullImageType>
+  bool isBackgroundPixel(const FullImageType& image, int pixelIndex) const {
+    ColorType colorComponents[ColorVecSize];
+    image.getInterleavedColors(pixelIndex, 1, colorComponents);
+    return this->isBackground(colorComponents);
+  }
+
+  // Finds the run lengths of the rows of tiles at positions [positionBegin,
+  // positionEnd) in pixel order and appends them to runLengths. Returns the
+  // number of active pixels found.
+  template <typename FullImageType>
+  int findRunLengths(const FullImageType& toCompress,
+                     int positionBegin,
+                     int positionEnd,
+                     std::vector<RunLengthRegion>& runLengths) const {
+    return findRunLengthsImpl(
+        toCompress,
+        toCompress.getHeldPixelBegin(),
+        toCompress.getHeldPixelEnd(),
+        positionBegin,
+        positionEnd,
+        runLengths,
+        [&](int pixelIndex) {
+          return this->isBackgroundPixel(toCompress, pixelIndex);
+        });
+  }
+
+  // Copies the active pixels of the given run lengths, which start at pixel
+  // iPixel of the image, to the pixel storage starting at iActivePixel.
+  template <typename FullImageType>
+  void copyActivePixels(const FullImageType& toCompress,
+                        int iPixel,
+                        const std::vector<RunLengthRegion>& runLengths,
+                        int iActivePixel) {
+    for (auto&& runLength : runLengths) {
+      iPixel += runLength.backgroundPixels;
+      if (runLength.foregroundPixels > 0) {
+        copyColors(toCompress,
+                   iPixel,
+                   runLength.foregroundPixels,
+                   this->pixelStorage->getColorBuffer(iActivePixel));
+        iActivePixel += runLength.foregroundPixels;
+        iPixel += runLength.foregroundPixels;
+      }
+    }
+  }
+
+  template <typename FullImageType>
+  void compress(const FullImageType& toCompress) {
     // There is currently little reason to compress an image with a range
     // narrower than the full image, and the implementation would add
     // complication here. For now, I am disallowing that.
@@ -111,88 +198,68 @@ class ImageSparseColorOnly : public ImageSparse {
       abort();
     }
 
-    // Skip over pixels at the bottom of the image
-    workingRunLength.backgroundPixels =
-        validViewport.getMinY() * toCompress.getWidth();
-    iPixel = workingRunLength.backgroundPixels;
-
-    for (int y = validViewport.getMinY(); y <= validViewport.getMaxY(); ++y) {
-      if (validViewport.getMinX() > 0) {
-        // Skip pixels at left of the image
-        if (workingRunLength.foregroundPixels > 0) {
-          this->runLengths->push_back(workingRunLength);
-          workingRunLength = RunLengthRegion();
-        }
-        int numToSkip = validViewport.getMinX();
-        workingRunLength.backgroundPixels += numToSkip;
-        iPixel += numToSkip;
-      }
-      int x = validViewport.getMinX();
-      while (x <= validViewport.getMaxX()) {
-        if (workingRunLength.foregroundPixels == 0) {
-          while ((x <= validViewport.getMaxX()) &&
-                 this->isBackground(toCompress.getColorBuffer(iPixel))) {
-            ++workingRunLength.backgroundPixels;
-            ++x;
-            ++iPixel;
-          }
-        }
-        while ((x <= validViewport.getMaxX()) &&
-               !this->isBackground(toCompress.getColorBuffer(iPixel))) {
-          ++workingRunLength.foregroundPixels;
-          ++x;
-          ++iPixel;
-          ++numActivePixels;
-        }
-        if (x <= validViewport.getMaxX()) {
-          this->runLengths->push_back(workingRunLength);
-          workingRunLength = RunLengthRegion();
+    // Bands are whole rows of tiles.
+    int numTileRows = toCompress.getNumberOfTileRows();
+    int numBands = std::min(
+        std::min(getNumberOfThreads(), numTileRows),
+        std::max(1, toCompress.getNumberOfPixels() / MIN_PIXELS_PER_THREAD));
+
+    if (numBands < 2) {
+      // Reserve enough for the most run lengths an image can have so that
+      // compressing never reallocates.
+      reservePooledBuffer(this->runLengths,
+                          toCompress.getNumberOfPixels() / 2 + 1);
+      this->runLengths->resize(0);
+      int numActivePixels =
+          this->findRunLengths(toCompress, 0, numTileRows, *this->runLengths);
+      this->pixelStorage->resizeBuffers(0, numActivePixels);
+      this->copyActivePixels(toCompress, 0, *this->runLengths, 0);
+    } else {
+      // Split the image into bands of rows. Each thread finds the run lengths
+      // of one band, and once the location of each band in the active pixel
+      // array is known, copies its pixels. The run lengths of the bands are
+      // then joined together.
+      std::vector<CompressBand> bands(numBands);
+      parallelFor(numBands, 1, [&](int bandBegin, int bandEnd) {
+        for (int bandIndex = bandBegin; bandIndex < bandEnd; ++bandIndex) {
+          CompressBand& band = bands[bandIndex];
+          int positionBegin = (bandIndex * numTileRows) / numBands;
+          int positionEnd = ((bandIndex + 1) * numTileRows) / numBands;
+          band.pixelBegin = toCompress.tileRowPixelIndex(positionBegin);
+          int pixelEnd = toCompress.tileRowPixelIndex(positionEnd);
+          band.runLengths = acquirePooledBuffer<RunLengthRegion>(
+              0, (pixelEnd - band.pixelBegin) / 2 + 1);
+          band.numActivePixels = this->findRunLengths(
+              toCompress, positionBegin, positionEnd, *band.runLengths);
         }
+      });
+
+      int numActivePixels = 0;
+      std::size_t numRunLengths = 0;
+      for (auto&& band : bands) {
+        band.activePixelBegin = numActivePixels;
+        numActivePixels += band.numActivePixels;
+        numRunLengths += band.runLengths->size();
       }
-      if (validViewport.getMaxX() < toCompress.getWidth() - 1) {
-        // Skip pixels at right of the image
-        if (workingRunLength.foregroundPixels > 0) {
-          this->runLengths->push_back(workingRunLength);
-          workingRunLength = RunLengthRegion();
+      this->pixelStorage->resizeBuffers(0, numActivePixels);
+
+      parallelFor(numBands, 1, [&](int bandBegin, int bandEnd) {
+        for (int bandIndex = bandBegin; bandIndex < bandEnd; ++bandIndex) {
+          const CompressBand& band = bands[bandIndex];
+          this->copyActivePixels(toCompress,
+                                 band.pixelBegin,
+                                 *band.runLengths,
+                                 band.activePixelBegin);
         }
-        int numToSkip = toCompress.getWidth() - validViewport.getMaxX() - 1;
-        workingRunLength.backgroundPixels += numToSkip;
-        iPixel += numToSkip;
-      }
-    }
-
-    // Skip over pixels at top of the image
-    if (validViewport.getMaxY() < toCompress.getHeight() - 1) {
-      if (workingRunLength.foregroundPixels > 0) {
-        this->runLengths->push_back(workingRunLength);
-        workingRunLength = RunLengthRegion();
-      }
-      int numToSkip = (toCompress.getHeight() - validViewport.getMaxY() - 1) *
-                      toCompress.getWidth();
-      workingRunLength.backgroundPixels += numToSkip;
-    }
-
-    this->runLengths->push_back(workingRunLength);
+      });
 
-    this->pixelStorage->resizeBuffers(0, numActivePixels);
-
-    iPixel = 0;
-    int iActivePixel = 0;
-    for (auto&& runLength : *this->runLengths) {
-      iPixel += runLength.backgroundPixels;
-      if (runLength.foregroundPixels > 0) {
-        std::copy(
-            toCompress.getColorBuffer(iPixel),
-            toCompress.getColorBuffer(iPixel + runLength.foregroundPixels),
-            this->pixelStorage->getColorBuffer(iActivePixel));
-        iActivePixel += runLength.foregroundPixels;
-        iPixel += runLength.foregroundPixels;
+      reservePooledBuffer(this->runLengths, numRunLengths + 1);
+      this->runLengths->resize(0);
+      for (auto&& band : bands) {
+        appendRunLengths(*band.runLengths, *this->runLengths);
       }
     }
 
-    // Sanity checks
-    assert(iPixel == this->getNumberOfPixels());
-    assert(iActivePixel == this->pixelStorage->getNumberOfPixels());
     this->shrinkArrays();
   }
 
@@ -208,10 +275,94 @@ class ImageSparseColorOnly : public ImageSparse {
   // necessary because lengths were not known a priori.
   void shrinkArrays() const { this->shrinkArraysImpl(*this->pixelStorage); }
 
+  bool sharesStorageWith(const ThisType& otherImage) const {
+    return (this->pixelStorage == otherImage.pixelStorage) ||
+           (this->runLengths == otherImage.runLengths);
+  }
+
+  // Makes sure the spare arrays exist and are not used by any other image.
+  void prepareSpareArrays() {
+    if (!this->spareStorage || (this->spareStorage.use_count() > 1)) {
+      std::unique_ptr<Image> newStorage = this->pixelStorage->createNew(0, 0);
+      this->spareStorage.reset(sameTypeCast<StorageType>(
+          newStorage.get(), this->pixelStorage.get()));
+      assert(this->spareStorage && "Internal error: createNew bad type.");
+      newStorage.release();
+    }
+    if (!this->spareRunLengths || (this->spareRunLengths.use_count() > 1)) {
+      this->spareRunLengths = acquirePooledBuffer<RunLengthRegion>(0);
+    }
+  }
+
+  // Replaces the contents of this image with a copy of the given image. The
+  // memory already held by this image is reused.
+  void copyFrom(const ThisType& sourceImage) {
+    this->resizeRegion(sourceImage.getRegionBegin(),
+                       sourceImage.getRegionEnd());
+    this->setValidViewport(sourceImage.getValidViewport());
+    this->background = sourceImage.background;
+    if (this->runLengths != sourceImage.runLengths) {
+      resizePooledBuffer(this->runLengths, sourceImage.runLengths->size());
+      std::copy(sourceImage.runLengths->begin(),
+                sourceImage.runLengths->end(),
+                this->runLengths->begin());
+    }
+    if (this->pixelStorage != sourceImage.pixelStorage) {
+      int numActivePixels = sourceImage.pixelStorage->getNumberOfPixels();
+      this->pixelStorage->resizeBuffers(0, numActivePixels);
+      std::copy(sourceImage.pixelStorage->getColorBuffer(0),
+                sourceImage.pixelStorage->getColorBuffer(numActivePixels),
+                this->pixelStorage->getColorBuffer(0));
+    }
+  }
+
+  // Writes the pixels [pixelBegin, pixelEnd) of the uncompressed image.
+  void uncompressPixels(StorageType& outImage,
+                        int pixelBegin,
+                        int pixelEnd) const {
+    int inBufferIndex = 0;
+    int outPixelIndex = 0;
+    for (auto&& runLength : *this->runLengths) {
+      if (outPixelIndex >= pixelEnd) {
+        break;
+      }
+
+      int backgroundBegin = std::max(outPixelIndex, pixelBegin);
+      int backgroundEnd =
+          std::min(outPixelIndex + runLength.backgroundPixels, pixelEnd);
+      for (int i = backgroundBegin; i < backgroundEnd; ++i) {
+        std::copy(this->background.color,
+                  this->background.color + ColorVecSize,
+                  outImage.getColorBuffer(i));
+      }
+      outPixelIndex += runLength.backgroundPixels;
+
+      int foregroundBegin = std::max(outPixelIndex, pixelBegin);
+      int foregroundEnd =
+          std::min(outPixelIndex + runLength.foregroundPixels, pixelEnd);
+      if (foregroundBegin < foregroundEnd) {
+        int inBegin = inBufferIndex + (foregroundBegin - outPixelIndex);
+        int inEnd = inBegin + (foregroundEnd - foregroundBegin);
+        std::copy(this->pixelStorage->getColorBuffer(inBegin),
+                  this->pixelStorage->getColorBuffer(inEnd),
+                  outImage.getColorBuffer(foregroundBegin));
+      }
+      inBufferIndex += runLength.foregroundPixels;
+      outPixelIndex += runLength.foregroundPixels;
+    }
+  }
+
  public:
-  std::unique_ptr<Image> blend(const Image& _otherImage) const final {
-    const ThisType* otherImage = dynamic_cast<const ThisType*>(&_otherImage);
+  void resizeBuffers(int newRegionBegin, int newRegionEnd) final {
+    this->resizeRegion(newRegionBegin, newRegionEnd);
+    this->clearKnownBackground();
+  }
+
+  void blendInto(const Image& _otherImage, Image& _outImage) const final {
+    const ThisType* otherImage = sameTypeCast<ThisType>(&_otherImage, this);
     assert((otherImage != NULL) && "Attempting to blend invalid images.");
+    ThisType* outImage = sameTypeCast<ThisType>(&_outImage, this);
+    assert((outImage != NULL) && "Attempting to blend into invalid image.");
 
     const ThisType* topImage = this;
     const ThisType* bottomImage = otherImage;
@@ -222,10 +373,12 @@ class ImageSparseColorOnly : public ImageSparse {
     if ((topImage->getRegionBegin() == bottomImage->getRegionBegin()) &&
         (topImage->getRegionEnd() == bottomImage->getRegionEnd())) {
       if (topImage->pixelStorage->getNumberOfPixels() < 1) {
-        return bottomImage->deepCopy();
+        outImage->copyFrom(*bottomImage);
+        return;
       }
       if (bottomImage->pixelStorage->getNumberOfPixels() < 1) {
-        return topImage->deepCopy();
+        outImage->copyFrom(*topImage);
+        return;
       }
     }
 
@@ -233,6 +386,8 @@ class ImageSparseColorOnly : public ImageSparse {
         std::min(topImage->getRegionBegin(), bottomImage->getRegionBegin());
     int totalRegionEnd =
         std::max(topImage->getRegionEnd(), bottomImage->getRegionEnd());
+    Viewport totalViewport =
+        this->getValidViewport().unionWith(otherImage->getValidViewport());
 
     int maxNumActivePixels =
         std::min(topImage->pixelStorage->getNumberOfPixels() +
@@ -243,17 +398,30 @@ class ImageSparseColorOnly : public ImageSparse {
     const ColorType* bottomColorBuffer =
         bottomImage->pixelStorage->getColorBuffer();
 
-    std::unique_ptr<Image> outImageHolder = this->createNew(
-        this->getWidth(),
-        this->getHeight(),
-        totalRegionBegin,
-        totalRegionEnd,
-        this->getValidViewport().unionWith(otherImage->getValidViewport()));
-    ThisType* outImage = dynamic_cast<ThisType*>(outImageHolder.get());
-    assert((outImage != NULL) && "Internal error: createNew bad type.");
-    outImage->pixelStorage->resizeBuffers(0, maxNumActivePixels);
-    outImage->runLengths->resize(0);
-    ColorType* outColorBuffer = outImage->pixelStorage->getColorBuffer();
+    // If the output is one of the inputs, we cannot write pixels over the
+    // ones we are still reading. In that case write to the spare arrays left
+    // over from the last in-place blend and swap them in at the end.
+    bool outIsInput = outImage->sharesStorageWith(*topImage) ||
+                      outImage->sharesStorageWith(*bottomImage);
+    std::shared_ptr<StorageType> outStorage;
+    std::shared_ptr<std::vector<RunLengthRegion>> outRunLengths;
+    // Each run in the output starts where a run starts in one of the inputs,
+    // so reserving this many run lengths means the output never reallocates.
+    std::size_t maxNumRuns =
+        topImage->runLengths->size() + bottomImage->runLengths->size() + 1;
+    if (outIsInput) {
+      outImage->prepareSpareArrays();
+      reservePooledBuffer(outImage->spareRunLengths, maxNumRuns);
+      outStorage = outImage->spareStorage;
+      outRunLengths = outImage->spareRunLengths;
+    } else {
+      reservePooledBuffer(outImage->runLengths, maxNumRuns);
+      outStorage = outImage->pixelStorage;
+      outRunLengths = outImage->runLengths;
+    }
+    outStorage->resizeBuffers(0, maxNumActivePixels);
+    outRunLengths->resize(0);
+    ColorType* outColorBuffer = outStorage->getColorBuffer();
 
     RunLengthIterator topRunLength = topImage->createRunLengthIterator();
     RunLengthIterator bottomRunLength = bottomImage->createRunLengthIterator();
@@ -264,7 +432,7 @@ class ImageSparseColorOnly : public ImageSparse {
           bottomImage->getRegionBegin() - topImage->getRegionBegin();
       int numActivePixels;
       topRunLength.copyPixels(
-          numToCopy, *outImage->runLengths, numActivePixels);
+          numToCopy, *outRunLengths, numActivePixels);
       std::copy(topColorBuffer,
                 topColorBuffer + numActivePixels * ColorVecSize,
                 outColorBuffer);
@@ -275,26 +443,26 @@ class ImageSparseColorOnly : public ImageSparse {
           topImage->getRegionBegin() - bottomImage->getRegionBegin();
       int numActivePixels;
       bottomRunLength.copyPixels(
-          numToCopy, *outImage->runLengths, numActivePixels);
+          numToCopy, *outRunLengths, numActivePixels);
       std::copy(bottomColorBuffer,
                 bottomColorBuffer + numActivePixels * ColorVecSize,
                 outColorBuffer);
       bottomColorBuffer += numActivePixels * ColorVecSize;
       outColorBuffer += numActivePixels * ColorVecSize;
     } else {
-      outImage->runLengths->push_back(RunLengthRegion());
+      outRunLengths->push_back(RunLengthRegion());
     }
 
     // Blend where the two images intersect
     while (!topRunLength.atEnd() && !bottomRunLength.atEnd()) {
       if (topRunLength.inBackground() && bottomRunLength.inBackground()) {
         // Case 1: Both images are in background. Just add to inactive count.
-        if (outImage->runLengths->back().foregroundPixels != 0) {
-          outImage->runLengths->push_back(RunLengthRegion());
+        if (outRunLengths->back().foregroundPixels != 0) {
+          outRunLengths->push_back(RunLengthRegion());
         }
         int numInactive = std::min(topRunLength.getWorkingBackground(),
                                    bottomRunLength.getWorkingBackground());
-        outImage->runLengths->back().backgroundPixels += numInactive;
+        outRunLengths->back().backgroundPixels += numInactive;
         topRunLength.advance(numInactive);
         bottomRunLength.advance(numInactive);
       } else if (topRunLength.inBackground()) {
@@ -310,7 +478,7 @@ class ImageSparseColorOnly : public ImageSparse {
 
         topRunLength.advance(numPixels);
         bottomRunLength.advance(numPixels);
-        outImage->runLengths->back().foregroundPixels += numPixels;
+        outRunLengths->back().foregroundPixels += numPixels;
       } else if (bottomRunLength.inBackground()) {
         // Case 3: Bottom image in background, top image in foreground.
         int numPixels = std::min(bottomRunLength.getWorkingBackground(),
@@ -324,17 +492,14 @@ class ImageSparseColorOnly : public ImageSparse {
 
         bottomRunLength.advance(numPixels);
         topRunLength.advance(numPixels);
-        outImage->runLengths->back().foregroundPixels += numPixels;
+        outRunLengths->back().foregroundPixels += numPixels;
       } else {
         // Case 4: Both images are in foreground, blend them.
         int numPixels = std::min(topRunLength.getWorkingForeground(),
                                  bottomRunLength.getWorkingForeground());
 
-        for (int pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
-          Features::blend(topColorBuffer + (pixelIndex * ColorVecSize),
-                          bottomColorBuffer + (pixelIndex * ColorVecSize),
-                          outColorBuffer + (pixelIndex * ColorVecSize));
-        }
+        Features::blendPixels(
+            topColorBuffer, bottomColorBuffer, outColorBuffer, numPixels);
 
         topColorBuffer += numPixels * ColorVecSize;
         bottomColorBuffer += numPixels * ColorVecSize;
@@ -342,7 +507,7 @@ class ImageSparseColorOnly : public ImageSparse {
 
         topRunLength.advance(numPixels);
         bottomRunLength.advance(numPixels);
-        outImage->runLengths->back().foregroundPixels += numPixels;
+        outRunLengths->back().foregroundPixels += numPixels;
       }
     }
 
@@ -352,7 +517,7 @@ class ImageSparseColorOnly : public ImageSparse {
       int numActivePixels;
       topRunLength.copyPixels(
           topImage->getRegionEnd() - bottomImage->getRegionEnd(),
-          *outImage->runLengths,
+          *outRunLengths,
           numActivePixels);
       std::copy(topColorBuffer,
                 topColorBuffer + (numActivePixels * ColorVecSize),
@@ -365,7 +530,7 @@ class ImageSparseColorOnly : public ImageSparse {
       int numActivePixels;
       bottomRunLength.copyPixels(
           bottomImage->getRegionEnd() - topImage->getRegionEnd(),
-          *outImage->runLengths,
+          *outRunLengths,
           numActivePixels);
       std::copy(bottomColorBuffer,
                 bottomColorBuffer + (numActivePixels * ColorVecSize),
@@ -374,9 +539,14 @@ class ImageSparseColorOnly : public ImageSparse {
       assert(bottomRunLength.atEnd());
     }
 
+    if (outIsInput) {
+      outImage->spareStorage.swap(outImage->pixelStorage);
+      outImage->spareRunLengths.swap(outImage->runLengths);
+    }
+    outImage->resizeRegion(totalRegionBegin, totalRegionEnd);
+    outImage->setValidViewport(totalViewport);
+    outImage->background = this->background;
     outImage->shrinkArrays();
-
-    return outImageHolder;
   }
 
   bool blendIsOrderDependent() const final { return true; }
@@ -389,6 +559,7 @@ class ImageSparseColorOnly : public ImageSparse {
     ThisType* subImage = dynamic_cast<ThisType*>(outImageHolder.get());
     assert((subImage != NULL) && "Internal error: createNew bad type.");
 
+    reservePooledBuffer(subImage->runLengths, this->runLengths->size() + 1);
     subImage->runLengths->resize(0);
     int activeSubregionBegin;
     int activeSubregionEnd;
@@ -418,6 +589,7 @@ class ImageSparseColorOnly : public ImageSparse {
     ThisType* subImage = dynamic_cast<ThisType*>(outImageHolder.get());
     assert((subImage != NULL) && "Internal error: createNew bad type.");
 
+    reservePooledBuffer(subImage->runLengths, this->runLengths->size() + 1);
     subImage->runLengths->resize(0);
     int activeSubregionBegin;
     int activeSubregionEnd;
@@ -450,28 +622,11 @@ class ImageSparseColorOnly : public ImageSparse {
         dynamic_cast<StorageType*>(outImageTmp.release()));
     assert(outImage && "Internal error: Storage type not as expected.");
 
-    int inBufferIndex = 0;
-    int outPixelIndex = 0;
-    for (auto&& runLength : *this->runLengths) {
-      for (int i = 0; i < runLength.backgroundPixels; ++i) {
-        std::copy(this->background.color,
-                  this->background.color + ColorVecSize,
-                  outImage->getColorBuffer(outPixelIndex + i));
-      }
-      outPixelIndex += runLength.backgroundPixels;
-
-      if (runLength.foregroundPixels > 0) {
-        std::copy(this->pixelStorage->getColorBuffer(inBufferIndex),
-                  this->pixelStorage->getColorBuffer(
-                      inBufferIndex + runLength.foregroundPixels),
-                  outImage->getColorBuffer(outPixelIndex));
-        inBufferIndex += runLength.foregroundPixels;
-        outPixelIndex += runLength.foregroundPixels;
-      }
-    }
-
-    assert(inBufferIndex == this->pixelStorage->getNumberOfPixels());
-    assert(outPixelIndex == outImage->getNumberOfPixels());
+    parallelFor(outImage->getNumberOfPixels(),
+                MIN_PIXELS_PER_THREAD,
+                [&](int pixelBegin, int pixelEnd) {
+                  this->uncompressPixels(*outImage, pixelBegin, pixelEnd);
+                });
 
     return std::unique_ptr<ImageFull>(outImage.release());
   }
@@ -530,7 +685,7 @@ class ImageSparseColorOnly : public ImageSparse {
     requests.push_back(backgroundRequest);
 
     // Make sure run length buffer large enough for maximum size image.
-    this->runLengths->resize(this->getNumberOfPixels() / 2 + 1);
+    resizePooledBuffer(this->runLengths, this->getNumberOfPixels() / 2 + 1);
     // Also make sure runLengths array is zeroed out so we don't count garbage
     // as pixels.
     std::fill(
@@ -572,8 +727,8 @@ class ImageSparseColorOnly : public ImageSparse {
         dynamic_cast<StorageType*>(pixelStorageCopy.release());
     assert(pixelStorageCopyCast != nullptr);
     std::shared_ptr<StorageType> pixelStorageCopyShared(pixelStorageCopyCast);
-    std::shared_ptr<std::vector<RunLengthRegion>> newRunLengths(
-        new std::vector<RunLengthRegion>);
+    std::shared_ptr<std::vector<RunLengthRegion>> newRunLengths =
+        acquirePooledBuffer<RunLengthRegion>(0);
     ThisType* newImage = new ThisType(_width,
                                       _height,
                                       _regionBegin,
@@ -587,7 +742,11 @@ class ImageSparseColorOnly : public ImageSparse {
   }
 
   std::unique_ptr<const Image> shallowCopyImpl() const final {
-    return std::unique_ptr<const Image>(new ThisType(*this));
+    ThisType* newImage = new ThisType(*this);
+    // The spare arrays are scratch space for this object only.
+    newImage->spareStorage.reset();
+    newImage->spareRunLengths.reset();
+    return std::unique_ptr<const Image>(newImage);
   }
 };
 
@@ -10,15 +10,24 @@
 
 #include "miniGraphicsConfig.h"
 
+#include <Common/AlignedAllocator.hpp>
+#include <Common/BufferPool.hpp>
+#include <Common/ImageDispatch.hpp>
 #include <Common/ImageRGBAFloatColorOnly.hpp>
+#include <Common/ImageRGBAFloatPlanarColorOnly.hpp>
+#include <Common/ImageRGBAHalfColorOnly.hpp>
 #include <Common/ImageRGBAUByteColorFloatDepth.hpp>
 #include <Common/ImageRGBAUByteColorOnly.hpp>
 #include <Common/ImageRGBFloatColorDepth.hpp>
+#include <Common/ImageRGBFloatPlanarColorDepth.hpp>
+#include <Common/ImageRGBHalfColorHalfDepth.hpp>
 #include <Common/ImageSparse.hpp>
 #include <Common/MakeBox.hpp>
 #include <Common/MeshHelper.hpp>
 #include <Common/ReadSTL.hpp>
 #include <Common/SavePPM.hpp>
+#include <Common/SimdDispatch.hpp>
+#include <Common/ThreadPool.hpp>
 #include <Common/Timer.hpp>
 #include <Common/YamlWriter.hpp>
 
@@ -69,6 +78,10 @@ enum optionIndex {
   COLOR_FORMAT,
   DEPTH_FORMAT,
   IMAGE_COMPRESS,
+  BUFFER_POOL,
+  HUGE_PAGES,
+  NUM_THREADS,
+  TILE_SIZE,
   CAMERA_THETA,
   CAMERA_PHI,
   CAMERA_ZOOM,
@@ -82,8 +95,8 @@ enum enableIndex { DISABLE, ENABLE };
 enum paintType { SIMPLE_RASTER, OPENGL };
 enum geometryType { BOX, STL_FILE };
 enum distributionType { DUPLICATE, DIVIDE };
-enum colorType { COLOR_UBYTE, COLOR_FLOAT };
-enum depthType { DEPTH_FLOAT, DEPTH_NONE };
+enum colorType { COLOR_UBYTE, COLOR_FLOAT, COLOR_HALF, COLOR_FLOAT_PLANAR };
+enum depthType { DEPTH_FLOAT, DEPTH_NONE, DEPTH_HALF };
 enum cameraMoveType { CAMERA_STILL, CAMERA_ANIMATE, CAMERA_RANDOM };
 
 struct RunOptions {
@@ -101,6 +114,10 @@ struct RunOptions {
   colorType colorFormat;
   depthType depthFormat;
   bool compressImages;
+  bool bufferPool;
+  bool hugePages;
+  int numThreads;
+  int tileSize;
   float thetaRotation;
   float phiRotation;
   float zoom;
@@ -123,6 +140,10 @@ struct RunOptions {
         colorFormat(COLOR_UBYTE),
         depthFormat(DEPTH_FLOAT),
         compressImages(true),
+        bufferPool(true),
+        hugePages(false),
+        numThreads(1),
+        tileSize(0),
         thetaRotation(25.0f),
         phiRotation(15.0f),
         zoom(1.0f),
@@ -187,6 +208,7 @@ static std::unique_ptr<ImageFull> createImage(const RunOptions& runOptions,
                                               YamlWriter& yaml) {
   yaml.AddDictionaryEntry("image-width", runOptions.imageWidth);
   yaml.AddDictionaryEntry("image-height", runOptions.imageHeight);
+  yaml.AddDictionaryEntry("simd-level", getSimdLevelName(getSimdLevel()));
 
   switch (runOptions.depthFormat) {
     case DEPTH_FLOAT:
@@ -200,6 +222,12 @@ static std::unique_ptr<ImageFull> createImage(const RunOptions& runOptions,
           yaml.AddDictionaryEntry("color-buffer-format", "float");
           return std::unique_ptr<ImageFull>(new ImageRGBFloatColorDepth(
               runOptions.imageWidth, runOptions.imageHeight));
+        case COLOR_FLOAT_PLANAR:
+          yaml.AddDictionaryEntry("color-buffer-format", "float-planar");
+          return std::unique_ptr<ImageFull>(new ImageRGBFloatPlanarColorDepth(
+              runOptions.imageWidth, runOptions.imageHeight));
+        case COLOR_HALF:
+          break;
       }
       break;
     case DEPTH_NONE:
@@ -215,6 +243,29 @@ static std::unique_ptr<ImageFull> createImage(const RunOptions& runOptions,
           return std::unique_ptr<ImageFull>(new ImageRGBAFloatColorOnly(
               runOptions.imageWidth, runOptions.imageHeight));
           break;
+        case COLOR_HALF:
+          yaml.AddDictionaryEntry("color-buffer-format", "half");
+          return std::unique_ptr<ImageFull>(new ImageRGBAHalfColorOnly(
+              runOptions.imageWidth, runOptions.imageHeight));
+          break;
+        case COLOR_FLOAT_PLANAR:
+          yaml.AddDictionaryEntry("color-buffer-format", "float-planar");
+          return std::unique_ptr<ImageFull>(new ImageRGBAFloatPlanarColorOnly(
+              runOptions.imageWidth, runOptions.imageHeight));
+          break;
+      }
+      break;
+    case DEPTH_HALF:
+      yaml.AddDictionaryEntry("depth-buffer-format", "half");
+      switch (runOptions.colorFormat) {
+        case COLOR_HALF:
+          yaml.AddDictionaryEntry("color-buffer-format", "half");
+          return std::unique_ptr<ImageFull>(new ImageRGBHalfColorHalfDepth(
+              runOptions.imageWidth, runOptions.imageHeight));
+        case COLOR_UBYTE:
+        case COLOR_FLOAT:
+        case COLOR_FLOAT_PLANAR:
+          break;
       }
       break;
   }
@@ -510,6 +561,44 @@ static std::unique_ptr<ImageFull> doComposeImage(const RunOptions& runOptions,
   return gatheredImage;
 }
 
+// Counts the pixels whose color differs by more than a threshold from the
+// same pixel of another image. The other image is usually, but not always,
+// of the same class (sparse images may uncompress to another layout).
+struct CountBadPixelsKernel {
+  const ImageFull& otherImage;
+  float colorThreshold;
+  int numBadPixels;
+
+  template <typename ImageType, typename OtherImageType>
+  void countBadPixels(const ImageType& image,
+                      const OtherImageType& otherTypedImage) {
+    int numPixels = image.getNumberOfPixels();
+    for (int pixel = 0; pixel < numPixels; ++pixel) {
+      Color otherColor = otherTypedImage.getColor(pixel);
+      Color color = image.getColor(pixel);
+      if ((fabsf(otherColor.Components[0] - color.Components[0]) >
+           this->colorThreshold) ||
+          (fabsf(otherColor.Components[1] - color.Components[1]) >
+           this->colorThreshold) ||
+          (fabsf(otherColor.Components[2] - color.Components[2]) >
+           this->colorThreshold)) {
+        ++this->numBadPixels;
+      }
+    }
+  }
+
+  template <typename ImageType>
+  void operator()(const ImageType& image) {
+    const ImageType* otherTypedImage =
+        Image::sameTypeCast<ImageType>(&this->otherImage, &image);
+    if (otherTypedImage != nullptr) {
+      this->countBadPixels(image, *otherTypedImage);
+    } else {
+      this->countBadPixels(image, this->otherImage);
+    }
+  }
+};
+
 static void checkImage(const ImageFull& fullCompositeImage,
                        ImageFull& localImage,
                        Painter& painter,
@@ -526,19 +615,9 @@ static void checkImage(const ImageFull& fullCompositeImage,
   doLocalPaint(localImage, painter, fullMesh, modelview, projection, dummyYaml);
 
   int numPixels = localImage.getNumberOfPixels();
-  int numBadPixels = 0;
-  for (int pixel = 0; pixel < numPixels; ++pixel) {
-    Color compositeColor = fullCompositeImage.getColor(pixel);
-    Color localColor = localImage.getColor(pixel);
-    if ((fabsf(compositeColor.Components[0] - localColor.Components[0]) >
-         COLOR_THRESHOLD) ||
-        (fabsf(compositeColor.Components[1] - localColor.Components[1]) >
-         COLOR_THRESHOLD) ||
-        (fabsf(compositeColor.Components[2] - localColor.Components[2]) >
-         COLOR_THRESHOLD)) {
-      ++numBadPixels;
-    }
-  }
+  CountBadPixelsKernel countBadPixels{fullCompositeImage, COLOR_THRESHOLD, 0};
+  dispatchImageFull(localImage, countBadPixels);
+  int numBadPixels = countBadPixels.numBadPixels;
   std::cout << (100 * numBadPixels) / numPixels << "% bad pixels." << std::endl;
   if (numBadPixels > BAD_PIXEL_THRESHOLD * numPixels) {
     std::cout << "Composite image appears bad!" << std::endl;
@@ -586,6 +665,17 @@ static void run(RunOptions& runOptions,
   int numProc;
   MPI_Comm_size(MPI_COMM_WORLD, &numProc);
 
+  // Must be set before any image buffers are allocated.
+  yaml.AddDictionaryEntry("huge-pages", runOptions.hugePages ? "on" : "off");
+  setHugePagesEnabled(runOptions.hugePages);
+
+  yaml.AddDictionaryEntry("threads", runOptions.numThreads);
+  setNumberOfThreads(runOptions.numThreads);
+
+  // Must be set before any images are created.
+  yaml.AddDictionaryEntry("tile-size", runOptions.tileSize);
+  Image::setTileSize(runOptions.tileSize);
+
   std::unique_ptr<ImageFull> localImage = createImage(runOptions, yaml);
   yaml.AddDictionaryEntry("rendering-order-dependent",
                           localImage->blendIsOrderDependent() ? "yes" : "no");
@@ -593,6 +683,9 @@ static void run(RunOptions& runOptions,
   yaml.AddDictionaryEntry("image-compression",
                           runOptions.compressImages ? "on" : "off");
 
+  yaml.AddDictionaryEntry("buffer-pool", runOptions.bufferPool ? "on" : "off");
+  setBufferPoolEnabled(runOptions.bufferPool);
+
   std::unique_ptr<Painter> painter = createPainter(runOptions, yaml);
 
   Mesh mesh = createMesh(runOptions, MPI_COMM_WORLD, yaml);
@@ -637,6 +730,8 @@ static void run(RunOptions& runOptions,
       // timing of the composition to be useful.
       MPI_Barrier(MPI_COMM_WORLD);
 
+      resetBufferPoolStatistics();
+
       fullCompositeImage = doComposeImage(runOptions,
                                           *localImage,
                                           *compositor,
@@ -647,6 +742,23 @@ static void run(RunOptions& runOptions,
       MPI_Group_free(&composeGroup);
     }
 
+    {
+      // Report how many image buffers during compositing were reused from
+      // previous rounds and trials and how many had to be allocated.
+      BufferPoolStatistics localStatistics = getBufferPoolStatistics();
+      long poolCounts[2] = {localStatistics.hits, localStatistics.misses};
+      long totalPoolCounts[2];
+      MPI_Reduce(poolCounts,
+                 totalPoolCounts,
+                 2,
+                 MPI_LONG,
+                 MPI_SUM,
+                 0,
+                 MPI_COMM_WORLD);
+      yaml.AddDictionaryEntry("buffer-pool-hits", totalPoolCounts[0]);
+      yaml.AddDictionaryEntry("buffer-pool-misses", totalPoolCounts[1]);
+    }
+
     if (runOptions.checkImage && (rank == 0)) {
       checkImage(*fullCompositeImage,
                  *localImage,
@@ -809,13 +921,25 @@ int MainLoop(int argc,
   usage.push_back(
     {COLOR_FORMAT, COLOR_FLOAT,   "",  "color-float", option::Arg::None,
      "  --color-float          Store colors in 32-bit float channels."});
+  usage.push_back(
+    {COLOR_FORMAT, COLOR_HALF,    "",  "color-half", option::Arg::None,
+     "  --color-half           Store colors in 16-bit float channels. Must be\n"
+     "                         used with --depth-half or --depth-none."});
+  usage.push_back(
+    {COLOR_FORMAT, COLOR_FLOAT_PLANAR, "", "color-float-planar", option::Arg::None,
+     "  --color-float-planar   Store colors in 32-bit float channels with each\n"
+     "                         channel in its own array."});
   usage.push_back(
     {DEPTH_FORMAT, DEPTH_FLOAT,   "",  "depth-float", option::Arg::None,
      "  --depth-float          Store depth as 32-bit float. (Default)"});
   usage.push_back(
     {DEPTH_FORMAT, DEPTH_NONE,    "",  "depth-none", option::Arg::None,
      "  --depth-none           Do not use a depth buffer. This option changes\n"
-     "                         the compositing to an alpha blending mode.\n"});
+     "                         the compositing to an alpha blending mode."});
+  usage.push_back(
+    {DEPTH_FORMAT, DEPTH_HALF,    "",  "depth-half", option::Arg::None,
+     "  --depth-half           Store depth as 16-bit float. Must be used with\n"
+     "                         --color-half.\n"});
 
   usage.push_back(
     {IMAGE_COMPRESS,ENABLE,       "",  "enable-image-compress", option::Arg::None,
@@ -825,6 +949,37 @@ int MainLoop(int argc,
     {IMAGE_COMPRESS,DISABLE,      "",  "disable-image-compress", option::Arg::None,
      "  --disable-image-compress Do not compress images during compositing.\n"});
 
+  usage.push_back(
+    {BUFFER_POOL,  ENABLE,        "",  "enable-buffer-pool", option::Arg::None,
+     "  --enable-buffer-pool   Reuse image buffers across compositing rounds\n"
+     "                         and trials rather than allocating new ones.\n"
+     "                         (Default)"});
+  usage.push_back(
+    {BUFFER_POOL,  DISABLE,       "",  "disable-buffer-pool", option::Arg::None,
+     "  --disable-buffer-pool  Allocate new image buffers whenever needed.\n"});
+
+  usage.push_back(
+    {HUGE_PAGES,   ENABLE,        "",  "enable-huge-pages", option::Arg::None,
+     "  --enable-huge-pages    Align large image buffers to 2 MiB and ask the\n"
+     "                         OS to back them with huge pages."});
+  usage.push_back(
+    {HUGE_PAGES,   DISABLE,       "",  "disable-huge-pages", option::Arg::None,
+     "  --disable-huge-pages   Use regular pages for image buffers. (Default)\n"});
+
+  usage.push_back(
+    {NUM_THREADS,  0,             "",  "threads", PositiveIntArg,
+     "  --threads=<num>        Set the number of threads each process uses to\n"
+     "                         blend, compress, and uncompress images.\n"
+     "                         (Default 1)\n"});
+
+  usage.push_back(
+    {TILE_SIZE,    0,             "",  "tile-size", PositiveIntArg,
+     "  --tile-size=<num>      Order the pixels of images in tiles of\n"
+     "                         <num> x <num> pixels so that the regions\n"
+     "                         compositing splits images into are compact\n"
+     "                         patches rather than strips. (Default is\n"
+     "                         scanline order)\n"});
+
   usage.push_back(
     {CAMERA_THETA, CAMERA_STILL,  "",  "camera-theta", FloatArg,
      "  --camera-theta=<angle> Set the camera theta value to a specific value\n"
@@ -987,12 +1142,40 @@ int MainLoop(int argc,
     runOptions.depthFormat =
         static_cast<depthType>(options[DEPTH_FORMAT].type());
   }
+  if ((runOptions.colorFormat == COLOR_HALF) !=
+      (runOptions.depthFormat == DEPTH_HALF)) {
+    if ((runOptions.colorFormat != COLOR_HALF) ||
+        (runOptions.depthFormat != DEPTH_NONE)) {
+      if (rank == 0) {
+        std::cerr << "Half depth buffers (--depth-half) can only be used "
+                  << "with half color buffers (--color-half) and vice versa."
+                  << std::endl;
+      }
+      return 1;
+    }
+  }
 
   if (options[IMAGE_COMPRESS]) {
     runOptions.compressImages =
         (options[IMAGE_COMPRESS].last()->type() == ENABLE);
   }
 
+  if (options[BUFFER_POOL]) {
+    runOptions.bufferPool = (options[BUFFER_POOL].last()->type() == ENABLE);
+  }
+
+  if (options[HUGE_PAGES]) {
+    runOptions.hugePages = (options[HUGE_PAGES].last()->type() == ENABLE);
+  }
+
+  if (options[NUM_THREADS]) {
+    runOptions.numThreads = atoi(options[NUM_THREADS].arg);
+  }
+
+  if (options[TILE_SIZE]) {
+    runOptions.tileSize = atoi(options[TILE_SIZE].arg);
+  }
+
   if (options[OVERLAP]) {
     runOptions.overlap = strtof(options[OVERLAP].arg, NULL);
   }
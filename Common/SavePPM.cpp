@@ -8,10 +8,31 @@
 
 #include "SavePPM.hpp"
 
+#include <Common/ImageDispatch.hpp>
 #include <Common/ImageFull.hpp>
 #include <Common/ImageSparse.hpp>
 
 #include <fstream>
+#include <vector>
+
+// Writes the RGB bytes of the pixels of an image, top row first.
+struct WritePixelsKernel {
+  std::ofstream &file;
+
+  template <typename ImageType>
+  void operator()(const ImageType &image) {
+    std::vector<char> row(3 * image.getWidth());
+    for (int y = image.getHeight() - 1; y >= 0; --y) {
+      for (int x = 0; x < image.getWidth(); ++x) {
+        Color color = image.getColor(x, y);
+        row[3 * x + 0] = color.GetComponentAsByte(0);
+        row[3 * x + 1] = color.GetComponentAsByte(1);
+        row[3 * x + 2] = color.GetComponentAsByte(2);
+      }
+      this->file.write(row.data(), row.size());
+    }
+  }
+};
 
 static bool doSavePPM(const ImageFull &image, const std::string &filename) {
   std::ofstream file(filename.c_str(),
@@ -21,14 +42,7 @@ static bool doSavePPM(const ImageFull &image, const std::string &filename) {
   file << image.getWidth() << " " << image.getHeight() << std::endl;
   file << 255 << std::endl;
 
-  for (int y = image.getHeight() - 1; y >= 0; --y) {
-    for (int x = 0; x < image.getWidth(); ++x) {
-      Color color = image.getColor(x, y);
-      file << color.GetComponentAsByte(0);
-      file << color.GetComponentAsByte(1);
-      file << color.GetComponentAsByte(2);
-    }
-  }
+  dispatchImageFull(image, WritePixelsKernel{file});
 
   file.close();
   return !file.fail();
@@ -0,0 +1,74 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include "SimdDispatch.hpp"
+
+static SimdLevel detectSimdLevel() {
+#ifdef MINIGRAPHICS_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512bw")) {
+    return SIMD_AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return SIMD_AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SIMD_SSE2;
+  }
+#endif
+  return SIMD_SCALAR;
+}
+
+static bool detectF16C() {
+#ifdef MINIGRAPHICS_SIMD_X86
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("f16c");
+#else
+  return false;
+#endif
+}
+
+static SimdLevel& currentSimdLevel() {
+  static SimdLevel level = getSupportedSimdLevel();
+  return level;
+}
+
+SimdLevel getSupportedSimdLevel() {
+  static SimdLevel supportedLevel = detectSimdLevel();
+  return supportedLevel;
+}
+
+SimdLevel getSimdLevel() { return currentSimdLevel(); }
+
+bool setSimdLevel(SimdLevel level) {
+  if (level > getSupportedSimdLevel()) {
+    return false;
+  }
+  currentSimdLevel() = level;
+  return true;
+}
+
+bool getSimdF16C() {
+  static bool supportsF16C = detectF16C();
+  return supportsF16C && (getSimdLevel() >= SIMD_AVX2);
+}
+
+const char* getSimdLevelName(SimdLevel level) {
+  switch (level) {
+    case SIMD_SCALAR:
+      return "scalar";
+    case SIMD_SSE2:
+      return "sse2";
+    case SIMD_AVX2:
+      return "avx2";
+    case SIMD_AVX512:
+      return "avx512";
+  }
+  return "unknown";
+}
@@ -0,0 +1,61 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef SIMDDISPATCH_HPP
+#define SIMDDISPATCH_HPP
+
+// Helper functions for selecting which instruction set the vectorized
+// compute kernels use. Kernels are compiled for every supported instruction
+// set (using function target attributes) and the best one the running CPU
+// supports is selected at run time.
+
+#include <miniGraphicsConfig.h>
+
+#if defined(MINIGRAPHICS_ENABLE_SIMD) &&                \
+    (defined(__GNUC__) || defined(__clang__)) &&       \
+    (defined(__x86_64__) || defined(__i386__))
+#define MINIGRAPHICS_SIMD_X86
+#define MINIGRAPHICS_SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+enum SimdLevel { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 };
+
+/// \brief Returns the best instruction set supported by this CPU.
+///
+/// AVX512 requires the AVX-512 foundation and byte/word instructions. If
+/// miniGraphics was compiled without SIMD support, this always returns
+/// SIMD_SCALAR.
+///
+SimdLevel getSupportedSimdLevel();
+
+/// \brief Returns the instruction set currently used by the compute kernels.
+///
+/// By default, this is the same as getSupportedSimdLevel.
+///
+SimdLevel getSimdLevel();
+
+/// \brief Restricts the compute kernels to the given instruction set.
+///
+/// This is mostly useful for testing and for comparing performance. Returns
+/// false (and leaves the level unchanged) if the CPU does not support the
+/// given instruction set.
+///
+bool setSimdLevel(SimdLevel level);
+
+/// \brief Returns true if kernels may use the F16C half-precision conversion
+/// instructions.
+///
+/// This requires both CPU support and a SIMD level of at least AVX2, so
+/// restricting the level with setSimdLevel also disables F16C.
+///
+bool getSimdF16C();
+
+/// \brief Returns a human readable name for the given instruction set.
+const char* getSimdLevelName(SimdLevel level);
+
+#endif  // SIMDDISPATCH_HPP
@@ -0,0 +1,450 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include <Common/BlendKernels.hpp>
+#include <Common/ImageRGBAFloatColorOnly.hpp>
+#include <Common/ImageRGBAFloatPlanarColorOnly.hpp>
+#include <Common/ImageRGBAHalfColorOnly.hpp>
+#include <Common/ImageRGBAUByteColorFloatDepth.hpp>
+#include <Common/ImageRGBAUByteColorOnly.hpp>
+#include <Common/ImageRGBFloatColorDepth.hpp>
+#include <Common/ImageRGBFloatPlanarColorDepth.hpp>
+#include <Common/SimdDispatch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#define TEST_ASSERT(condition) \
+  CheckAssert(condition, #condition, __FILE__, __LINE__);
+
+static void CheckAssert(bool condition,
+                        const std::string& conditionStr,
+                        const std::string& filename,
+                        int line) {
+  if (condition) {
+    std::cout << "    OK (" << conditionStr << ")" << std::endl;
+  } else {
+    std::cerr << "    *** FAILED! *** (" << conditionStr << "), " << filename
+              << ":" << line << std::endl;
+    exit(1);
+  }
+}
+
+// Enough pixels to exercise several full vectors and every remainder length
+// of the widest kernel.
+constexpr int MAX_PIXELS = 67;
+
+template <typename Features>
+struct PixelData {
+  using ColorType = typename Features::ColorType;
+  using DepthType = typename Features::DepthType;
+  static constexpr int ColorVecSize = Features::ColorVecSize;
+
+  std::vector<ColorType> topColor;
+  std::vector<DepthType> topDepth;
+  std::vector<ColorType> bottomColor;
+  std::vector<DepthType> bottomDepth;
+
+  PixelData(std::mt19937& generator)
+      : topColor(MAX_PIXELS * ColorVecSize),
+        topDepth(MAX_PIXELS),
+        bottomColor(MAX_PIXELS * ColorVecSize),
+        bottomDepth(MAX_PIXELS) {
+    std::uniform_real_distribution<float> randomFloat(0.0f, 1.0f);
+    for (int pixel = 0; pixel < MAX_PIXELS; ++pixel) {
+      Features::encodeColor(
+          Color(randomFloat(generator),
+                randomFloat(generator),
+                randomFloat(generator),
+                randomFloat(generator)),
+          &this->topColor[pixel * ColorVecSize]);
+      Features::encodeColor(
+          Color(randomFloat(generator),
+                randomFloat(generator),
+                randomFloat(generator),
+                randomFloat(generator)),
+          &this->bottomColor[pixel * ColorVecSize]);
+      // Quantize depths so that some of them tie.
+      float depth1 = static_cast<int>(randomFloat(generator) * 8) / 8.0f;
+      float depth2 = static_cast<int>(randomFloat(generator) * 8) / 8.0f;
+      Features::encodeDepth(depth1, &this->topDepth[pixel]);
+      Features::encodeDepth(depth2, &this->bottomDepth[pixel]);
+    }
+  }
+};
+
+template <typename Features>
+static void TestKernel(const std::string& featuresName) {
+  using ColorType = typename Features::ColorType;
+  using DepthType = typename Features::DepthType;
+  constexpr int ColorVecSize = Features::ColorVecSize;
+
+  std::cout << featuresName << std::endl;
+
+  std::mt19937 generator(2017);
+  PixelData<Features> data(generator);
+
+  SimdLevel supportedLevel = getSupportedSimdLevel();
+  for (int level = SIMD_SCALAR; level <= supportedLevel; ++level) {
+    std::cout << "  " << getSimdLevelName(static_cast<SimdLevel>(level))
+              << std::endl;
+    TEST_ASSERT(setSimdLevel(static_cast<SimdLevel>(level)));
+
+    bool allMatch = true;
+    for (int numPixels = 0; numPixels <= MAX_PIXELS; ++numPixels) {
+      std::vector<ColorType> expectedColor(MAX_PIXELS * ColorVecSize);
+      std::vector<DepthType> expectedDepth(MAX_PIXELS);
+      depthBlendGeneric<Features>(data.topColor.data(),
+                                  data.topDepth.data(),
+                                  data.bottomColor.data(),
+                                  data.bottomDepth.data(),
+                                  expectedColor.data(),
+                                  expectedDepth.data(),
+                                  numPixels);
+
+      // Pixels past numPixels must not be touched.
+      std::vector<ColorType> outColor(MAX_PIXELS * ColorVecSize);
+      std::vector<DepthType> outDepth(MAX_PIXELS);
+      Features::blendPixels(data.topColor.data(),
+                            data.topDepth.data(),
+                            data.bottomColor.data(),
+                            data.bottomDepth.data(),
+                            outColor.data(),
+                            outDepth.data(),
+                            numPixels);
+      allMatch &= (outColor == expectedColor) && (outDepth == expectedDepth);
+
+      // Blend in place into the top buffers. Past numPixels the top buffers
+      // should be unchanged.
+      std::vector<ColorType> inPlaceColor = data.topColor;
+      std::vector<DepthType> inPlaceDepth = data.topDepth;
+      Features::blendPixels(inPlaceColor.data(),
+                            inPlaceDepth.data(),
+                            data.bottomColor.data(),
+                            data.bottomDepth.data(),
+                            inPlaceColor.data(),
+                            inPlaceDepth.data(),
+                            numPixels);
+      std::copy(data.topColor.begin() + numPixels * ColorVecSize,
+                data.topColor.end(),
+                expectedColor.begin() + numPixels * ColorVecSize);
+      std::copy(data.topDepth.begin() + numPixels,
+                data.topDepth.end(),
+                expectedDepth.begin() + numPixels);
+      allMatch &=
+          (inPlaceColor == expectedColor) && (inPlaceDepth == expectedDepth);
+    }
+    TEST_ASSERT(allMatch);
+  }
+
+  setSimdLevel(supportedLevel);
+}
+
+// Integer colors must match exactly. Float colors may differ in the last bit
+// or so depending on whether the compiler fuses the multiply and add.
+static bool colorsMatch(const std::vector<unsigned int>& colors1,
+                        const std::vector<unsigned int>& colors2) {
+  return colors1 == colors2;
+}
+
+static bool colorsMatch(const std::vector<float>& colors1,
+                        const std::vector<float>& colors2) {
+  if (colors1.size() != colors2.size()) {
+    return false;
+  }
+  for (std::size_t index = 0; index < colors1.size(); ++index) {
+    if (std::abs(colors1[index] - colors2[index]) > 1e-6f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Half colors are converted from floats so may round differently in the last
+// bit.
+static bool colorsMatch(const std::vector<Half>& colors1,
+                        const std::vector<Half>& colors2) {
+  if (colors1.size() != colors2.size()) {
+    return false;
+  }
+  for (std::size_t index = 0; index < colors1.size(); ++index) {
+    if (std::abs(halfToFloat(colors1[index]) - halfToFloat(colors2[index])) >
+        1e-3f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Features>
+struct OverPixelData {
+  using ColorType = typename Features::ColorType;
+  static constexpr int ColorVecSize = Features::ColorVecSize;
+
+  std::vector<ColorType> topColor;
+  std::vector<ColorType> bottomColor;
+
+  OverPixelData(std::mt19937& generator)
+      : topColor(MAX_PIXELS * ColorVecSize),
+        bottomColor(MAX_PIXELS * ColorVecSize) {
+    std::uniform_real_distribution<float> randomFloat(0.0f, 1.0f);
+    for (int pixel = 0; pixel < MAX_PIXELS; ++pixel) {
+      this->encodePremultiplied(
+          randomFloat, generator, &this->topColor[pixel * ColorVecSize]);
+      this->encodePremultiplied(
+          randomFloat, generator, &this->bottomColor[pixel * ColorVecSize]);
+    }
+    // Make sure the extremes of alpha are covered.
+    Features::encodeColor(Color(0.5f, 0.5f, 0.5f, 1.0f), &this->topColor[0]);
+    Features::encodeColor(Color(0.0f, 0.0f, 0.0f, 0.0f),
+                          &this->topColor[ColorVecSize]);
+    Features::encodeColor(Color(1.0f, 1.0f, 1.0f, 1.0f),
+                          &this->bottomColor[ColorVecSize]);
+  }
+
+ private:
+  static void encodePremultiplied(
+      std::uniform_real_distribution<float>& randomFloat,
+      std::mt19937& generator,
+      ColorType colorComponents[ColorVecSize]) {
+    float alpha = randomFloat(generator);
+    Features::encodeColor(Color(alpha * randomFloat(generator),
+                                alpha * randomFloat(generator),
+                                alpha * randomFloat(generator),
+                                alpha),
+                          colorComponents);
+  }
+};
+
+template <typename Features>
+static void TestOverKernel(const std::string& featuresName) {
+  using ColorType = typename Features::ColorType;
+  constexpr int ColorVecSize = Features::ColorVecSize;
+
+  std::cout << featuresName << std::endl;
+
+  std::mt19937 generator(2017);
+  OverPixelData<Features> data(generator);
+
+  SimdLevel supportedLevel = getSupportedSimdLevel();
+  for (int level = SIMD_SCALAR; level <= supportedLevel; ++level) {
+    std::cout << "  " << getSimdLevelName(static_cast<SimdLevel>(level))
+              << std::endl;
+    TEST_ASSERT(setSimdLevel(static_cast<SimdLevel>(level)));
+
+    bool allMatch = true;
+    for (int numPixels = 0; numPixels <= MAX_PIXELS; ++numPixels) {
+      std::vector<ColorType> expectedColor(MAX_PIXELS * ColorVecSize);
+      overBlendGeneric<Features>(data.topColor.data(),
+                                 data.bottomColor.data(),
+                                 expectedColor.data(),
+                                 numPixels);
+
+      // Pixels past numPixels must not be touched.
+      std::vector<ColorType> outColor(MAX_PIXELS * ColorVecSize);
+      Features::blendPixels(data.topColor.data(),
+                            data.bottomColor.data(),
+                            outColor.data(),
+                            numPixels);
+      allMatch &= colorsMatch(outColor, expectedColor);
+
+      // Blend in place into the bottom buffer (as when compositing into an
+      // accumulated image).
+      std::vector<ColorType> inPlaceColor = data.bottomColor;
+      Features::blendPixels(data.topColor.data(),
+                            inPlaceColor.data(),
+                            inPlaceColor.data(),
+                            numPixels);
+      std::copy(data.bottomColor.begin() + numPixels * ColorVecSize,
+                data.bottomColor.end(),
+                expectedColor.begin() + numPixels * ColorVecSize);
+      allMatch &= colorsMatch(inPlaceColor, expectedColor);
+    }
+    TEST_ASSERT(allMatch);
+  }
+
+  setSimdLevel(supportedLevel);
+}
+
+// Holds colors with each channel in its own array along with the channel
+// pointers that the planar blend functions take.
+template <typename ColorType, int ColorVecSize>
+struct PlanarColors {
+  std::vector<ColorType> channels;
+  ColorType* pointers[ColorVecSize];
+
+  PlanarColors(const std::vector<ColorType>& interleaved)
+      : channels(interleaved.size()) {
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      this->pointers[channel] = &this->channels[channel * MAX_PIXELS];
+      for (int pixel = 0; pixel < MAX_PIXELS; ++pixel) {
+        this->pointers[channel][pixel] =
+            interleaved[pixel * ColorVecSize + channel];
+      }
+    }
+  }
+  // The pointers refer to this object's own channels.
+  PlanarColors(const PlanarColors&) = delete;
+
+  std::vector<ColorType> interleaved() const {
+    std::vector<ColorType> result(this->channels.size());
+    for (int channel = 0; channel < ColorVecSize; ++channel) {
+      for (int pixel = 0; pixel < MAX_PIXELS; ++pixel) {
+        result[pixel * ColorVecSize + channel] =
+            this->pointers[channel][pixel];
+      }
+    }
+    return result;
+  }
+};
+
+template <typename Features>
+static void TestPlanarKernel(const std::string& featuresName) {
+  using InterleavedFeatures = typename Features::InterleavedFeatures;
+  using ColorType = typename Features::ColorType;
+  using DepthType = typename Features::DepthType;
+  constexpr int ColorVecSize = Features::ColorVecSize;
+  using Planar = PlanarColors<ColorType, ColorVecSize>;
+
+  std::cout << featuresName << std::endl;
+
+  std::mt19937 generator(2017);
+  PixelData<InterleavedFeatures> data(generator);
+  const Planar topColor(data.topColor);
+  const Planar bottomColor(data.bottomColor);
+
+  SimdLevel supportedLevel = getSupportedSimdLevel();
+  for (int level = SIMD_SCALAR; level <= supportedLevel; ++level) {
+    std::cout << "  " << getSimdLevelName(static_cast<SimdLevel>(level))
+              << std::endl;
+    TEST_ASSERT(setSimdLevel(static_cast<SimdLevel>(level)));
+
+    bool allMatch = true;
+    for (int numPixels = 0; numPixels <= MAX_PIXELS; ++numPixels) {
+      std::vector<ColorType> expectedColor(MAX_PIXELS * ColorVecSize);
+      std::vector<DepthType> expectedDepth(MAX_PIXELS);
+      depthBlendGeneric<InterleavedFeatures>(data.topColor.data(),
+                                             data.topDepth.data(),
+                                             data.bottomColor.data(),
+                                             data.bottomDepth.data(),
+                                             expectedColor.data(),
+                                             expectedDepth.data(),
+                                             numPixels);
+
+      // Pixels past numPixels must not be touched.
+      Planar outColor(std::vector<ColorType>(MAX_PIXELS * ColorVecSize));
+      std::vector<DepthType> outDepth(MAX_PIXELS);
+      Features::blendPixels(topColor.pointers,
+                            data.topDepth.data(),
+                            bottomColor.pointers,
+                            data.bottomDepth.data(),
+                            outColor.pointers,
+                            outDepth.data(),
+                            numPixels);
+      allMatch &= (outColor.interleaved() == expectedColor) &&
+                  (outDepth == expectedDepth);
+
+      // Blend in place into the top buffers.
+      Planar inPlaceColor(data.topColor);
+      std::vector<DepthType> inPlaceDepth = data.topDepth;
+      Features::blendPixels(inPlaceColor.pointers,
+                            inPlaceDepth.data(),
+                            bottomColor.pointers,
+                            data.bottomDepth.data(),
+                            inPlaceColor.pointers,
+                            inPlaceDepth.data(),
+                            numPixels);
+      std::copy(data.topColor.begin() + numPixels * ColorVecSize,
+                data.topColor.end(),
+                expectedColor.begin() + numPixels * ColorVecSize);
+      std::copy(data.topDepth.begin() + numPixels,
+                data.topDepth.end(),
+                expectedDepth.begin() + numPixels);
+      allMatch &= (inPlaceColor.interleaved() == expectedColor) &&
+                  (inPlaceDepth == expectedDepth);
+    }
+    TEST_ASSERT(allMatch);
+  }
+
+  setSimdLevel(supportedLevel);
+}
+
+template <typename Features>
+static void TestPlanarOverKernel(const std::string& featuresName) {
+  using InterleavedFeatures = typename Features::InterleavedFeatures;
+  using ColorType = typename Features::ColorType;
+  constexpr int ColorVecSize = Features::ColorVecSize;
+  using Planar = PlanarColors<ColorType, ColorVecSize>;
+
+  std::cout << featuresName << std::endl;
+
+  std::mt19937 generator(2017);
+  OverPixelData<InterleavedFeatures> data(generator);
+  const Planar topColor(data.topColor);
+  const Planar bottomColor(data.bottomColor);
+
+  SimdLevel supportedLevel = getSupportedSimdLevel();
+  for (int level = SIMD_SCALAR; level <= supportedLevel; ++level) {
+    std::cout << "  " << getSimdLevelName(static_cast<SimdLevel>(level))
+              << std::endl;
+    TEST_ASSERT(setSimdLevel(static_cast<SimdLevel>(level)));
+
+    bool allMatch = true;
+    for (int numPixels = 0; numPixels <= MAX_PIXELS; ++numPixels) {
+      std::vector<ColorType> expectedColor(MAX_PIXELS * ColorVecSize);
+      overBlendGeneric<InterleavedFeatures>(data.topColor.data(),
+                                            data.bottomColor.data(),
+                                            expectedColor.data(),
+                                            numPixels);
+
+      // Pixels past numPixels must not be touched.
+      Planar outColor(std::vector<ColorType>(MAX_PIXELS * ColorVecSize));
+      Features::blendPixels(
+          topColor.pointers, bottomColor.pointers, outColor.pointers, numPixels);
+      allMatch &= colorsMatch(outColor.interleaved(), expectedColor);
+
+      // Blend in place into the bottom buffer.
+      Planar inPlaceColor(data.bottomColor);
+      Features::blendPixels(topColor.pointers,
+                            inPlaceColor.pointers,
+                            inPlaceColor.pointers,
+                            numPixels);
+      std::copy(data.bottomColor.begin() + numPixels * ColorVecSize,
+                data.bottomColor.end(),
+                expectedColor.begin() + numPixels * ColorVecSize);
+      allMatch &= colorsMatch(inPlaceColor.interleaved(), expectedColor);
+    }
+    TEST_ASSERT(allMatch);
+  }
+
+  setSimdLevel(supportedLevel);
+}
+
+#define DO_KERNEL_TEST(ImageType) TestKernel<ImageType##Features>(#ImageType)
+#define DO_OVER_KERNEL_TEST(ImageType) \
+  TestOverKernel<ImageType##Features>(#ImageType)
+#define DO_PLANAR_KERNEL_TEST(ImageType) \
+  TestPlanarKernel<ImageType##Features>(#ImageType)
+#define DO_PLANAR_OVER_KERNEL_TEST(ImageType) \
+  TestPlanarOverKernel<ImageType##Features>(#ImageType)
+
+int BlendKernelsTest(int, char* []) {
+  DO_KERNEL_TEST(ImageRGBAUByteColorFloatDepth);
+  DO_KERNEL_TEST(ImageRGBFloatColorDepth);
+  DO_OVER_KERNEL_TEST(ImageRGBAUByteColorOnly);
+  DO_OVER_KERNEL_TEST(ImageRGBAFloatColorOnly);
+  DO_OVER_KERNEL_TEST(ImageRGBAHalfColorOnly);
+  DO_PLANAR_KERNEL_TEST(ImageRGBFloatPlanarColorDepth);
+  DO_PLANAR_OVER_KERNEL_TEST(ImageRGBAFloatPlanarColorOnly);
+
+  return 0;
+}
@@ -0,0 +1,152 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include <Common/AlignedAllocator.hpp>
+#include <Common/BufferPool.hpp>
+#include <Common/ImageRGBAUByteColorFloatDepth.hpp>
+#include <Common/ImageRGBFloatColorDepth.hpp>
+#include <Common/ImageSparse.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#define TEST_ASSERT(condition) \
+  CheckAssert(condition, #condition, __FILE__, __LINE__);
+
+static void CheckAssert(bool condition,
+                        const std::string& conditionStr,
+                        const std::string& filename,
+                        int line) {
+  if (condition) {
+    std::cout << "    OK (" << conditionStr << ")" << std::endl;
+  } else {
+    std::cerr << "    *** FAILED! *** (" << conditionStr << "), " << filename
+              << ":" << line << std::endl;
+    exit(1);
+  }
+}
+
+static void TestAcquireRelease() {
+  std::cout << "Acquire and release" << std::endl;
+
+  // Use an odd type so that nothing else has put buffers in its pool.
+  using BufferType = std::vector<short>;
+
+  resetBufferPoolStatistics();
+  std::shared_ptr<BufferType> buffer1 = acquirePooledBuffer<short>(100);
+  TEST_ASSERT(buffer1->size() == 100);
+  TEST_ASSERT(getBufferPoolStatistics().misses == 1);
+  TEST_ASSERT(getBufferPoolStatistics().hits == 0);
+
+  BufferType* firstBuffer = buffer1.get();
+  buffer1.reset();
+
+  // A buffer of a similar size should come from the pool.
+  std::shared_ptr<BufferType> buffer2 = acquirePooledBuffer<short>(120);
+  TEST_ASSERT(buffer2.get() == firstBuffer);
+  TEST_ASSERT(buffer2->size() == 120);
+  TEST_ASSERT(getBufferPoolStatistics().hits == 1);
+
+  // A much bigger buffer has to be allocated.
+  std::shared_ptr<BufferType> buffer3 = acquirePooledBuffer<short>(1000);
+  TEST_ASSERT(getBufferPoolStatistics().misses == 2);
+
+  std::cout << "Resize" << std::endl;
+  resizePooledBuffer(buffer2, 50);
+  TEST_ASSERT(buffer2.get() == firstBuffer);
+  TEST_ASSERT(buffer2->size() == 50);
+
+  // A shared buffer must be replaced rather than resized.
+  std::shared_ptr<BufferType> buffer2Copy = buffer2;
+  resizePooledBuffer(buffer2, 60);
+  TEST_ASSERT(buffer2.get() != firstBuffer);
+  TEST_ASSERT(buffer2Copy->size() == 50);
+  TEST_ASSERT(buffer2->size() == 60);
+
+  std::cout << "Reserve" << std::endl;
+  resizePooledBuffer(buffer3, 0);
+  BufferType* thirdBuffer = buffer3.get();
+  reservePooledBuffer(buffer3, 1000);
+  TEST_ASSERT(buffer3.get() == thirdBuffer);
+  reservePooledBuffer(buffer3, 5000);
+  TEST_ASSERT(buffer3->capacity() >= 5000);
+
+  std::cout << "Disabled" << std::endl;
+  setBufferPoolEnabled(false);
+  resetBufferPoolStatistics();
+  std::shared_ptr<BufferType> buffer4 = acquirePooledBuffer<short>(100);
+  TEST_ASSERT(buffer4->size() == 100);
+  TEST_ASSERT(getBufferPoolStatistics().hits == 0);
+  TEST_ASSERT(getBufferPoolStatistics().misses == 0);
+  setBufferPoolEnabled(true);
+}
+
+static void TestImageReuse() {
+  std::cout << "Image reuse" << std::endl;
+
+  constexpr int WIDTH = 110;
+  constexpr int HEIGHT = 100;
+
+  // Go through the allocations of a composite twice. The second time,
+  // everything should come from the pool.
+  for (int pass = 0; pass < 2; ++pass) {
+    resetBufferPoolStatistics();
+
+    ImageRGBAUByteColorFloatDepth image(WIDTH, HEIGHT);
+    image.clear(Color(0, 0, 0, 0));
+    image.setColor(50, Color(1, 0, 0, 1));
+    image.setDepth(50, 0.5f);
+
+    std::unique_ptr<ImageSparse> compressed = image.compress();
+    std::unique_ptr<Image> half1 = compressed->copySubrange(0, 5500);
+    std::unique_ptr<Image> half2 = compressed->copySubrange(5500, 11000);
+    half1->blendInPlace(*compressed->window(0, 5500));
+    std::unique_ptr<ImageFull> uncompressed =
+        dynamic_cast<ImageSparse&>(*half1).uncompress();
+
+    if (pass == 1) {
+      TEST_ASSERT(getBufferPoolStatistics().misses == 0);
+      TEST_ASSERT(getBufferPoolStatistics().hits > 0);
+    }
+  }
+}
+
+static bool isAligned(const void* pointer, std::size_t alignment) {
+  return (reinterpret_cast<std::uintptr_t>(pointer) % alignment) == 0;
+}
+
+static void TestAlignment() {
+  std::cout << "Alignment" << std::endl;
+
+  // Odd sizes so that the default allocator would likely not align them.
+  for (std::size_t size = 1; size < 200; size += 37) {
+    std::vector<char, AlignedAllocator<char>> buffer(size);
+    TEST_ASSERT(isAligned(buffer.data(), ALIGNED_ALLOCATOR_ALIGNMENT));
+  }
+
+  ImageRGBFloatColorDepth image(33, 7);
+  TEST_ASSERT(isAligned(image.getColorBuffer(), ALIGNED_ALLOCATOR_ALIGNMENT));
+  TEST_ASSERT(isAligned(image.getDepthBuffer(), ALIGNED_ALLOCATOR_ALIGNMENT));
+
+  std::cout << "Huge pages" << std::endl;
+  setHugePagesEnabled(true);
+  std::vector<char, AlignedAllocator<char>> smallBuffer(1000);
+  TEST_ASSERT(isAligned(smallBuffer.data(), ALIGNED_ALLOCATOR_ALIGNMENT));
+  std::vector<char, AlignedAllocator<char>> bigBuffer(HUGE_PAGE_SIZE + 10);
+  TEST_ASSERT(isAligned(bigBuffer.data(), HUGE_PAGE_SIZE));
+  setHugePagesEnabled(false);
+}
+
+int BufferPoolTest(int, char* []) {
+  TestAcquireRelease();
+  TestImageReuse();
+  TestAlignment();
+
+  return 0;
+}
@@ -0,0 +1,181 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include <Common/DepthRanges.hpp>
+#include <Common/ImageRGBAUByteColorFloatDepth.hpp>
+#include <Common/ImageRGBFloatColorDepth.hpp>
+#include <Common/ImageRGBFloatPlanarColorDepth.hpp>
+#include <Common/ImageRGBHalfColorHalfDepth.hpp>
+#include <Common/ImageSparse.hpp>
+
+#include <iostream>
+#include <string>
+
+#define TEST_ASSERT(condition) \
+  CheckAssert(condition, #condition, __FILE__, __LINE__);
+
+static void CheckAssert(bool condition,
+                        const std::string& conditionStr,
+                        const std::string& filename,
+                        int line) {
+  if (condition) {
+    std::cout << "    OK (" << conditionStr << ")" << std::endl;
+  } else {
+    std::cerr << "    *** FAILED! *** (" << conditionStr << "), " << filename
+              << ":" << line << std::endl;
+    exit(1);
+  }
+}
+
+constexpr int IMAGE_WIDTH = 200;
+constexpr int IMAGE_HEIGHT = 100;
+
+static void TestCompare() {
+  std::cout << "Compare ranges" << std::endl;
+
+  using Ranges = DepthRanges<ImageRGBFloatColorDepthFeatures>;
+  Ranges::Range nearRange = {0.125f, 0.25f};
+  Ranges::Range farRange = {0.5f, 0.75f};
+  Ranges::Range touchingRange = {0.25f, 0.5f};
+  Ranges::Range overlappingRange = {0.0f, 1.0f};
+
+  TEST_ASSERT(Ranges::isKnown(nearRange));
+  TEST_ASSERT(!Ranges::isKnown(Ranges::unknownRange()));
+  TEST_ASSERT(Ranges::compare(nearRange, farRange) == DEPTH_ORDER_TOP);
+  TEST_ASSERT(Ranges::compare(farRange, nearRange) == DEPTH_ORDER_BOTTOM);
+  // Equal depths go to the top image.
+  TEST_ASSERT(Ranges::compare(nearRange, touchingRange) == DEPTH_ORDER_TOP);
+  TEST_ASSERT(Ranges::compare(touchingRange, nearRange) == DEPTH_ORDER_MIXED);
+  TEST_ASSERT(Ranges::compare(overlappingRange, farRange) ==
+              DEPTH_ORDER_MIXED);
+  TEST_ASSERT(Ranges::compare(Ranges::unknownRange(), farRange) ==
+              DEPTH_ORDER_MIXED);
+}
+
+// Fills an image so that, block by block, it is entirely in front of the
+// image with the other seed, entirely behind it, or mixed with it. Depths
+// are multiples of 1/16 so that every image type represents them exactly.
+template <typename ImageType>
+static std::unique_ptr<ImageType> createImage(int seed) {
+  std::unique_ptr<ImageType> image(new ImageType(IMAGE_WIDTH, IMAGE_HEIGHT));
+  image->clear();
+  for (int pixel = 0; pixel < image->getNumberOfPixels(); ++pixel) {
+    int block = pixel / DEPTH_RANGE_BLOCK_SIZE;
+    float depth;
+    switch ((block + seed) % 3) {
+      case 0:
+        depth = (1 + pixel % 4) / 16.0f;
+        break;
+      case 1:
+        depth = (10 + pixel % 4) / 16.0f;
+        break;
+      default:
+        depth = ((pixel * 7 + seed) % 15) / 16.0f;
+        break;
+    }
+    image->setColor(pixel,
+                    Color((pixel % 17) / 16.0f,
+                          (block % 5) / 4.0f,
+                          seed / 4.0f,
+                          1.0f));
+    image->setDepth(pixel, depth);
+  }
+  return image;
+}
+
+// Checks a blended image pixel by pixel against the two inputs.
+static bool blendIsCorrect(const ImageFull& topImage,
+                           const ImageFull& bottomImage,
+                           const ImageFull& blendedImage) {
+  if ((blendedImage.getNumberOfPixels() != topImage.getNumberOfPixels()) ||
+      (blendedImage.getNumberOfPixels() != bottomImage.getNumberOfPixels())) {
+    return false;
+  }
+  for (int pixel = 0; pixel < blendedImage.getNumberOfPixels(); ++pixel) {
+    const ImageFull& expected =
+        (bottomImage.getDepth(pixel) < topImage.getDepth(pixel))
+            ? bottomImage
+            : topImage;
+    Color expectedColor = expected.getColor(pixel);
+    Color actualColor = blendedImage.getColor(pixel);
+    for (int component = 0; component < 4; ++component) {
+      if (expectedColor.Components[component] !=
+          actualColor.Components[component]) {
+        return false;
+      }
+    }
+    if (expected.getDepth(pixel) != blendedImage.getDepth(pixel)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename ImageType>
+static void TestImage(const std::string& imageTypeName) {
+  std::cout << imageTypeName << std::endl;
+
+  std::unique_ptr<ImageType> topImage = createImage<ImageType>(0);
+  std::unique_ptr<ImageType> bottomImage = createImage<ImageType>(1);
+
+  std::unique_ptr<Image> blended = topImage->createNew();
+  topImage->blendInto(*bottomImage, *blended);
+  TEST_ASSERT(blendIsCorrect(
+      *topImage, *bottomImage, dynamic_cast<ImageFull&>(*blended)));
+
+  // The blended image keeps a summary for the next blend.
+  std::unique_ptr<Image> blendedAgain = blended->createNew();
+  blended->blendInto(*bottomImage, *blendedAgain);
+  TEST_ASSERT(blendIsCorrect(dynamic_cast<ImageFull&>(*blended),
+                             *bottomImage,
+                             dynamic_cast<ImageFull&>(*blendedAgain)));
+
+  // Changing pixels after the summary is computed must not use stale ranges.
+  for (int pixel = 0; pixel < topImage->getNumberOfPixels(); pixel += 5) {
+    topImage->setDepth(pixel, 15.0f / 16.0f);
+  }
+  topImage->blendInto(*bottomImage, *blended);
+  TEST_ASSERT(blendIsCorrect(
+      *topImage, *bottomImage, dynamic_cast<ImageFull&>(*blended)));
+
+  // Windows start in the middle of blocks.
+  std::unique_ptr<const Image> topWindow = topImage->window(37, 10037);
+  std::unique_ptr<const Image> bottomWindow = bottomImage->window(37, 10037);
+  std::unique_ptr<Image> blendedWindow = topWindow->createNew();
+  topWindow->blendInto(*bottomWindow, *blendedWindow);
+  TEST_ASSERT(blendIsCorrect(dynamic_cast<const ImageFull&>(*topWindow),
+                             dynamic_cast<const ImageFull&>(*bottomWindow),
+                             dynamic_cast<ImageFull&>(*blendedWindow)));
+
+  // Blending in place skips copying blocks where the top image is in front.
+  std::unique_ptr<Image> inPlace = topImage->deepCopy();
+  inPlace->blendInPlace(*bottomImage);
+  TEST_ASSERT(blendIsCorrect(*topImage,
+                             *bottomImage,
+                             dynamic_cast<ImageFull&>(*inPlace)));
+
+  // Sparse images use the summaries of their active pixels.
+  std::unique_ptr<ImageSparse> topSparse = topImage->compress();
+  std::unique_ptr<ImageSparse> bottomSparse = bottomImage->compress();
+  topSparse->blendInPlace(*bottomSparse);
+  TEST_ASSERT(
+      blendIsCorrect(*topImage, *bottomImage, *topSparse->uncompress()));
+}
+
+#define DO_IMAGE_TEST(ImageType) TestImage<ImageType>(#ImageType)
+
+int DepthRangesTest(int, char* []) {
+  TestCompare();
+
+  DO_IMAGE_TEST(ImageRGBAUByteColorFloatDepth);
+  DO_IMAGE_TEST(ImageRGBFloatColorDepth);
+  DO_IMAGE_TEST(ImageRGBHalfColorHalfDepth);
+  DO_IMAGE_TEST(ImageRGBFloatPlanarColorDepth);
+
+  return 0;
+}
@@ -0,0 +1,164 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include <Common/Half.hpp>
+#include <Common/SimdDispatch.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#define TEST_ASSERT(condition) \
+  CheckAssert(condition, #condition, __FILE__, __LINE__);
+
+static void CheckAssert(bool condition,
+                        const std::string& conditionStr,
+                        const std::string& filename,
+                        int line) {
+  if (condition) {
+    std::cout << "    OK (" << conditionStr << ")" << std::endl;
+  } else {
+    std::cerr << "    *** FAILED! *** (" << conditionStr << "), " << filename
+              << ":" << line << std::endl;
+    exit(1);
+  }
+}
+
+static bool sameBits(float value1, float value2) {
+  return std::memcmp(&value1, &value2, sizeof(float)) == 0;
+}
+
+static void TestKnownValues() {
+  std::cout << "  Known values" << std::endl;
+  TEST_ASSERT(floatToHalf(0.0f) == 0x0000);
+  TEST_ASSERT(floatToHalf(-0.0f) == 0x8000);
+  TEST_ASSERT(floatToHalf(1.0f) == 0x3C00);
+  TEST_ASSERT(floatToHalf(-2.0f) == 0xC000);
+  TEST_ASSERT(floatToHalf(0.5f) == 0x3800);
+  TEST_ASSERT(floatToHalf(65504.0f) == 0x7BFF);
+  TEST_ASSERT(floatToHalf(65520.0f) == 0x7C00);
+  TEST_ASSERT(floatToHalf(std::numeric_limits<float>::infinity()) == 0x7C00);
+  TEST_ASSERT(floatToHalf(std::ldexp(1.0f, -24)) == 0x0001);
+  TEST_ASSERT(floatToHalf(std::ldexp(1.0f, -25)) == 0x0000);
+  // 1 + 2^-11 is halfway between two halves and rounds to even.
+  TEST_ASSERT(floatToHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3C00);
+  TEST_ASSERT(floatToHalf(1.0f + 3 * std::ldexp(1.0f, -11)) == 0x3C02);
+
+  TEST_ASSERT(halfToFloat(0x3C00) == 1.0f);
+  TEST_ASSERT(halfToFloat(0x0001) == std::ldexp(1.0f, -24));
+  TEST_ASSERT(std::isnan(halfToFloat(0x7E00)));
+
+  TEST_ASSERT(halfLess(floatToHalf(-1.0f), floatToHalf(-0.5f)));
+  TEST_ASSERT(halfLess(floatToHalf(-0.5f), floatToHalf(0.25f)));
+  TEST_ASSERT(halfLess(floatToHalf(0.25f), floatToHalf(1.0f)));
+  TEST_ASSERT(!halfLess(floatToHalf(1.0f), floatToHalf(1.0f)));
+}
+
+static void TestAllHalves() {
+  std::cout << "  All halves" << std::endl;
+  std::vector<Half> halves(0x10000);
+  for (std::size_t index = 0; index < halves.size(); ++index) {
+    halves[index] = static_cast<Half>(index);
+  }
+  std::vector<float> values(halves.size());
+  halfToFloat(halves.data(), values.data(), static_cast<int>(halves.size()));
+
+  // Every half except NaN converts to float and back unchanged.
+  std::vector<Half> roundTrip(halves.size());
+  floatToHalf(values.data(), roundTrip.data(), static_cast<int>(values.size()));
+  bool allMatch = true;
+  for (std::size_t index = 0; index < halves.size(); ++index) {
+    if (!std::isnan(values[index])) {
+      allMatch &= (roundTrip[index] == halves[index]);
+    }
+  }
+  TEST_ASSERT(allMatch);
+
+  // Ordering on the bit patterns matches ordering of the float values.
+  bool orderMatches = true;
+  std::mt19937 generator(2017);
+  std::uniform_int_distribution<int> randomHalf(0, 0xFFFF);
+  for (int trial = 0; trial < 100000; ++trial) {
+    Half half1 = static_cast<Half>(randomHalf(generator));
+    Half half2 = static_cast<Half>(randomHalf(generator));
+    float value1 = halfToFloat(half1);
+    float value2 = halfToFloat(half2);
+    if (std::isnan(value1) || std::isnan(value2) ||
+        ((value1 == 0.0f) && (value2 == 0.0f))) {
+      continue;
+    }
+    orderMatches &= (halfLess(half1, half2) == (value1 < value2));
+  }
+  TEST_ASSERT(orderMatches);
+}
+
+// Conversions at every SIMD level must give identical bits.
+static void TestSimdLevels() {
+  std::cout << "  SIMD levels" << std::endl;
+
+  std::vector<Half> halves(0x10000);
+  for (std::size_t index = 0; index < halves.size(); ++index) {
+    halves[index] = static_cast<Half>(index);
+  }
+
+  std::mt19937 generator(2017);
+  std::uniform_int_distribution<std::uint32_t> randomBits;
+  std::vector<float> floats(100003);
+  for (float& value : floats) {
+    std::uint32_t bits = randomBits(generator);
+    // Bias toward the range representable by halves.
+    if (bits & 1) {
+      bits = (bits & 0x83FFFFFF) | 0x38000000;
+    }
+    std::memcpy(&value, &bits, sizeof(value));
+  }
+
+  SimdLevel supportedLevel = getSupportedSimdLevel();
+  TEST_ASSERT(setSimdLevel(SIMD_SCALAR));
+  std::vector<float> expectedFloats(halves.size());
+  halfToFloat(
+      halves.data(), expectedFloats.data(), static_cast<int>(halves.size()));
+  std::vector<Half> expectedHalves(floats.size());
+  floatToHalf(
+      floats.data(), expectedHalves.data(), static_cast<int>(floats.size()));
+
+  for (int level = SIMD_SCALAR; level <= supportedLevel; ++level) {
+    TEST_ASSERT(setSimdLevel(static_cast<SimdLevel>(level)));
+    std::cout << "  " << getSimdLevelName(static_cast<SimdLevel>(level))
+              << (getSimdF16C() ? " (F16C)" : "") << std::endl;
+
+    std::vector<float> convertedFloats(halves.size());
+    halfToFloat(
+        halves.data(), convertedFloats.data(), static_cast<int>(halves.size()));
+    bool floatsMatch = true;
+    for (std::size_t index = 0; index < halves.size(); ++index) {
+      floatsMatch &= sameBits(convertedFloats[index], expectedFloats[index]);
+    }
+    TEST_ASSERT(floatsMatch);
+
+    std::vector<Half> convertedHalves(floats.size());
+    floatToHalf(
+        floats.data(), convertedHalves.data(), static_cast<int>(floats.size()));
+    TEST_ASSERT(convertedHalves == expectedHalves);
+  }
+
+  setSimdLevel(supportedLevel);
+}
+
+int HalfTest(int, char* []) {
+  TestKnownValues();
+  TestAllHalves();
+  TestSimdLevels();
+
+  return 0;
+}
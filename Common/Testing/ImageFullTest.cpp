@@ -7,11 +7,16 @@
 // certain rights in this software.
 
 #include <Common/ImageRGBAFloatColorOnly.hpp>
+#include <Common/ImageRGBAFloatPlanarColorOnly.hpp>
+#include <Common/ImageRGBAHalfColorOnly.hpp>
 #include <Common/ImageRGBAUByteColorFloatDepth.hpp>
 #include <Common/ImageRGBAUByteColorOnly.hpp>
 #include <Common/ImageRGBFloatColorDepth.hpp>
+#include <Common/ImageRGBFloatPlanarColorDepth.hpp>
+#include <Common/ImageRGBHalfColorHalfDepth.hpp>
 #include <Common/SavePPM.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <string>
@@ -36,9 +41,13 @@ static void CheckAssert(bool condition,
 }
 
 using ImageTypes = std::tuple<ImageRGBAFloatColorOnly,
+                              ImageRGBAFloatPlanarColorOnly,
+                              ImageRGBAHalfColorOnly,
                               ImageRGBAUByteColorFloatDepth,
                               ImageRGBAUByteColorOnly,
-                              ImageRGBFloatColorDepth>;
+                              ImageRGBFloatColorDepth,
+                              ImageRGBFloatPlanarColorDepth,
+                              ImageRGBHalfColorHalfDepth>;
 
 template <typename ImageType>
 using ImageIsColorDepth = std::is_base_of<ImageColorDepthBase, ImageType>;
@@ -440,6 +449,54 @@ static void TestBlend() {
                 *topImage->copySubrange(MID2, END));
 }
 
+template <typename ImageType>
+static void TestBlendInto() {
+  constexpr int MID1 = IMAGE_WIDTH * IMAGE_HEIGHT / 3;
+  constexpr int MID2 = IMAGE_WIDTH * IMAGE_HEIGHT / 2;
+  constexpr int END = IMAGE_WIDTH * IMAGE_HEIGHT;
+
+  std::unique_ptr<ImageType> topImage = createImage1<ImageType>();
+  std::unique_ptr<ImageType> bottomImage = createImage2<ImageType>();
+
+  std::cout << "  Blend into reused image" << std::endl;
+  std::unique_ptr<Image> outImage = topImage->createNew(MID1, MID2);
+  topImage->blendInto(*bottomImage, *outImage);
+  compareImages(*outImage, *createImageCombined<ImageType>());
+  topImage->window(MID1, MID2)
+      ->blendInto(*bottomImage->window(MID1, MID2), *outImage);
+  compareImages(*outImage, *createImageCombined<ImageType>(MID1, MID2));
+
+  std::cout << "  Blend in place on top" << std::endl;
+  outImage = topImage->deepCopy();
+  outImage->blendInPlace(*bottomImage);
+  compareImages(*outImage, *createImageCombined<ImageType>());
+
+  std::cout << "  Blend in place on bottom" << std::endl;
+  outImage = bottomImage->deepCopy();
+  topImage->blendInto(*outImage, *outImage);
+  compareImages(*outImage, *createImageCombined<ImageType>());
+
+  std::cout << "  Blend in place accumulating pieces" << std::endl;
+  outImage = topImage->copySubrange(0, MID1);
+  outImage->blendInPlace(*topImage->copySubrange(MID1, MID2));
+  outImage->blendInPlace(*topImage->copySubrange(MID2, END));
+  compareImages(*outImage, *topImage);
+
+  std::cout << "  Blend in place growing region" << std::endl;
+  outImage = topImage->copySubrange(MID1, MID2);
+  std::unique_ptr<const Image> windowImage =
+      outImage->window(0, MID2 - MID1);
+  outImage->blendInPlace(*bottomImage);
+  compareImages(*outImage->copySubrange(0, MID1),
+                *bottomImage->copySubrange(0, MID1));
+  compareImages(*outImage->copySubrange(MID1, MID2),
+                *createImageCombined<ImageType>()->copySubrange(MID1, MID2));
+  compareImages(*outImage->copySubrange(MID2, END),
+                *bottomImage->copySubrange(MID2, END));
+  // A window taken before the blend should still see the old data.
+  compareImages(*windowImage, *createImage1<ImageType>(MID1, MID2));
+}
+
 template <typename ImageType>
 static void TestWindow() {
   std::cout << "  Window image" << std::endl;
@@ -489,19 +546,95 @@ static void DoImageTest(const std::string& imageTypeName) {
   TestTransfer<ImageType>();
   TestSubrange<ImageType>();
   TestBlend<ImageType>();
+  TestBlendInto<ImageType>();
   TestWindow<ImageType>();
 }
 
 #define DO_IMAGE_TEST(ImageType) DoImageTest<ImageType>(#ImageType)
 
+static void TestTileLayout(int tileSize, int interleave) {
+  std::cout << "Tile size " << tileSize << ", interleave " << interleave
+            << std::endl;
+  Image::setTileSize(tileSize);
+  Image::setInterleave(interleave);
+  ImageRGBAUByteColorOnly image(IMAGE_WIDTH, IMAGE_HEIGHT);
+
+  // Every location maps to a different pixel and back.
+  std::vector<int> hits(image.getNumberOfPixels(), 0);
+  bool roundTrips = true;
+  for (int y = 0; y < IMAGE_HEIGHT; ++y) {
+    for (int x = 0; x < IMAGE_WIDTH; ++x) {
+      int pixelIndex = image.pixelIndex(x, y);
+      if ((pixelIndex < 0) || (pixelIndex >= image.getNumberOfPixels())) {
+        roundTrips = false;
+        continue;
+      }
+      ++hits[pixelIndex];
+      int xBack;
+      int yBack;
+      image.xyIndices(pixelIndex, xBack, yBack);
+      roundTrips &= ((xBack == x) && (yBack == y));
+    }
+  }
+  TEST_ASSERT(roundTrips);
+  TEST_ASSERT(std::count(hits.begin(), hits.end(), 1) ==
+              image.getNumberOfPixels());
+
+  // The first pixels fill the first tile.
+  if (tileSize > 0) {
+    bool inFirstTile = true;
+    for (int pixelIndex = 0; pixelIndex < tileSize * tileSize; ++pixelIndex) {
+      int x;
+      int y;
+      image.xyIndices(pixelIndex, x, y);
+      inFirstTile &= ((x < tileSize) && (y < tileSize));
+    }
+    TEST_ASSERT(inFirstTile);
+  }
+
+  // Interleaving puts every nth row of tiles next to each other (when there
+  // are more than n rows), and the rows of tiles in pixel order end exactly
+  // at the end of the image.
+  if ((interleave > 1) && (interleave < image.getNumberOfTileRows())) {
+    int x;
+    int y;
+    image.xyIndices(image.tileRowPixelIndex(1), x, y);
+    TEST_ASSERT((x == 0) && (y == interleave * image.getTileHeight()));
+  }
+  TEST_ASSERT(image.tileRowPixelIndex(image.getNumberOfTileRows()) ==
+              image.getNumberOfPixels());
+  bool positionsRoundTrip = true;
+  for (int tileRow = 0; tileRow < image.getNumberOfTileRows(); ++tileRow) {
+    positionsRoundTrip &=
+        (image.tileRowAtPosition(image.tileRowPosition(tileRow)) == tileRow);
+  }
+  TEST_ASSERT(positionsRoundTrip);
+
+  Image::setTileSize(0);
+  Image::setInterleave(0);
+}
+
 int ImageFullTest(int argc, char* argv[]) {
   MPI_Init(&argc, &argv);
 
+  TestTileLayout(0, 0);
+  TestTileLayout(8, 0);
+  TestTileLayout(7, 0);
+  TestTileLayout(0, 3);
+  TestTileLayout(7, 4);
+  TestTileLayout(8, 32);
+
   DO_IMAGE_TEST(ImageRGBAFloatColorOnly);
+
+  DO_IMAGE_TEST(ImageRGBAFloatPlanarColorOnly);
+  DO_IMAGE_TEST(ImageRGBAHalfColorOnly);
   DO_IMAGE_TEST(ImageRGBAUByteColorFloatDepth);
   DO_IMAGE_TEST(ImageRGBAUByteColorOnly);
   DO_IMAGE_TEST(ImageRGBFloatColorDepth);
 
+  DO_IMAGE_TEST(ImageRGBFloatPlanarColorDepth);
+  DO_IMAGE_TEST(ImageRGBHalfColorHalfDepth);
+
   MPI_Finalize();
 
   return 0;
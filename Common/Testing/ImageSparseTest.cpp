@@ -7,9 +7,13 @@
 // certain rights in this software.
 
 #include <Common/ImageRGBAFloatColorOnly.hpp>
+#include <Common/ImageRGBAFloatPlanarColorOnly.hpp>
+#include <Common/ImageRGBAHalfColorOnly.hpp>
 #include <Common/ImageRGBAUByteColorFloatDepth.hpp>
 #include <Common/ImageRGBAUByteColorOnly.hpp>
 #include <Common/ImageRGBFloatColorDepth.hpp>
+#include <Common/ImageRGBFloatPlanarColorDepth.hpp>
+#include <Common/ImageRGBHalfColorHalfDepth.hpp>
 #include <Common/ImageSparse.hpp>
 #include <Common/SavePPM.hpp>
 
@@ -37,9 +41,13 @@ static void CheckAssert(bool condition,
 }
 
 using ImageTypes = std::tuple<ImageRGBAFloatColorOnly,
+                              ImageRGBAFloatPlanarColorOnly,
+                              ImageRGBAHalfColorOnly,
                               ImageRGBAUByteColorFloatDepth,
                               ImageRGBAUByteColorOnly,
-                              ImageRGBFloatColorDepth>;
+                              ImageRGBFloatColorDepth,
+                              ImageRGBFloatPlanarColorDepth,
+                              ImageRGBHalfColorHalfDepth>;
 
 template <typename ImageType>
 using ImageIsColorDepth = std::is_base_of<ImageColorDepthBase, ImageType>;
@@ -126,8 +134,9 @@ static std::unique_ptr<ImageType> createColorDepthImage1(int regionBegin,
   image->clear();
   Color color(1.0f, 0.0f, 0.0f);
   for (int pixelIndex = regionBegin; pixelIndex < regionEnd; ++pixelIndex) {
-    int x = pixelIndex % IMAGE_WIDTH;
-    int y = pixelIndex / IMAGE_WIDTH;
+    int x;
+    int y;
+    image->xyIndices(pixelIndex - regionBegin, x, y);
     if ((x > BORDER) && (x < IMAGE_WIDTH - BORDER) && (y > BORDER) &&
         (y < IMAGE_HEIGHT - BORDER) && (x <= y)) {
       image->setColor(pixelIndex - regionBegin, color);
@@ -150,8 +159,9 @@ static std::unique_ptr<ImageType> createColorOnlyImage1(int regionBegin,
   image->clear();
   Color color(0.5f, 0.0f, 0.0f, 0.5f);
   for (int pixelIndex = regionBegin; pixelIndex < regionEnd; ++pixelIndex) {
-    int x = pixelIndex % IMAGE_WIDTH;
-    int y = pixelIndex / IMAGE_WIDTH;
+    int x;
+    int y;
+    image->xyIndices(pixelIndex - regionBegin, x, y);
     if ((x > BORDER) && (x < IMAGE_WIDTH - BORDER) && (y > BORDER) &&
         (y < IMAGE_HEIGHT - BORDER) && (x <= y)) {
       image->setColor(pixelIndex - regionBegin, color);
@@ -194,8 +204,9 @@ static std::unique_ptr<ImageType> createColorDepthImage2(int regionBegin,
   image->clear();
   Color color(0.0f, 0.0f, 1.0f);
   for (int pixelIndex = regionBegin; pixelIndex < regionEnd; ++pixelIndex) {
-    int x = pixelIndex % IMAGE_WIDTH;
-    int y = pixelIndex / IMAGE_WIDTH;
+    int x;
+    int y;
+    image->xyIndices(pixelIndex - regionBegin, x, y);
     if (x <= (IMAGE_HEIGHT - y)) {
       image->setColor(pixelIndex - regionBegin, color);
       image->setDepth(pixelIndex - regionBegin,
@@ -214,8 +225,9 @@ static std::unique_ptr<ImageType> createColorOnlyImage2(int regionBegin,
   image->clear();
   Color color(0.0f, 0.0f, 0.5f, 0.5f);
   for (int pixelIndex = regionBegin; pixelIndex < regionEnd; ++pixelIndex) {
-    int x = pixelIndex % IMAGE_WIDTH;
-    int y = pixelIndex / IMAGE_WIDTH;
+    int x;
+    int y;
+    image->xyIndices(pixelIndex - regionBegin, x, y);
     if (x <= (IMAGE_HEIGHT - y)) {
       image->setColor(pixelIndex - regionBegin, color);
     }
@@ -255,8 +267,9 @@ static std::unique_ptr<ImageType> createColorDepthImageCombined(int regionBegin,
   Color color1(1.0f, 0.0f, 0.0f);
   Color color2(0.0f, 0.0f, 1.0f);
   for (int pixelIndex = regionBegin; pixelIndex < regionEnd; ++pixelIndex) {
-    int x = pixelIndex % IMAGE_WIDTH;
-    int y = pixelIndex / IMAGE_WIDTH;
+    int x;
+    int y;
+    image->xyIndices(pixelIndex - regionBegin, x, y);
     if ((x > BORDER) && (x < IMAGE_WIDTH - BORDER) && (y > BORDER) &&
         (y < IMAGE_HEIGHT - BORDER) && (x <= y) &&
         (x > (IMAGE_HEIGHT - y) || (x < (IMAGE_WIDTH / 3)))) {
@@ -283,8 +296,9 @@ static std::unique_ptr<ImageType> createColorOnlyImageCombined(int regionBegin,
   Color color2(0.0f, 0.0f, 0.5f, 0.5f);
   Color colorBlend(0.5f, 0.0f, 0.25f, 0.75f);
   for (int pixelIndex = regionBegin; pixelIndex < regionEnd; ++pixelIndex) {
-    int x = pixelIndex % IMAGE_WIDTH;
-    int y = pixelIndex / IMAGE_WIDTH;
+    int x;
+    int y;
+    image->xyIndices(pixelIndex - regionBegin, x, y);
     if ((x > BORDER) && (x < IMAGE_WIDTH - BORDER) && (y > BORDER) &&
         (y < IMAGE_HEIGHT - BORDER) && (x <= y)) {
       if (x <= (IMAGE_HEIGHT - y)) {
@@ -524,6 +538,55 @@ static void TestBlend() {
                 *topImage->copySubrange(MID2, END));
 }
 
+template <typename ImageType>
+static void TestBlendInto() {
+  constexpr int MID1 = IMAGE_WIDTH * IMAGE_HEIGHT / 3;
+  constexpr int MID2 = IMAGE_WIDTH * IMAGE_HEIGHT / 2;
+  constexpr int END = IMAGE_WIDTH * IMAGE_HEIGHT;
+
+  std::unique_ptr<ImageSparse> topImage = createImage1<ImageType>()->compress();
+  std::unique_ptr<ImageSparse> bottomImage =
+      createImage2<ImageType>()->compress();
+
+  std::cout << "  Blend into reused image" << std::endl;
+  std::unique_ptr<Image> outImage = topImage->createNew(MID1, MID2);
+  topImage->blendInto(*bottomImage, *outImage);
+  compareImages(*outImage, *createImageCombined<ImageType>());
+  topImage->window(MID1, MID2)
+      ->blendInto(*bottomImage->window(MID1, MID2), *outImage);
+  compareImages(*outImage, *createImageCombined<ImageType>(MID1, MID2));
+
+  std::cout << "  Blend in place on top" << std::endl;
+  outImage = topImage->deepCopy();
+  outImage->blendInPlace(*bottomImage);
+  compareImages(*outImage, *createImageCombined<ImageType>());
+
+  std::cout << "  Blend in place on bottom" << std::endl;
+  outImage = bottomImage->deepCopy();
+  topImage->blendInto(*outImage, *outImage);
+  compareImages(*outImage, *createImageCombined<ImageType>());
+
+  std::cout << "  Blend in place accumulating pieces" << std::endl;
+  outImage = topImage->copySubrange(0, MID1);
+  outImage->blendInPlace(*topImage->copySubrange(MID1, MID2));
+  outImage->blendInPlace(*topImage->copySubrange(MID2, END));
+  compareImages(*outImage, *topImage);
+
+  std::cout << "  Blend in place growing region" << std::endl;
+  outImage = topImage->copySubrange(MID1, MID2);
+  std::unique_ptr<const Image> windowImage =
+      outImage->window(0, MID2 - MID1);
+  outImage->blendInPlace(*bottomImage);
+  compareImages(*outImage->copySubrange(0, MID1),
+                *bottomImage->copySubrange(0, MID1));
+  compareImages(*outImage->copySubrange(MID1, MID2),
+                *createImageCombined<ImageType>()->copySubrange(MID1, MID2));
+  compareImages(*outImage->copySubrange(MID2, END),
+                *bottomImage->copySubrange(MID2, END));
+  // A window taken before the blend should still see the old data.
+  compareImages(*windowImage, *createImage1<ImageType>(MID1, MID2));
+}
+
 template <typename ImageType>
 static void TestWindow() {
   std::cout << "  Window image" << std::endl;
@@ -575,6 +638,7 @@ static void DoImageTest(const std::string& imageTypeName) {
   TestTransfer<ImageType>();
   TestSubrange<ImageType>();
   TestBlend<ImageType>();
+  TestBlendInto<ImageType>();
   TestWindow<ImageType>();
 }
 
@@ -584,10 +648,35 @@ int ImageSparseTest(int argc, char* argv[]) {
   MPI_Init(&argc, &argv);
 
   DO_IMAGE_TEST(ImageRGBAFloatColorOnly);
+
+  DO_IMAGE_TEST(ImageRGBAFloatPlanarColorOnly);
+  DO_IMAGE_TEST(ImageRGBAHalfColorOnly);
   DO_IMAGE_TEST(ImageRGBAUByteColorFloatDepth);
   DO_IMAGE_TEST(ImageRGBAUByteColorOnly);
   DO_IMAGE_TEST(ImageRGBFloatColorDepth);
 
+  DO_IMAGE_TEST(ImageRGBFloatPlanarColorDepth);
+  DO_IMAGE_TEST(ImageRGBHalfColorHalfDepth);
+
+  // Tiles that do not evenly divide the image leave partial tiles at the
+  // edges, and compression must still skip what is outside the viewport.
+  std::cout << "Tiled layout" << std::endl;
+  Image::setTileSize(8);
+  DO_IMAGE_TEST(ImageRGBAFloatColorOnly);
+  DO_IMAGE_TEST(ImageRGBAUByteColorFloatDepth);
+  DO_IMAGE_TEST(ImageRGBFloatPlanarColorDepth);
+  Image::setTileSize(0);
+
+  // Interleaved rows put pixels that are far apart next to each other.
+  std::cout << "Interleaved layout" << std::endl;
+  Image::setInterleave(3);
+  DO_IMAGE_TEST(ImageRGBAFloatColorOnly);
+  DO_IMAGE_TEST(ImageRGBAUByteColorFloatDepth);
+  Image::setTileSize(8);
+  DO_IMAGE_TEST(ImageRGBFloatPlanarColorDepth);
+  Image::setTileSize(0);
+  Image::setInterleave(0);
+
   MPI_Finalize();
 
   return 0;
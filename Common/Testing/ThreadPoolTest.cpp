@@ -0,0 +1,202 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include <Common/ImageRGBAFloatColorOnly.hpp>
+#include <Common/ImageRGBAFloatPlanarColorOnly.hpp>
+#include <Common/ImageRGBAUByteColorFloatDepth.hpp>
+#include <Common/ImageRGBFloatPlanarColorDepth.hpp>
+#include <Common/ImageSparse.hpp>
+#include <Common/ThreadPool.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define TEST_ASSERT(condition) \
+  CheckAssert(condition, #condition, __FILE__, __LINE__);
+
+static void CheckAssert(bool condition,
+                        const std::string& conditionStr,
+                        const std::string& filename,
+                        int line) {
+  if (condition) {
+    std::cout << "    OK (" << conditionStr << ")" << std::endl;
+  } else {
+    std::cerr << "    *** FAILED! *** (" << conditionStr << "), " << filename
+              << ":" << line << std::endl;
+    exit(1);
+  }
+}
+
+constexpr int NUM_THREADS = 4;
+
+// Big enough that the images are split over all the threads.
+constexpr int IMAGE_WIDTH = 400;
+constexpr int IMAGE_HEIGHT = 300;
+
+static void TestParallelFor() {
+  std::cout << "Parallel for" << std::endl;
+
+  setNumberOfThreads(NUM_THREADS);
+  TEST_ASSERT(getNumberOfThreads() == NUM_THREADS);
+
+  // Every item must be visited exactly once.
+  constexpr int NUM_ITEMS = 100003;
+  std::vector<int> visits(NUM_ITEMS, 0);
+  std::vector<int> pieceSizes(NUM_THREADS, 0);
+  parallelFor(NUM_ITEMS, 1000, [&](int begin, int end) {
+    for (int item = begin; item < end; ++item) {
+      ++visits[item];
+    }
+    pieceSizes[begin / (NUM_ITEMS / NUM_THREADS)] = end - begin;
+  });
+  bool allVisitedOnce = true;
+  for (int item = 0; item < NUM_ITEMS; ++item) {
+    allVisitedOnce &= (visits[item] == 1);
+  }
+  TEST_ASSERT(allVisitedOnce);
+  bool allSplit = true;
+  for (int pieceSize : pieceSizes) {
+    allSplit &= (pieceSize > 0);
+  }
+  TEST_ASSERT(allSplit);
+
+  // Loops too small to split are done in one piece.
+  int numPieces = 0;
+  parallelFor(1500, 1000, [&](int, int) { ++numPieces; });
+  TEST_ASSERT(numPieces == 1);
+
+  // Nested loops run serially on the thread that calls them.
+  std::vector<int> nestedVisits(NUM_THREADS * 100, 0);
+  parallelFor(NUM_THREADS, 1, [&](int begin, int end) {
+    for (int outer = begin; outer < end; ++outer) {
+      parallelFor(100, 1, [&](int innerBegin, int innerEnd) {
+        for (int inner = innerBegin; inner < innerEnd; ++inner) {
+          ++nestedVisits[outer * 100 + inner];
+        }
+      });
+    }
+  });
+  bool allNestedVisitedOnce = true;
+  for (int visitCount : nestedVisits) {
+    allNestedVisitedOnce &= (visitCount == 1);
+  }
+  TEST_ASSERT(allNestedVisitedOnce);
+
+  setNumberOfThreads(1);
+  TEST_ASSERT(getNumberOfThreads() == 1);
+}
+
+// Fills an image with a pattern that has many short runs of background and
+// foreground and leaves some rows and columns outside the valid viewport.
+template <typename ImageType>
+static std::unique_ptr<ImageType> createImage(int seed) {
+  std::unique_ptr<ImageType> image(new ImageType(IMAGE_WIDTH, IMAGE_HEIGHT));
+  image->clear();
+  Viewport viewport(
+      5 + seed, 10 + seed, IMAGE_WIDTH - 20 + seed, IMAGE_HEIGHT - 15 - seed);
+  for (int y = viewport.getMinY(); y <= viewport.getMaxY(); ++y) {
+    for (int x = viewport.getMinX(); x <= viewport.getMaxX(); ++x) {
+      if (((x * 7 + y * 13 + seed) % 11) < 6) {
+        float alpha = ((x + y) % 2 == 0) ? 1.0f : 0.5f;
+        image->setColor(x,
+                        y,
+                        Color(alpha * (x % 17) / 16.0f,
+                              alpha * (y % 13) / 12.0f,
+                              alpha * seed / 4.0f,
+                              alpha));
+        image->setDepth(x, y, ((x + y * seed) % 29) / 29.0f);
+      }
+    }
+  }
+  image->setValidViewport(viewport);
+  return image;
+}
+
+static bool colorsEqual(const Color& color1, const Color& color2) {
+  for (int component = 0; component < 4; ++component) {
+    if (color1.Components[component] != color2.Components[component]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool imagesMatch(const ImageFull& image1, const ImageFull& image2) {
+  if (image1.getNumberOfPixels() != image2.getNumberOfPixels()) {
+    return false;
+  }
+  for (int pixel = 0; pixel < image1.getNumberOfPixels(); ++pixel) {
+    if (!colorsEqual(image1.getColor(pixel), image2.getColor(pixel)) ||
+        (image1.getDepth(pixel) != image2.getDepth(pixel))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct ImageResults {
+  std::unique_ptr<ImageFull> blended;
+  std::unique_ptr<ImageFull> uncompressed;
+  std::unique_ptr<ImageFull> blendedCompressed;
+};
+
+template <typename ImageType>
+static ImageResults computeResults(int numThreads) {
+  setNumberOfThreads(numThreads);
+
+  std::unique_ptr<ImageType> image1 = createImage<ImageType>(1);
+  std::unique_ptr<ImageType> image2 = createImage<ImageType>(3);
+
+  ImageResults results;
+
+  std::unique_ptr<Image> blended = image1->createNew();
+  image1->blendInto(*image2, *blended);
+  results.blended.reset(dynamic_cast<ImageFull*>(blended.release()));
+
+  std::unique_ptr<ImageSparse> compressed1 = image1->compress();
+  std::unique_ptr<ImageSparse> compressed2 = image2->compress();
+  results.uncompressed = compressed1->uncompress();
+
+  compressed1->blendInPlace(*compressed2);
+  results.blendedCompressed = compressed1->uncompress();
+
+  setNumberOfThreads(1);
+  return results;
+}
+
+template <typename ImageType>
+static void TestImage(const std::string& imageTypeName) {
+  std::cout << imageTypeName << std::endl;
+
+  ImageResults serialResults = computeResults<ImageType>(1);
+  ImageResults threadedResults = computeResults<ImageType>(NUM_THREADS);
+
+  TEST_ASSERT(imagesMatch(*serialResults.blended, *threadedResults.blended));
+  TEST_ASSERT(imagesMatch(*serialResults.uncompressed,
+                          *threadedResults.uncompressed));
+  TEST_ASSERT(imagesMatch(*serialResults.blendedCompressed,
+                          *threadedResults.blendedCompressed));
+
+  // Compressing with threads must not change the image.
+  std::unique_ptr<ImageType> original = createImage<ImageType>(1);
+  TEST_ASSERT(imagesMatch(*original, *threadedResults.uncompressed));
+}
+
+#define DO_IMAGE_TEST(ImageType) TestImage<ImageType>(#ImageType)
+
+int ThreadPoolTest(int, char* []) {
+  TestParallelFor();
+
+  DO_IMAGE_TEST(ImageRGBAFloatColorOnly);
+  DO_IMAGE_TEST(ImageRGBAFloatPlanarColorOnly);
+  DO_IMAGE_TEST(ImageRGBAUByteColorFloatDepth);
+  DO_IMAGE_TEST(ImageRGBFloatPlanarColorDepth);
+
+  return 0;
+}
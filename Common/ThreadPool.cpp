@@ -0,0 +1,144 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#include "ThreadPool.hpp"
+
+#include <assert.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+thread_local bool runningTask = false;
+
+class Pool {
+  std::mutex mutex;
+  std::condition_variable workReady;
+  std::condition_variable workDone;
+  std::vector<std::thread> workers;
+  bool shuttingDown;
+
+  // The current batch of tasks.
+  const std::function<void(int)>* task;
+  int numTasks;
+  int nextTask;
+  int numTasksRunning;
+  unsigned long batch;
+
+  // Claims and runs tasks of the current batch until none are left.
+  void runAvailableTasks(std::unique_lock<std::mutex>& lock) {
+    while (this->nextTask < this->numTasks) {
+      int taskIndex = this->nextTask++;
+      lock.unlock();
+      runningTask = true;
+      (*this->task)(taskIndex);
+      runningTask = false;
+      lock.lock();
+      if (--this->numTasksRunning == 0) {
+        this->workDone.notify_all();
+      }
+    }
+  }
+
+  void workerLoop() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    unsigned long lastBatch = this->batch;
+    while (true) {
+      this->workReady.wait(lock, [&] {
+        return this->shuttingDown || (this->batch != lastBatch);
+      });
+      if (this->shuttingDown) {
+        return;
+      }
+      lastBatch = this->batch;
+      this->runAvailableTasks(lock);
+    }
+  }
+
+  void stopWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->shuttingDown = true;
+    }
+    this->workReady.notify_all();
+    for (auto&& worker : this->workers) {
+      worker.join();
+    }
+    this->workers.clear();
+    this->shuttingDown = false;
+  }
+
+ public:
+  Pool()
+      : shuttingDown(false),
+        task(nullptr),
+        numTasks(0),
+        nextTask(0),
+        numTasksRunning(0),
+        batch(0) {}
+
+  ~Pool() { this->stopWorkers(); }
+
+  int getNumberOfThreads() const {
+    return static_cast<int>(this->workers.size()) + 1;
+  }
+
+  void setNumberOfThreads(int numThreads) {
+    assert(!runningTask);
+    if (numThreads < 1) {
+      numThreads = 1;
+    }
+    if (numThreads == this->getNumberOfThreads()) {
+      return;
+    }
+    this->stopWorkers();
+    for (int i = 1; i < numThreads; ++i) {
+      this->workers.emplace_back(&Pool::workerLoop, this);
+    }
+  }
+
+  void run(int numTasks, const std::function<void(int)>& task) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->task = &task;
+    this->numTasks = numTasks;
+    this->nextTask = 0;
+    this->numTasksRunning = numTasks;
+    ++this->batch;
+    this->workReady.notify_all();
+
+    // The calling thread works on the batch too.
+    this->runAvailableTasks(lock);
+    this->workDone.wait(lock, [&] { return this->numTasksRunning == 0; });
+    this->task = nullptr;
+  }
+};
+
+Pool& getPool() {
+  static Pool pool;
+  return pool;
+}
+
+}  // anonymous namespace
+
+void setNumberOfThreads(int numThreads) {
+  getPool().setNumberOfThreads(numThreads);
+}
+
+int getNumberOfThreads() { return getPool().getNumberOfThreads(); }
+
+namespace ThreadPoolDetail {
+
+void runTasks(int numTasks, const std::function<void(int)>& task) {
+  getPool().run(numTasks, task);
+}
+
+bool inParallelRegion() { return runningTask; }
+
+}  // namespace ThreadPoolDetail
@@ -0,0 +1,75 @@
+// miniGraphics is distributed under the OSI-approved BSD 3-clause License.
+// See LICENSE.txt for details.
+//
+// Copyright (c) 2017
+// National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under
+// the terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains
+// certain rights in this software.
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+// A per-process pool of worker threads for splitting pixel loops within a
+// rank. With one thread (the default) parallelFor simply calls its body, so
+// pure MPI runs pay nothing. The workers persist between calls so that small
+// loops, such as those of late compositing rounds, are not dominated by
+// thread startup.
+
+#include <algorithm>
+#include <functional>
+
+/// Fewest pixels worth handing to a thread in a pixel loop. Smaller pieces
+/// cost more to hand off than to process.
+constexpr int MIN_PIXELS_PER_THREAD = 16384;
+
+/// \brief Sets the number of threads, including the calling thread, that
+/// parallelFor uses. Must be called from outside any parallelFor.
+void setNumberOfThreads(int numThreads);
+
+int getNumberOfThreads();
+
+namespace ThreadPoolDetail {
+
+// Runs task(0) through task(numTasks-1) spread over the pool and returns when
+// all are done.
+void runTasks(int numTasks, const std::function<void(int)>& task);
+
+// True when called from within a task, in which case nested loops run
+// serially.
+bool inParallelRegion();
+
+}  // namespace ThreadPoolDetail
+
+/// \brief Calls body(begin, end) on contiguous pieces of [0, numItems).
+///
+/// The pieces are split evenly over the threads but are never smaller than
+/// minItemsPerTask (except the last), so loops too small to be worth
+/// splitting run on the calling thread. The body must be safe to call
+/// concurrently on disjoint ranges.
+template <typename Function>
+void parallelFor(int numItems, int minItemsPerTask, const Function& body) {
+  int numThreads = getNumberOfThreads();
+  if (minItemsPerTask < 1) {
+    minItemsPerTask = 1;
+  }
+  int numTasks = numItems / minItemsPerTask;
+  if (numTasks > numThreads) {
+    numTasks = numThreads;
+  }
+  if ((numTasks < 2) || ThreadPoolDetail::inParallelRegion()) {
+    if (numItems > 0) {
+      body(0, numItems);
+    }
+    return;
+  }
+
+  int itemsPerTask = numItems / numTasks;
+  int numLargerTasks = numItems % numTasks;
+  ThreadPoolDetail::runTasks(numTasks, [&](int task) {
+    int begin = task * itemsPerTask + std::min(task, numLargerTasks);
+    int end = begin + itemsPerTask + ((task < numLargerTasks) ? 1 : 0);
+    body(begin, end);
+  });
+}
+
+#endif  // THREADPOOL_HPP
@@ -149,10 +149,11 @@ static std::unique_ptr<Image> ProcessIncomingImages(
     return incomingImages[0]->deepCopy();
   }
 
-  std::unique_ptr<Image> workingImage =
-      incomingImages[0]->blend(*incomingImages[1]);
+  // Accumulate all the images into a single buffer.
+  std::unique_ptr<Image> workingImage = incomingImages[0]->createNew();
+  incomingImages[0]->blendInto(*incomingImages[1], *workingImage);
   for (int imageIndex = 2; imageIndex < incomingImages.size(); ++imageIndex) {
-    workingImage = workingImage->blend(*incomingImages[imageIndex]);
+    workingImage->blendInPlace(*incomingImages[imageIndex]);
   }
 
   return workingImage;
@@ -213,7 +214,7 @@ std::unique_ptr<Image> DirectSendBase::compose(Image* localImage,
   return result;
 }
 
-enum optionIndex { MAX_IMAGE_SPLIT };
+enum optionIndex { MAX_IMAGE_SPLIT, INTERLEAVE_IMAGES };
 
 std::vector<option::Descriptor> DirectSendBase::getOptionVector() {
   std::vector<option::Descriptor> usage;
@@ -223,19 +224,34 @@ std::vector<option::Descriptor> DirectSendBase::getOptionVector() {
      "  --max-image-split=<num> Set the maximum number of times the image will\n"
      "                          be split during compositing. Setting this\n"
      "                          parameter can reduce the total network traffic,\n"
-     "                          but at the expense of load imbalance.\n"});
+     "                          but at the expense of load imbalance."});
+  usage.push_back(
+    {INTERLEAVE_IMAGES, 0, "", "interleave-images", option::Arg::None,
+     "  --interleave-images     Order the rows of the image so that each piece\n"
+     "                          it is split into holds rows spread over the\n"
+     "                          whole image. This balances the active pixels\n"
+     "                          among the pieces when the geometry covers only\n"
+     "                          part of the image.\n"});
   // clang-format on
 
   return usage;
 }
 
 bool DirectSendBase::setOptions(const std::vector<option::Option>& options,
-                                MPI_Comm,
+                                MPI_Comm communicator,
                                 YamlWriter& yaml) {
   if (options[MAX_IMAGE_SPLIT]) {
     this->maxSplit = atoi(options[MAX_IMAGE_SPLIT].arg);
   }
   yaml.AddDictionaryEntry("max-image-split", this->maxSplit);
 
+  if (options[INTERLEAVE_IMAGES]) {
+    // The image is split into one piece per receiving process.
+    int numProc;
+    MPI_Comm_size(communicator, &numProc);
+    Image::setInterleave(std::min(this->maxSplit, numProc));
+  }
+  yaml.AddDictionaryEntry("interleave", Image::getInterleave());
+
   return true;
 }
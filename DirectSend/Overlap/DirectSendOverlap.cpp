@@ -29,6 +29,9 @@ struct IncomingDirectSendImage {
   std::unique_ptr<Image> imageBuffer;
   std::vector<MPI_Request> receiveRequests;
   enum { WAITING, READY, EMPTY } status;
+  // True if imageBuffer is memory we own and can blend into. It is false
+  // when imageBuffer is a window into the local image.
+  bool writable;
 };
 
 static void getPieceRange(int imageSize,
@@ -61,6 +64,7 @@ static void PostReceives(
     incomingImagesOut.resize(1);
     incomingImagesOut[0].imageBuffer = localImage->copySubrange(0, 0);
     incomingImagesOut[0].status = IncomingDirectSendImage::READY;
+    incomingImagesOut[0].writable = true;
     return;
   }
   int recvGroupSize;
@@ -91,16 +95,19 @@ static void PostReceives(
               communicator);
       incomingImagesOut[sendGroupIndex].status =
           IncomingDirectSendImage::WAITING;
+      incomingImagesOut[sendGroupIndex].writable = true;
     } else {
       // "Sending" to self. Just record a shallow copy of the image.
       std::unique_ptr<const Image> selfSendImage =
           localImage->window(rangeBegin, rangeEnd);
       // I know, this const cast is bad form. But the next thing to happen to
       // this image is to get blended with something else. The risk is low
-      // and it's just too much trouble to get the const-ness exact.
+      // and it's just too much trouble to get the const-ness exact. (The
+      // writable flag keeps us from blending into the local image.)
       incomingImagesOut[sendGroupIndex].imageBuffer.reset(
           const_cast<Image*>(selfSendImage.release()));
       incomingImagesOut[sendGroupIndex].status = IncomingDirectSendImage::READY;
+      incomingImagesOut[sendGroupIndex].writable = false;
     }
   }
 }
@@ -197,9 +204,20 @@ static std::unique_ptr<Image> ProcessIncomingImages(
              ++sourceIn) {
           if (sourceIn->status == IncomingDirectSendImage::READY) {
             // Blend these two images together. Store the result in target and
-            // zero out the source.
-            targetIn->imageBuffer =
-                targetIn->imageBuffer->blend(*sourceIn->imageBuffer);
+            // zero out the source. Accumulate into one of the receive buffers
+            // we already have rather than allocating a new one.
+            if (targetIn->writable) {
+              targetIn->imageBuffer->blendInPlace(*sourceIn->imageBuffer);
+            } else if (sourceIn->writable) {
+              targetIn->imageBuffer->blendInto(*sourceIn->imageBuffer,
+                                               *sourceIn->imageBuffer);
+              targetIn->imageBuffer.swap(sourceIn->imageBuffer);
+              targetIn->writable = true;
+            } else {
+              targetIn->imageBuffer =
+                  targetIn->imageBuffer->blend(*sourceIn->imageBuffer);
+              targetIn->writable = true;
+            }
             sourceIn->status = IncomingDirectSendImage::EMPTY;
             sourceIn->imageBuffer.reset();
           } else if (sourceIn->status == IncomingDirectSendImage::WAITING) {
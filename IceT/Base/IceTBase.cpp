@@ -190,6 +190,17 @@ std::unique_ptr<Image> IceTBase::compose(Image* localImage,
     return localImage->copySubrange(0, 0);
   }
 
+  if (!Image::hasScanlineOrder()) {
+    std::cerr << "IceT requires images in scanline order." << std::endl;
+    return localImage->copySubrange(0, 0);
+  }
+
+  const ImageFull* localFullImage = dynamic_cast<const ImageFull*>(localImage);
+  if ((localFullImage != nullptr) && !localFullImage->holdsAllPixels()) {
+    std::cerr << "IceT requires images that are not cropped." << std::endl;
+    return localImage->copySubrange(0, 0);
+  }
+
   if (localImage->blendIsOrderDependent()) {
     icetCompositeMode(ICET_COMPOSITE_MODE_BLEND);
     icetEnable(ICET_ORDERED_COMPOSITE);
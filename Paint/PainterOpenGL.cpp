@@ -373,6 +373,17 @@ void PainterOpenGL::paint(const Mesh& mesh,
   glFlush();
   glReadBuffer(GL_BACK);
 
+  if (!Image::hasScanlineOrder()) {
+    std::cerr << "OpenGL painter requires images in scanline order."
+              << std::endl;
+    exit(1);
+  }
+
+  if (!image.holdsAllPixels()) {
+    std::cerr << "OpenGL painter cannot paint cropped images." << std::endl;
+    exit(1);
+  }
+
   ImageRGBAUByteColorFloatDepth* rgbaByteFloatImage =
       dynamic_cast<ImageRGBAUByteColorFloatDepth*>(&image);
   ImageRGBFloatColorDepth* rgbFloatFloatImage =
@@ -396,6 +407,7 @@ void PainterOpenGL::paint(const Mesh& mesh,
                  GL_DEPTH_COMPONENT,
                  GL_FLOAT,
                  rgbaByteFloatImage->getDepthBuffer());
+    rgbaByteFloatImage->invalidateDepthRanges();
   } else if (rgbFloatFloatImage != nullptr) {
     glReadPixels(0,
                  0,
@@ -411,6 +423,7 @@ void PainterOpenGL::paint(const Mesh& mesh,
                  GL_DEPTH_COMPONENT,
                  GL_FLOAT,
                  rgbFloatFloatImage->getDepthBuffer());
+    rgbFloatFloatImage->invalidateDepthRanges();
   } else if (rgbaByteImage != nullptr) {
     glReadPixels(0,
                  0,
@@ -8,6 +8,8 @@
 
 #include "PainterSimple.hpp"
 
+#include <Common/ImageDispatch.hpp>
+
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -34,13 +36,19 @@ static inline void clamp(T &variable, T min, T max) {
   variable = std::max(min, std::min(max, variable));
 }
 
-inline void PainterSimple::fillLine(ImageFull &image,
-                                    int y,
-                                    const glm::vec3 &edgeDir1,
-                                    const glm::vec3 &edgeBase1,
-                                    const glm::vec3 &edgeDir2,
-                                    const glm::vec3 &edgeBase2,
-                                    const Color &color) {
+// The painting functions are templated on the class of the image so that
+// the pixel accessors they call are not virtual. Only pixels within the given
+// bounds, which hold the valid viewport of the image, are painted.
+template <typename ImageType>
+static inline void fillLine(ImageType &image,
+                            const Viewport &bounds,
+                            int y,
+                            const glm::vec3 &edgeDir1,
+                            const glm::vec3 &edgeBase1,
+                            const glm::vec3 &edgeDir2,
+                            const glm::vec3 &edgeBase2,
+                            const Color &color,
+                            const typename ImageType::ColorType *encodedColor) {
   float interp1 = ((float)y - edgeBase1.y) / edgeDir1.y;
   float interp2 = ((float)y - edgeBase2.y) / edgeDir2.y;
 
@@ -59,36 +67,41 @@ inline void PainterSimple::fillLine(ImageFull &image,
   float depth = left.z;
 
   int xMin = static_cast<int>(left.x);
-  if (xMin < 0) {
-    depth += -xMin * deltaDepth;
-    xMin = 0;
+  if (xMin < bounds.getMinX()) {
+    depth += (bounds.getMinX() - xMin) * deltaDepth;
+    xMin = bounds.getMinX();
   }
 
-  int xMax = std::min(static_cast<int>(right.x), image.getWidth());
+  int xMax = std::min(static_cast<int>(right.x), bounds.getMaxX() + 1);
 
   for (int x = xMin; x < xMax; ++x) {
-    if ((depth >= 0.0) && (depth < image.getDepth(x, y))) {
+    int pixelIndex = image.pixelIndex(x, y);
+    if ((depth >= 0.0) && (depth < image.getDepth(pixelIndex))) {
       if (color.Components[3] >= 0.99f) {
-        image.setColor(x, y, color);
+        image.setEncodedColor(pixelIndex, encodedColor);
       } else {
-        Color previousColor = image.getColor(x, y);
-        image.setColor(x, y, color.BlendOver(previousColor));
+        Color previousColor = image.getColor(pixelIndex);
+        image.setColor(pixelIndex, color.BlendOver(previousColor));
       }
-      image.setDepth(x, y, depth);
+      image.setDepth(pixelIndex, depth);
       depth += deltaDepth;
     }
   }
 }
 
-void PainterSimple::fillTriangle(ImageFull &image,
-                                 const Triangle &triangle,
-                                 const glm::mat4 &modelview,
-                                 const glm::mat4 &projection,
-                                 const glm::mat3 &normalTransform) {
+template <typename ImageType>
+static void fillTriangle(ImageType &image,
+                         const Viewport &bounds,
+                         const Triangle &triangle,
+                         const glm::mat4 &modelview,
+                         const glm::mat4 &projection,
+                         const glm::mat3 &normalTransform) {
   glm::vec3 normal = glm::normalize(normalTransform * triangle.normal);
   float colorScale = glm::abs(glm::dot(normal, glm::vec3(0, 0, 1)));
 
   const Color &color = triangle.color.Scale(colorScale);
+  typename ImageType::ColorType encodedColor[ImageType::ColorVecSize];
+  ImageType::encodeColor(color, encodedColor);
 
   glm::ivec4 viewport(0, 0, image.getWidth(), image.getHeight());
 
@@ -119,21 +132,61 @@ void PainterSimple::fillTriangle(ImageFull &image,
   int yMid = (int)vMid.y;
   int yMax = (int)vMax.y;
 
-  clamp(yMin, 0, image.getHeight());
-  clamp(yMid, 0, image.getHeight());
-  clamp(yMax, 0, image.getHeight());
+  clamp(yMin, bounds.getMinY(), bounds.getMaxY() + 1);
+  clamp(yMid, bounds.getMinY(), bounds.getMaxY() + 1);
+  clamp(yMax, bounds.getMinY(), bounds.getMaxY() + 1);
 
   // Rasterize bottom half
   for (int y = yMin; y < yMid; ++y) {
-    this->fillLine(image, y, dirMin2Max, vMin, dirMin2Mid, vMin, color);
+    fillLine(image,
+             bounds,
+             y,
+             dirMin2Max,
+             vMin,
+             dirMin2Mid,
+             vMin,
+             color,
+             encodedColor);
   }
 
   // Rasterize top half
   for (int y = yMid; y < yMax; ++y) {
-    this->fillLine(image, y, dirMin2Max, vMin, dirMid2Max, vMid, color);
+    fillLine(image,
+             bounds,
+             y,
+             dirMin2Max,
+             vMin,
+             dirMid2Max,
+             vMid,
+             color,
+             encodedColor);
   }
 }
 
+// Paints all the triangles of a mesh into an image of a concrete class.
+struct PaintKernel {
+  const Mesh &mesh;
+  const glm::mat4 &modelview;
+  const glm::mat4 &projection;
+  const glm::mat3 &normalTransform;
+
+  template <typename ImageType>
+  void operator()(ImageType &image) const {
+    // Nothing is drawn outside the valid viewport, which an image may be
+    // cropped to.
+    Viewport bounds = image.getValidViewport().intersectWith(
+        Viewport(0, 0, image.getWidth() - 1, image.getHeight() - 1));
+    for (int i = 0; i < this->mesh.getNumberOfTriangles(); i++) {
+      fillTriangle(image,
+                   bounds,
+                   this->mesh.getTriangle(i),
+                   this->modelview,
+                   this->projection,
+                   this->normalTransform);
+    }
+  }
+};
+
 void PainterSimple::paint(const Mesh &mesh,
                           ImageFull &image,
                           const glm::mat4 &modelview,
@@ -144,8 +197,6 @@ void PainterSimple::paint(const Mesh &mesh,
   // of the rotation/scale matrix.
   glm::mat3 normalTransform = glm::inverseTranspose(glm::mat3(modelview));
 
-  for (int i = 0; i < mesh.getNumberOfTriangles(); i++) {
-    this->fillTriangle(
-        image, mesh.getTriangle(i), modelview, projection, normalTransform);
-  }
+  dispatchImageFull(
+      image, PaintKernel{mesh, modelview, projection, normalTransform});
 }
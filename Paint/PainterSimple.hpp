@@ -16,20 +16,6 @@
 #include <glm/vec3.hpp>
 
 class PainterSimple : public Painter {
- private:
-  void fillLine(ImageFull& image,
-                int y,
-                const glm::vec3& edgeDir1,
-                const glm::vec3& edgeBase1,
-                const glm::vec3& edgeDir2,
-                const glm::vec3& edgeBase2,
-                const Color& color);
-  void fillTriangle(ImageFull& image,
-                    const Triangle& triangle,
-                    const glm::mat4& modelview,
-                    const glm::mat4& projection,
-                    const glm::mat3& normalTransform);
-
  public:
   void paint(const Mesh& mesh,
              ImageFull& image,
@@ -118,7 +118,7 @@ void RadixKBase::generateK(int targetK, int numProc) {
 #endif
 }
 
-enum optionIndex { K_VALUES, TARGET_K };
+enum optionIndex { K_VALUES, TARGET_K, INTERLEAVE_IMAGES };
 
 std::vector<option::Descriptor> RadixKBase::getOptionVector() {
   std::vector<option::Descriptor> usage;
@@ -133,7 +133,14 @@ std::vector<option::Descriptor> RadixKBase::getOptionVector() {
      "  --target-k=<num>       When k values are generated, it attempts to find\n"
      "                         values as near to this target k as possible. If\n"
      "                         the k values are given (with the --k option),\n"
-     "                         then this argument is ignored. (Default 8).\n"});
+     "                         then this argument is ignored. (Default 8)."});
+  usage.push_back(
+    {INTERLEAVE_IMAGES, 0, "", "interleave-images", option::Arg::None,
+     "  --interleave-images    Order the rows of the image so that each piece it\n"
+     "                         is split into holds rows spread over the whole\n"
+     "                         image. This balances the active pixels among the\n"
+     "                         pieces when the geometry covers only part of the\n"
+     "                         image.\n"});
   // clang-format on
 
   return usage;
@@ -182,6 +189,12 @@ bool RadixKBase::setOptions(const std::vector<option::Option>& options,
     this->generateK(targetK, numProc);
   }
   yaml.AddDictionaryEntry("k", kToString(this->kVector));
+
+  if (options[INTERLEAVE_IMAGES]) {
+    // Each process ends up with one piece of the image.
+    Image::setInterleave(numProc);
+  }
+  yaml.AddDictionaryEntry("interleave", Image::getInterleave());
   if (rank == 0) {
     std::cout << "k values: " << kToString(this->kVector) << std::endl;
   }